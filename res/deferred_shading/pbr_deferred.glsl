@@ -0,0 +1,370 @@
+#version 460 core
+// GBuffer Fragment Begin
+#ifdef BindlessTextures
+#extension GL_ARB_bindless_texture : require
+#endif
+
+// 10 bytes per pixel of colour, position is rebuilt from the depth buffer in the lighting pass
+layout (location = 0) out vec4 gAlbedoAO;
+layout (location = 1) out vec2 gNormal;
+layout (location = 2) out vec2 gMaterial;
+
+in vec2 TexCoords;
+in vec3 Normal;
+in vec3 FragPos;
+in vec3 Tangent;
+in flat int DrawID;
+
+#ifdef UniformTextures
+uniform sampler2D tex_diffuse;
+uniform sampler2D tex_metallic_roughness;
+uniform sampler2D tex_normals;
+#endif
+
+#ifdef BindlessTextures
+layout(binding = 2, std430) readonly buffer ssbo1 {
+    sampler2D tex_diffuse[];
+};
+
+layout(binding = 3, std430) readonly buffer ssbo2 {
+    sampler2D tex_metallic_roughness[];
+};
+
+layout(binding = 4, std430) readonly buffer ssbo3 {
+    sampler2D tex_normals[];
+};
+#endif
+
+const float ALPHA_CUTOFF = 0.5;
+
+// Normal Mapping Begin
+// Normal Mapping End
+
+// Octahedral encoding, the snorm target stores the result without any remapping
+vec2 oct_wrap(vec2 v)
+{
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 oct_encode(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    n.xy = n.z >= 0.0 ? n.xy : oct_wrap(n.xy);
+    return n.xy;
+}
+
+void main() {
+#ifdef UniformTextures
+    vec3 bump_map_normal = texture(tex_normals, TexCoords).xyz;
+    vec4 diffuse = texture(tex_diffuse, TexCoords);
+    vec4 metallic_roughness = texture(tex_metallic_roughness, TexCoords);
+#endif
+
+#ifdef BindlessTextures
+    vec3 bump_map_normal = texture(tex_normals[DrawID], TexCoords).xyz;
+    vec4 diffuse = texture(tex_diffuse[DrawID], TexCoords);
+    vec4 metallic_roughness = texture(tex_metallic_roughness[DrawID], TexCoords);
+#endif
+
+#ifdef AlphaMask
+    if (diffuse.a < ALPHA_CUTOFF) {
+        discard;
+    }
+#endif
+
+    gAlbedoAO = vec4(diffuse.rgb, metallic_roughness.r);
+    gNormal = oct_encode(calc_bumped_normal(bump_map_normal));
+    gMaterial = vec2(metallic_roughness.b, metallic_roughness.g);
+}
+// GBuffer Fragment End
+
+#version 460 core
+// Lighting Vertex Begin
+layout (location = 0) in vec3 inPos;
+layout (location = 1) in vec2 inTexCoords;
+
+out vec2 TexCoords;
+
+void main()
+{
+    TexCoords = inTexCoords;
+    gl_Position = vec4(inPos, 1.0);
+}
+// Lighting Vertex End
+
+#version 460 core
+// Lighting Fragment Begin
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D gAlbedoAO;
+uniform sampler2D gNormal;
+uniform sampler2D gMaterial;
+uniform sampler2D gDepth;
+
+uniform mat4 inv_proj;
+uniform mat4 inv_view;
+uniform vec3 view_position;
+
+// Rebuilt from depth in main, the shared pbr functions read it the same way as the forward pass input
+vec3 FragPos;
+
+// GBuffer Decode Begin
+vec3 oct_decode(vec2 e)
+{
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+vec3 reconstruct_position(vec2 uv, float depth)
+{
+    vec4 ndc = vec4(uv * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+    vec4 view_pos = inv_proj * ndc;
+    view_pos /= view_pos.w;
+    return (inv_view * view_pos).xyz;
+}
+// GBuffer Decode End
+
+// PBR Functions Begin
+// PBR Functions End
+
+// Light Uniforms Begin
+// Light Uniforms End
+
+void main() {
+    float depth = texture(gDepth, TexCoords).r;
+    // Nothing was drawn here
+    if (depth >= 1.0) {
+        discard;
+    }
+
+    FragPos = reconstruct_position(TexCoords, depth);
+
+    vec4 albedo_ao = texture(gAlbedoAO, TexCoords);
+    vec2 material = texture(gMaterial, TexCoords).rg;
+
+    vec3 normal = oct_decode(texture(gNormal, TexCoords).rg);
+    vec3 albedo = albedo_ao.rgb;
+    float ao = albedo_ao.a;
+    float metallic = material.r;
+    float roughness = material.g;
+    vec3 view = normalize(view_position - FragPos);
+
+    vec3 lo = vec3(0.0);
+
+// LO Functions Begin
+// LO Functions End
+
+    vec3 ambient = vec3(0.03) * albedo * ao;
+    vec3 color = ambient + lo;
+
+    color = color / (color + vec3(1.0));
+    color = pow(color, vec3(1.0/2.2));
+
+    FragColor = vec4(color, 1.0);
+}
+// Lighting Fragment End
+
+#version 460 core
+// Tiled Lighting Compute Begin
+layout (local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+layout (binding = 0, rgba8) uniform writeonly image2D output_image;
+
+uniform sampler2D gAlbedoAO;
+uniform sampler2D gNormal;
+uniform sampler2D gMaterial;
+uniform sampler2D gDepth;
+
+uniform mat4 view;
+uniform mat4 inv_proj;
+uniform mat4 inv_view;
+uniform vec3 view_position;
+uniform ivec2 screen_size;
+
+uniform int point_light_count;
+uniform int spot_light_count;
+uniform int directional_light_count;
+
+// Radius in w, lights are culled as spheres
+struct TiledPointLight {
+    vec4 position_radius;
+    vec4 color;
+};
+
+struct TiledSpotLight {
+    vec4 position_radius;
+    vec4 direction_inner_cutoff;
+    vec4 color_outer_cutoff;
+};
+
+struct TiledDirectionalLight {
+    vec4 direction;
+    vec4 color;
+};
+
+layout(binding = POINT_LIGHTS_BINDING, std430) readonly buffer ssbo_point_lights {
+    TiledPointLight point_lights[];
+};
+
+layout(binding = SPOT_LIGHTS_BINDING, std430) readonly buffer ssbo_spot_lights {
+    TiledSpotLight spot_lights[];
+};
+
+layout(binding = DIRECTIONAL_LIGHTS_BINDING, std430) readonly buffer ssbo_directional_lights {
+    TiledDirectionalLight directional_lights[];
+};
+
+// Depth bounds as float bits, positive floats keep their order as uints
+shared uint tile_min_depth;
+shared uint tile_max_depth;
+shared uint tile_light_count;
+// Point lights first, spot lights are offset by point_light_count
+shared uint tile_lights[MAX_LIGHTS_PER_TILE];
+
+vec3 FragPos;
+
+// Tiled Lighting Compute Functions
+
+// Positive view space distance of a depth buffer value
+float linear_depth(float depth)
+{
+    vec4 view_pos = inv_proj * vec4(0.0, 0.0, depth * 2.0 - 1.0, 1.0);
+    return -view_pos.z / view_pos.w;
+}
+
+vec3 far_corner(vec2 ndc)
+{
+    vec4 view_pos = inv_proj * vec4(ndc, 1.0, 1.0);
+    return view_pos.xyz / view_pos.w;
+}
+
+// Plane through the eye and two far corners, facing the inside of the tile
+vec3 side_plane(vec3 a, vec3 b, vec3 inside)
+{
+    vec3 normal = normalize(cross(a, b));
+    return dot(normal, inside) < 0.0 ? -normal : normal;
+}
+
+void main() {
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    bool on_screen = all(lessThan(texel, screen_size));
+
+    if (gl_LocalInvocationIndex == 0) {
+        tile_min_depth = 0xFFFFFFFFu;
+        tile_max_depth = 0u;
+        tile_light_count = 0u;
+    }
+    barrier();
+
+    float depth = 1.0;
+    if (on_screen) {
+        depth = texelFetch(gDepth, texel, 0).r;
+    }
+    bool has_geometry = depth < 1.0;
+    if (has_geometry) {
+        atomicMin(tile_min_depth, floatBitsToUint(depth));
+        atomicMax(tile_max_depth, floatBitsToUint(depth));
+    }
+    barrier();
+
+    // Tiles with only sky skip culling entirely
+    if (tile_max_depth != 0u) {
+        float near_z = linear_depth(uintBitsToFloat(tile_min_depth));
+        float far_z = linear_depth(uintBitsToFloat(tile_max_depth));
+
+        vec2 tile_min = vec2(gl_WorkGroupID.xy * TILE_SIZE) / vec2(screen_size) * 2.0 - 1.0;
+        vec2 tile_max = vec2(min(ivec2(gl_WorkGroupID.xy + 1) * TILE_SIZE, screen_size)) / vec2(screen_size) * 2.0 - 1.0;
+
+        vec3 corner_00 = far_corner(tile_min);
+        vec3 corner_10 = far_corner(vec2(tile_max.x, tile_min.y));
+        vec3 corner_11 = far_corner(tile_max);
+        vec3 corner_01 = far_corner(vec2(tile_min.x, tile_max.y));
+        vec3 center = far_corner((tile_min + tile_max) * 0.5);
+
+        vec3 planes[4];
+        planes[0] = side_plane(corner_00, corner_10, center);
+        planes[1] = side_plane(corner_10, corner_11, center);
+        planes[2] = side_plane(corner_11, corner_01, center);
+        planes[3] = side_plane(corner_01, corner_00, center);
+
+        uint point_count = uint(point_light_count);
+        uint light_total = point_count + uint(spot_light_count);
+        for (uint i = gl_LocalInvocationIndex; i < light_total; i += TILE_SIZE * TILE_SIZE) {
+            vec4 position_radius = i < point_count ? point_lights[i].position_radius : spot_lights[i - point_count].position_radius;
+            vec3 position = (view * vec4(position_radius.xyz, 1.0)).xyz;
+            float radius = position_radius.w;
+
+            bool visible = -position.z + radius >= near_z && -position.z - radius <= far_z;
+            for (int plane = 0; plane < 4 && visible; plane++) {
+                visible = dot(planes[plane], position) >= -radius;
+            }
+
+            if (visible) {
+                uint slot = atomicAdd(tile_light_count, 1u);
+                if (slot < MAX_LIGHTS_PER_TILE) {
+                    tile_lights[slot] = i;
+                }
+            }
+        }
+    }
+    barrier();
+
+    if (!on_screen) {
+        return;
+    }
+    if (!has_geometry) {
+        imageStore(output_image, texel, vec4(0.0, 0.0, 0.0, 1.0));
+        return;
+    }
+
+    FragPos = reconstruct_position((vec2(texel) + 0.5) / vec2(screen_size), depth);
+
+    vec4 albedo_ao = texelFetch(gAlbedoAO, texel, 0);
+    vec2 material = texelFetch(gMaterial, texel, 0).rg;
+
+    vec3 normal = oct_decode(texelFetch(gNormal, texel, 0).rg);
+    vec3 albedo = albedo_ao.rgb;
+    float ao = albedo_ao.a;
+    float metallic = material.r;
+    float roughness = material.g;
+    vec3 view_dir = normalize(view_position - FragPos);
+
+    vec3 lo = vec3(0.0);
+
+    for (int i = 0; i < directional_light_count; i++) {
+        DirectionalLight light = DirectionalLight(directional_lights[i].direction.xyz, directional_lights[i].color.rgb);
+        lo += pbr_directional(light, albedo, roughness, metallic, normal, view_dir);
+    }
+
+    uint point_count = uint(point_light_count);
+    uint tile_count = min(tile_light_count, uint(MAX_LIGHTS_PER_TILE));
+    for (uint i = 0; i < tile_count; i++) {
+        uint index = tile_lights[i];
+        if (index < point_count) {
+            PointLight light = PointLight(point_lights[index].position_radius.xyz, point_lights[index].color.rgb);
+            lo += pbr_point(light, albedo, roughness, metallic, normal, view_dir);
+        } else {
+            TiledSpotLight tiled = spot_lights[index - point_count];
+            SpotLight light = SpotLight(
+                tiled.position_radius.xyz,
+                tiled.direction_inner_cutoff.xyz,
+                tiled.color_outer_cutoff.rgb,
+                tiled.direction_inner_cutoff.w,
+                tiled.color_outer_cutoff.w);
+            lo += pbr_spot(light, albedo, roughness, metallic, normal, view_dir);
+        }
+    }
+
+    vec3 ambient = vec3(0.03) * albedo * ao;
+    vec3 color = ambient + lo;
+
+    color = color / (color + vec3(1.0));
+    color = pow(color, vec3(1.0/2.2));
+
+    imageStore(output_image, texel, vec4(color, 1.0));
+}
+// Tiled Lighting Compute End
@@ -11,6 +11,9 @@ out vec2 TexCoords;
 out vec3 Tangent;
 out flat int DrawID;
 
+// The depth pre-pass and the main pass have to produce the exact same depth for GL_EQUAL
+invariant gl_Position;
+
 #ifdef ModelUniform
 uniform mat4 model;
 #endif
@@ -23,9 +26,21 @@ layout(binding = 1, std430) readonly buffer ssbo0 {
 };
 #endif
 
+#ifdef GpuCulling
+// Written by the culling pass, every (phase, command) owns instance_stride slots starting at its base instance
+layout(binding = 8, std430) readonly buffer ssbo_instance_remap {
+    uint instance_remap[];
+};
+
+uniform int instance_stride;
+uniform int command_count;
+#endif
+
 void main()
 {
-#ifdef SSBO0
+#ifdef GpuCulling
+    mat4 model = models[instance_remap[gl_BaseInstance + gl_InstanceID]];
+#elif defined(SSBO0)
     mat4 model = models[gl_InstanceID];
 #endif
     vec4 world_pos = model * vec4(inPos, 1.0);
@@ -37,7 +52,12 @@ void main()
 
     FragPos = world_pos.xyz;
 
-    DrawID = gl_DrawID;
+    // Draws are split per alpha mode, so gl_DrawID is not unique, the mesh stores the command index in the base instance
+#ifdef GpuCulling
+    DrawID = (gl_BaseInstance / instance_stride) % command_count;
+#else
+    DrawID = gl_BaseInstance;
+#endif
 
     gl_Position = proj * view * world_pos;
 }
@@ -57,24 +77,6 @@ in vec3 FragPos;
 in vec3 Tangent;
 in flat int DrawID;
 
-struct PointLight {
-    vec3 position;
-    vec3 color;
-};
-
-struct DirectionalLight {
-    vec3 direction;
-    vec3 color;
-};
-
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    vec3 color;
-    float inner_cutoff;
-    float outer_cutoff;
-};
-
 #ifdef UniformTextures
 uniform sampler2D tex_diffuse;
 uniform sampler2D tex_metallic_roughness;
@@ -101,6 +103,27 @@ uniform int normals_max_textures;
 
 uniform vec3 view_position;
 
+const float ALPHA_CUTOFF = 0.5;
+
+// PBR Functions Begin
+struct PointLight {
+    vec3 position;
+    vec3 color;
+};
+
+struct DirectionalLight {
+    vec3 direction;
+    vec3 color;
+};
+
+struct SpotLight {
+    vec3 position;
+    vec3 direction;
+    vec3 color;
+    float inner_cutoff;
+    float outer_cutoff;
+};
+
 const float PI = 3.14159265359;
 
 float distribution_ggx(float NdotH, float roughness)
@@ -221,6 +244,9 @@ vec3 pbr_spot(
     return pbr_base(albedo, roughness, metallic, base_reflectivity, radiance, N, V, L, H) * intensity;
 }
 
+// PBR Functions End
+
+// Normal Mapping Begin
 vec3 calc_bumped_normal(vec3 bump_map_normal)
 {
     vec3 normal = normalize(Normal);
@@ -238,6 +264,7 @@ vec3 calc_bumped_normal(vec3 bump_map_normal)
 
     return new_normal;
 }
+// Normal Mapping End
 
 // Light Uniforms Begin
 // Light Uniforms End
@@ -264,9 +291,11 @@ void main() {
     float ao = 1.0;
     vec3 view = normalize(view_position - FragPos);
 
-    if (diffuse.a < 0.01) {
+#ifdef AlphaMask
+    if (diffuse.a < ALPHA_CUTOFF) {
         discard;
     }
+#endif
     albedo.rgb = diffuse.rgb;
     ao = metallic_roughness.r;
     metallic = metallic_roughness.b;
@@ -285,4 +314,44 @@ void main() {
 
     FragColor = vec4(color, diffuse.a);
 }
-// Fragment End
\ No newline at end of file
+// Fragment End
+
+#version 460 core
+// Depth Fragment Begin
+#ifdef BindlessTextures
+#extension GL_ARB_bindless_texture : require
+#endif
+
+in vec2 TexCoords;
+in flat int DrawID;
+
+const float ALPHA_CUTOFF = 0.5;
+
+#ifdef AlphaMask
+#ifdef UniformTextures
+uniform sampler2D tex_diffuse;
+#endif
+
+#ifdef BindlessTextures
+layout(binding = 2, std430) readonly buffer ssbo1 {
+    sampler2D tex_diffuse[];
+};
+#endif
+#endif
+
+void main() {
+#ifdef AlphaMask
+#ifdef UniformTextures
+    float alpha = texture(tex_diffuse, TexCoords).a;
+#endif
+
+#ifdef BindlessTextures
+    float alpha = texture(tex_diffuse[DrawID], TexCoords).a;
+#endif
+
+    if (alpha < ALPHA_CUTOFF) {
+        discard;
+    }
+#endif
+}
+// Depth Fragment End
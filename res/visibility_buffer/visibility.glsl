@@ -0,0 +1,276 @@
+#version 460 core
+// Visibility Vertex Begin
+layout (location = 0) in vec3 inPos;
+layout (location = 2) in vec2 inTexCoords;
+
+out vec2 TexCoords;
+out flat int DrawID;
+out flat int InstanceID;
+
+uniform mat4 view;
+uniform mat4 proj;
+
+layout(binding = 1, std430) readonly buffer ssbo0 {
+    mat4 models[];
+};
+
+void main()
+{
+    TexCoords = inTexCoords;
+    // The mesh stores the command index in the base instance, gl_DrawID restarts per alpha bucket
+    DrawID = gl_BaseInstance;
+    InstanceID = gl_InstanceID;
+
+    gl_Position = proj * view * models[gl_InstanceID] * vec4(inPos, 1.0);
+}
+// Visibility Vertex End
+
+#version 460 core
+// Visibility Fragment Begin
+#extension GL_ARB_bindless_texture : require
+
+layout (location = 0) out uint Visibility;
+
+in vec2 TexCoords;
+in flat int DrawID;
+in flat int InstanceID;
+
+uniform int draw_offset;
+uniform int command_count;
+
+#ifdef AlphaMask
+layout(binding = 2, std430) readonly buffer ssbo1 {
+    sampler2D tex_diffuse[];
+};
+
+const float ALPHA_CUTOFF = 0.5;
+#endif
+
+void main() {
+#ifdef AlphaMask
+    if (texture(tex_diffuse[DrawID], TexCoords).a < ALPHA_CUTOFF) {
+        discard;
+    }
+#endif
+
+    uint draw = uint(draw_offset + InstanceID * command_count + DrawID);
+    // gl_PrimitiveID restarts with every command of a multi draw
+    Visibility = (draw << TRIANGLE_ID_BITS) | (uint(gl_PrimitiveID) & ((1u << TRIANGLE_ID_BITS) - 1u));
+}
+// Visibility Fragment End
+
+#version 460 core
+// Material Vertex Begin
+layout (location = 0) in vec3 inPos;
+layout (location = 1) in vec2 inTexCoords;
+
+void main()
+{
+    gl_Position = vec4(inPos, 1.0);
+}
+// Material Vertex End
+
+#version 460 core
+// Material Fragment Begin
+#extension GL_ARB_bindless_texture : require
+
+out vec4 FragColor;
+
+uniform usampler2D visibility;
+
+uniform mat4 view;
+uniform mat4 proj;
+uniform vec3 view_position;
+
+// Draw ids owned by the mesh being resolved
+uniform int draw_offset;
+uniform int draw_count;
+uniform int command_count;
+
+layout(binding = 1, std430) readonly buffer ssbo0 {
+    mat4 models[];
+};
+
+layout(binding = 2, std430) readonly buffer ssbo1 {
+    sampler2D tex_diffuse[];
+};
+
+layout(binding = 3, std430) readonly buffer ssbo2 {
+    sampler2D tex_metallic_roughness[];
+};
+
+layout(binding = 4, std430) readonly buffer ssbo3 {
+    sampler2D tex_normals[];
+};
+
+struct IndirectCommand {
+    uint count;
+    uint instance_count;
+    uint first_index;
+    int base_vertex;
+    uint base_instance;
+};
+
+layout(binding = COMMANDS_BINDING, std430) readonly buffer ssbo_commands {
+    IndirectCommand commands[];
+};
+
+// Mesh::Vertex as floats, vec3 would be padded to 16 bytes
+layout(binding = VERTICES_BINDING, std430) readonly buffer ssbo_vertices {
+    float vertices[];
+};
+
+layout(binding = INDICES_BINDING, std430) readonly buffer ssbo_indices {
+    uint indices[];
+};
+
+const uint VERTEX_STRIDE = 11;
+const uint NORMAL_OFFSET = 3;
+const uint TEX_COORDS_OFFSET = 6;
+const uint TANGENT_OFFSET = 8;
+
+// Interpolated in main, the shared pbr and normal mapping functions read them like shader inputs
+vec3 FragPos;
+vec3 Normal;
+vec3 Tangent;
+
+vec3 fetch_vec3(uint vertex, uint offset)
+{
+    uint base = vertex * VERTEX_STRIDE + offset;
+    return vec3(vertices[base], vertices[base + 1], vertices[base + 2]);
+}
+
+vec2 fetch_vec2(uint vertex, uint offset)
+{
+    uint base = vertex * VERTEX_STRIDE + offset;
+    return vec2(vertices[base], vertices[base + 1]);
+}
+
+// Perspective correct barycentrics and their screen space derivatives from the clip space
+// triangle, the derivatives replace the ones the rasterizer would give textureGrad
+struct Barycentrics {
+    vec3 lambda;
+    vec3 ddx;
+    vec3 ddy;
+};
+
+Barycentrics calc_barycentrics(vec4 clip_0, vec4 clip_1, vec4 clip_2, vec2 ndc, vec2 screen_size)
+{
+    Barycentrics result;
+
+    vec3 inv_w = 1.0 / vec3(clip_0.w, clip_1.w, clip_2.w);
+    vec2 ndc_0 = clip_0.xy * inv_w.x;
+    vec2 ndc_1 = clip_1.xy * inv_w.y;
+    vec2 ndc_2 = clip_2.xy * inv_w.z;
+
+    float inv_det = 1.0 / determinant(mat2(ndc_2 - ndc_1, ndc_0 - ndc_1));
+    result.ddx = vec3(ndc_1.y - ndc_2.y, ndc_2.y - ndc_0.y, ndc_0.y - ndc_1.y) * inv_det * inv_w;
+    result.ddy = vec3(ndc_2.x - ndc_1.x, ndc_0.x - ndc_2.x, ndc_1.x - ndc_0.x) * inv_det * inv_w;
+    float ddx_sum = dot(result.ddx, vec3(1.0));
+    float ddy_sum = dot(result.ddy, vec3(1.0));
+
+    vec2 delta = ndc - ndc_0;
+    float interp_inv_w = inv_w.x + delta.x * ddx_sum + delta.y * ddy_sum;
+    float interp_w = 1.0 / interp_inv_w;
+
+    result.lambda.x = interp_w * (inv_w.x + delta.x * result.ddx.x + delta.y * result.ddy.x);
+    result.lambda.y = interp_w * (delta.x * result.ddx.y + delta.y * result.ddy.y);
+    result.lambda.z = interp_w * (delta.x * result.ddx.z + delta.y * result.ddy.z);
+
+    // One pixel step in ndc
+    result.ddx *= 2.0 / screen_size.x;
+    result.ddy *= 2.0 / screen_size.y;
+    ddx_sum *= 2.0 / screen_size.x;
+    ddy_sum *= 2.0 / screen_size.y;
+
+    float interp_w_ddx = 1.0 / (interp_inv_w + ddx_sum);
+    float interp_w_ddy = 1.0 / (interp_inv_w + ddy_sum);
+    result.ddx = interp_w_ddx * (result.lambda * interp_inv_w + result.ddx) - result.lambda;
+    result.ddy = interp_w_ddy * (result.lambda * interp_inv_w + result.ddy) - result.lambda;
+
+    return result;
+}
+
+// PBR Functions Begin
+// PBR Functions End
+
+// Normal Mapping Begin
+// Normal Mapping End
+
+// Light Uniforms Begin
+// Light Uniforms End
+
+void main() {
+    uint packed_id = texelFetch(visibility, ivec2(gl_FragCoord.xy), 0).r;
+    uint draw = packed_id >> TRIANGLE_ID_BITS;
+    if (packed_id == 0xFFFFFFFFu || draw < uint(draw_offset) || draw >= uint(draw_offset + draw_count)) {
+        discard;
+    }
+
+    uint local_draw = draw - uint(draw_offset);
+    uint command_index = local_draw % uint(command_count);
+    uint instance = local_draw / uint(command_count);
+    uint triangle = packed_id & ((1u << TRIANGLE_ID_BITS) - 1u);
+
+    IndirectCommand command = commands[command_index];
+    uint first = command.first_index + triangle * 3;
+    uvec3 triangle_vertices = uvec3(
+        uint(int(indices[first]) + command.base_vertex),
+        uint(int(indices[first + 1]) + command.base_vertex),
+        uint(int(indices[first + 2]) + command.base_vertex));
+
+    mat4 model = models[instance];
+    vec4 world_0 = model * vec4(fetch_vec3(triangle_vertices.x, 0), 1.0);
+    vec4 world_1 = model * vec4(fetch_vec3(triangle_vertices.y, 0), 1.0);
+    vec4 world_2 = model * vec4(fetch_vec3(triangle_vertices.z, 0), 1.0);
+
+    mat4 view_proj = proj * view;
+    vec2 screen_size = vec2(textureSize(visibility, 0));
+    vec2 ndc = gl_FragCoord.xy / screen_size * 2.0 - 1.0;
+    Barycentrics bary = calc_barycentrics(view_proj * world_0, view_proj * world_1, view_proj * world_2, ndc, screen_size);
+
+    FragPos = mat3x3(world_0.xyz, world_1.xyz, world_2.xyz) * bary.lambda;
+
+    mat3 transposed_model = mat3(transpose(inverse(model)));
+    Normal = transposed_model * (mat3x3(
+        fetch_vec3(triangle_vertices.x, NORMAL_OFFSET),
+        fetch_vec3(triangle_vertices.y, NORMAL_OFFSET),
+        fetch_vec3(triangle_vertices.z, NORMAL_OFFSET)) * bary.lambda);
+    Tangent = transposed_model * (mat3x3(
+        fetch_vec3(triangle_vertices.x, TANGENT_OFFSET),
+        fetch_vec3(triangle_vertices.y, TANGENT_OFFSET),
+        fetch_vec3(triangle_vertices.z, TANGENT_OFFSET)) * bary.lambda);
+
+    mat3x2 tex_coords = mat3x2(
+        fetch_vec2(triangle_vertices.x, TEX_COORDS_OFFSET),
+        fetch_vec2(triangle_vertices.y, TEX_COORDS_OFFSET),
+        fetch_vec2(triangle_vertices.z, TEX_COORDS_OFFSET));
+    vec2 uv = tex_coords * bary.lambda;
+    vec2 uv_ddx = tex_coords * bary.ddx;
+    vec2 uv_ddy = tex_coords * bary.ddy;
+
+    vec3 bump_map_normal = textureGrad(tex_normals[command_index], uv, uv_ddx, uv_ddy).xyz;
+    vec4 diffuse = textureGrad(tex_diffuse[command_index], uv, uv_ddx, uv_ddy);
+    vec4 metallic_roughness = textureGrad(tex_metallic_roughness[command_index], uv, uv_ddx, uv_ddy);
+
+    vec3 normal = calc_bumped_normal(bump_map_normal);
+    vec3 albedo = diffuse.rgb;
+    float ao = metallic_roughness.r;
+    float metallic = metallic_roughness.b;
+    float roughness = metallic_roughness.g;
+    vec3 view = normalize(view_position - FragPos);
+
+    vec3 lo = vec3(0.0);
+
+// LO Functions Begin
+// LO Functions End
+
+    vec3 ambient = vec3(0.03) * albedo * ao;
+    vec3 color = ambient + lo;
+
+    color = color / (color + vec3(1.0));
+    color = pow(color, vec3(1.0/2.2));
+
+    FragColor = vec4(color, 1.0);
+}
+// Material Fragment End
@@ -1,5 +1,7 @@
 #include "app.hpp"
 
+#include "physics/collision_cache.hpp"
+
 App::App()
 {
     Physics::Engine::setup_singletons();
@@ -24,6 +26,12 @@ App::App()
                 m_camera.rotate(event.motion.xrel, -event.motion.yrel);
             }
         }
+        if (event.type == SDL_EVENT_MOUSE_BUTTON_DOWN && event.button.button == SDL_BUTTON_LEFT) {
+            // Picking needs the cursor, clicks on the debug ui stay there
+            if (!m_capture_mouse && !ImGui::GetIO().WantCaptureMouse) {
+                m_scene->pick({ event.button.x, event.button.y });
+            }
+        }
         if (event.type == SDL_EVENT_KEY_DOWN) {
             if (event.key.key == SDLK_ESCAPE) {
                 m_capture_mouse = !m_capture_mouse;
@@ -39,6 +47,9 @@ App::App()
             if (event.key.key == SDLK_Q) {
                 m_window.set_should_close();
             }
+            if (event.key.key == SDLK_K) {
+                record_camera_keyframe();
+            }
         }
     });
 
@@ -55,13 +66,13 @@ App::App()
     glm::mat4 e2_model_matrix = glm::scale(glm::mat4(1.0), glm::vec3(0.1));
     e2.add_model_matrix(e2_model_matrix);
     e2.add_physics_command([&](Physics::System* system, Renderer::Model* model) -> std::pair<JPH::BodyID, JPH::EMotionType> {
-        JPH::TriangleList triangles;
+        JPH::VertexList vertices;
+        JPH::IndexedTriangleList triangles;
         const auto* mesh = model->get_mesh();
-        Physics::System::create_mesh_triangle_list_base_index(triangles, e2_model_matrix, mesh);
-        // Physics::System::create_mesh_triangle_list_base_index(triangles, mesh);
+        Physics::System::create_mesh_indexed_triangle_list(vertices, triangles, e2_model_matrix, mesh);
         JPH::BodyID plane_id = system->m_body_interface->CreateAndAddBody(
             JPH::BodyCreationSettings(
-                new JPH::MeshShapeSettings(triangles),
+                Physics::CollisionCache::get_or_create_mesh_shape("res/models/Sponza/glTF/Sponza.collision", vertices, triangles),
                 JPH::RVec3::sZero(), JPH::Quat::sIdentity(),
                 JPH::EMotionType::Static,
                 Physics::Layers::NON_MOVING),
@@ -87,24 +98,23 @@ App::App()
     });
     m_scene->add_entity(e3);
 
+    const JPH::ShapeRefC cube_shape = new JPH::BoxShape(JPH::Vec3(0.5, 0.5, 0.5));
+    std::vector<JPH::BodyCreationSettings> cubes;
     for (int i = 0; i <= 50; i++) {
-        e3.add_physics_command([](Physics::System* system, [[maybe_unused]] Renderer::Model* _model) -> std::pair<JPH::BodyID, JPH::EMotionType> {
-            float y = rand() % 300;
-            float x = rand() % 10 - 5;
-            float z = rand() % 10 - 5;
-            JPH::BodyCreationSettings cube_settings(
-                new JPH::BoxShape(JPH::Vec3(0.5, 0.5, 0.5)),
-                JPH::RVec3(x, y, z),
-                JPH::Quat::sIdentity(),
-                JPH::EMotionType::Dynamic,
-                Physics::Layers::MOVING);
-            auto body = system->m_body_interface->CreateAndAddBody(
-                cube_settings,
-                JPH::EActivation::Activate);
-            return { body, JPH::EMotionType::Dynamic };
-        });
-        m_scene->add_entity(e3);
+        float y = rand() % 300;
+        float x = rand() % 10 - 5;
+        float z = rand() % 10 - 5;
+        cubes.emplace_back(
+            cube_shape,
+            JPH::RVec3(x, y, z),
+            JPH::Quat::sIdentity(),
+            JPH::EMotionType::Dynamic,
+            Physics::Layers::MOVING);
     }
+    EntityBuilder cube_builder;
+    cube_builder.add_name("cube");
+    cube_builder.add_model_path("res/models/physics_cube/cube.obj");
+    m_scene->spawn_bodies(cube_builder, cubes, JPH::EActivation::Activate);
 
     EntityBuilder e6;
     e6.add_name("sphere");
@@ -160,6 +170,21 @@ App::~App()
     Physics::Engine::cleanup_singletons();
 }
 
+void App::record_camera_keyframe()
+{
+    const glm::vec3 pos = m_camera.get_pos();
+    m_camera_keyframes.push_back({
+        { "position", { pos.x, pos.y, pos.z } },
+        { "yaw", m_camera.get_yaw() },
+        { "pitch", m_camera.get_pitch() },
+    });
+
+    // rpg-bench replays it as "camera": { "path": "camera_path.json" }
+    std::ofstream file("camera_path.json");
+    file << nlohmann::json { { "keyframes", m_camera_keyframes } }.dump(4);
+    LOG_INFO(std::format("Recorded camera keyframe {}", m_camera_keyframes.size()));
+}
+
 void App::fps_counter()
 {
     static float time_passed;
@@ -210,11 +235,16 @@ void App::run()
         }
     };
 
+    Utils::Profiler::set_thread_name("main");
     m_window.loop([&]() {
+        // Closes the previous frame, its scopes show up in the debug window
+        Utils::Profiler::end_frame();
+
         m_scene->update();
         scancodes();
         fps_counter();
 
+        m_scene->set_physics_running(m_physics_on);
         if (m_physics_on) {
             m_scene->physics();
         }
@@ -241,13 +271,30 @@ void App::run()
             }
         }
 
-        if (ImGui::Checkbox("Toggle deferred shading", &m_deferred_pass)) {
-            LOG_INFO(std::format("Setting deffered shading to {}", m_deferred_pass));
-            m_scene->set_pass(!m_deferred_pass);
+        if (ImGui::Combo("Render pass", &m_pass, "Forward\0Deferred\0Visibility buffer\0")) {
+            LOG_INFO(std::format("Setting render pass to {}", m_pass));
+            m_scene->set_pass(static_cast<Scene::Pass>(m_pass));
         }
 
         ImGui::Checkbox("Toggle physics", &m_physics_on);
 
+#if RPG_PROFILE
+        if (ImGui::CollapsingHeader("CPU profiler")) {
+            Utils::Profiler::draw_imgui();
+        }
+        if (ImGui::CollapsingHeader("Flight recorder")) {
+            Utils::FlightRecorder::draw_imgui();
+        }
+#endif
+
+        if (ImGui::CollapsingHeader("GPU profiler")) {
+            Renderer::GpuProfiler::draw_imgui();
+        }
+
+        if (ImGui::CollapsingHeader("Renderer counters")) {
+            Renderer::Counters::draw_imgui();
+        }
+
         if (ImGui::CollapsingHeader("Scene_1")) {
             m_scene->draw_debug_imgui();
         }
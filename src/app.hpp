@@ -12,15 +12,19 @@ public:
 
 private:
     void fps_counter();
+    // Appends the camera to camera_path.json, a path for rpg-bench
+    void record_camera_keyframe();
 
     bool m_capture_mouse = true;
     bool m_physics_on = false;
     bool m_vsync = true;
-    bool m_deferred_pass = false;
+    i32 m_pass = 0;
 
     const char* m_window_title = "test window";
     Renderer::Window m_window;
     Renderer::Camera m_camera;
 
     Scene* m_scene = nullptr;
+
+    nlohmann::json m_camera_keyframes = nlohmann::json::array();
 };
\ No newline at end of file
@@ -0,0 +1,461 @@
+#include "bench.hpp"
+
+#include "../physics/collision_cache.hpp"
+
+#include <filesystem>
+
+namespace {
+    glm::vec3 to_vec3(const nlohmann::json& value)
+    {
+        return { value.at(0).get<f32>(), value.at(1).get<f32>(), value.at(2).get<f32>() };
+    }
+
+    nlohmann::json parse_file(const char* path)
+    {
+        const std::vector<char> text = read_file<char>(path);
+        if (text.empty()) {
+            util_error(std::format("Bench: could not read \"{}\"", path));
+        }
+        return nlohmann::json::parse(text.data());
+    }
+
+    Scene::Pass get_pass(const std::string& name)
+    {
+        if (name == "forward") {
+            return Scene::Pass::Forward;
+        }
+        if (name == "deferred") {
+            return Scene::Pass::Deferred;
+        }
+        if (name == "visibility") {
+            return Scene::Pass::Visibility;
+        }
+        util_error(std::format("Bench: unknown pass \"{}\"", name));
+        return Scene::Pass::Forward;
+    }
+
+    glm::vec3 catmull_rom(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, f32 t)
+    {
+        const f32 t2 = t * t;
+        const f32 t3 = t2 * t;
+        return 0.5F * ((2.0F * p1) + (-p0 + p2) * t + (2.0F * p0 - 5.0F * p1 + 4.0F * p2 - p3) * t2 + (-p0 + 3.0F * p1 - 3.0F * p2 + p3) * t3);
+    }
+
+    // Nearest rank on sorted values
+    f64 get_percentile(const std::vector<f64>& sorted, f64 percentile)
+    {
+        const auto rank = static_cast<usize>(std::ceil(percentile / 100.0 * static_cast<f64>(sorted.size())));
+        return sorted[std::clamp<usize>(rank, 1, sorted.size()) - 1];
+    }
+} // anonymous namespace
+
+Bench::Bench(const char* config_path)
+    : m_config_path(config_path)
+{
+    const nlohmann::json config = parse_file(config_path);
+
+    m_output_path = config.value("output", m_output_path);
+    m_frame_count = config.value("frames", m_frame_count);
+    m_warmup_frames = config.value("warmup_frames", m_warmup_frames);
+    m_delta_time = config.value("delta_time", m_delta_time);
+    m_physics = config.value("physics", m_physics);
+    m_rays_per_frame = config.value("rays_per_frame", m_rays_per_frame);
+    m_compare_collision_builders = config.value("compare_collision_builders", m_compare_collision_builders);
+    util_assert(m_frame_count > 0, "Bench: the config needs at least one frame");
+
+    Utils::Profiler::set_thread_name("main");
+    Physics::Engine::setup_singletons();
+
+    m_window.init_headless(config.value("width", 1280), config.value("height", 720));
+    LOG_INFO(std::format("Bench: running on {} ({})",
+        reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+        reinterpret_cast<const char*>(glGetString(GL_VERSION))));
+
+    const nlohmann::json& camera = config.at("camera");
+    m_camera.init(camera.value("fov", 90.0F), camera.value("near", 0.1F), camera.value("far", 1000.0F), m_window.get_aspect_ratio(), glm::vec3(0.0F));
+    load_camera_path(camera);
+
+    Renderer::Model::init_placeholder_textures();
+
+    Physics::SystemSettings physics_settings;
+    physics_settings.temp_allocator_size = config.value("physics_temp_allocator_size", physics_settings.temp_allocator_size);
+    m_scene = new Scene(m_window, m_camera, physics_settings);
+    m_scene->set_fixed_delta_time(m_delta_time);
+    m_scene->set_pass(get_pass(config.value("pass", std::string("deferred"))));
+    // false forces the geometry shader path so both point shadow paths can be compared
+    m_scene->set_layered_point_shadows(config.value("layered_point_shadows", true));
+    m_scene->set_cache_shadows(config.value("cache_shadows", true));
+    load_scene(config);
+
+    m_scene->optimize();
+    m_scene->update();
+
+    // Same points every run
+    std::mt19937 random(1U);
+    std::uniform_real_distribution<f32> screen(-1.0F, 1.0F);
+    for (u32 i = 0; i < m_rays_per_frame; i++) {
+        m_ray_points.emplace_back(screen(random), screen(random));
+    }
+    m_rays.resize(m_rays_per_frame);
+    m_ray_hits.resize(m_rays_per_frame);
+}
+
+Bench::~Bench()
+{
+    delete m_scene;
+    Renderer::Model::destroy_placeholder_textures();
+    Physics::Engine::cleanup_singletons();
+}
+
+void Bench::load_camera_path(const nlohmann::json& camera)
+{
+    // Either inline or a file written by the app while flying around
+    const nlohmann::json path = camera.contains("path") ? parse_file(camera.at("path").get<std::string>().c_str()) : camera;
+
+    for (const auto& keyframe : path.at("keyframes")) {
+        m_keyframes.emplace_back(Keyframe {
+            .position = to_vec3(keyframe.at("position")),
+            .yaw = keyframe.at("yaw").get<f32>(),
+            .pitch = keyframe.at("pitch").get<f32>(),
+        });
+    }
+    util_assert(!m_keyframes.empty(), "Bench: the camera path needs at least one keyframe");
+}
+
+void Bench::load_scene(const nlohmann::json& config)
+{
+    for (const auto& model : config.value("models", nlohmann::json::array())) {
+        const char* path = m_strings.emplace_back(model.at("path").get<std::string>()).c_str();
+        const glm::mat4 model_matrix = glm::scale(
+            glm::translate(glm::mat4(1.0F), to_vec3(model.value("position", nlohmann::json::array({ 0.0F, 0.0F, 0.0F })))),
+            glm::vec3(model.value("scale", 1.0F)));
+
+        EntityBuilder entity;
+        entity.add_model_path(path);
+        entity.add_model_matrix(model_matrix);
+        if (model.value("static_collision", false)) {
+            const std::string cache_path = std::filesystem::path(path).replace_extension(".collision").string();
+            entity.add_physics_command([this, path, model_matrix, cache_path](Physics::System* system, Renderer::Model* entity_model) -> std::pair<JPH::BodyID, JPH::EMotionType> {
+                JPH::VertexList vertices;
+                JPH::IndexedTriangleList triangles;
+                const i64 begin_ns = Utils::Profiler::now_ns();
+                Physics::System::create_mesh_indexed_triangle_list(vertices, triangles, model_matrix, entity_model->get_mesh());
+                CollisionBuild build {
+                    .path = path,
+                    .ms = static_cast<f64>(Utils::Profiler::now_ns() - begin_ns) / 1'000'000.0,
+                    .bytes = vertices.size() * sizeof(JPH::Float3) + triangles.size() * sizeof(JPH::IndexedTriangle),
+                };
+
+                // The per triangle builder it replaced, only timed and sized, its output is thrown away
+                if (m_compare_collision_builders) {
+                    JPH::TriangleList reference;
+                    const i64 reference_begin_ns = Utils::Profiler::now_ns();
+                    Physics::System::create_mesh_triangle_list_base_index(reference, model_matrix, entity_model->get_mesh());
+                    build.reference_ms = static_cast<f64>(Utils::Profiler::now_ns() - reference_begin_ns) / 1'000'000.0;
+                    build.reference_bytes = reference.size() * sizeof(JPH::Triangle);
+                }
+                m_collision_builds.emplace_back(build);
+
+                JPH::BodyID body = system->m_body_interface->CreateAndAddBody(
+                    JPH::BodyCreationSettings(
+                        Physics::CollisionCache::get_or_create_mesh_shape(cache_path, vertices, triangles),
+                        JPH::RVec3::sZero(), JPH::Quat::sIdentity(),
+                        JPH::EMotionType::Static,
+                        Physics::Layers::NON_MOVING),
+                    JPH::EActivation::DontActivate);
+                return { body, JPH::EMotionType::Static };
+            });
+        }
+        m_scene->add_entity(entity);
+    }
+
+    // Same positions every run
+    if (config.contains("dynamic_cubes")) {
+        const nlohmann::json& cubes = config.at("dynamic_cubes");
+        const char* path = m_strings.emplace_back(cubes.at("model").get<std::string>()).c_str();
+        std::mt19937 random(cubes.value("seed", 1U));
+        std::uniform_real_distribution<f32> horizontal(-5.0F, 5.0F);
+        std::uniform_real_distribution<f32> vertical(0.0F, 300.0F);
+
+        const JPH::ShapeRefC box = new JPH::BoxShape(JPH::Vec3(0.5, 0.5, 0.5));
+        std::vector<JPH::BodyCreationSettings> bodies;
+        for (u32 i = 0; i < cubes.value("count", 0U); i++) {
+            const JPH::RVec3 position(horizontal(random), vertical(random), horizontal(random));
+            bodies.emplace_back(box, position, JPH::Quat::sIdentity(), JPH::EMotionType::Dynamic, Physics::Layers::MOVING);
+        }
+
+        EntityBuilder entity;
+        entity.add_model_path(path);
+        m_scene->spawn_bodies(entity, bodies, JPH::EActivation::Activate);
+    }
+
+    const nlohmann::json lights = config.value("lights", nlohmann::json::object());
+    for (const auto& light : lights.value("directional", nlohmann::json::array())) {
+        Renderer::Light::Pbr::Directional directional {};
+        directional.direction = to_vec3(light.at("direction"));
+        directional.color = to_vec3(light.at("color"));
+        EntityBuilder entity;
+        entity.add_pbr_directional_light(directional);
+        m_scene->add_entity(entity);
+    }
+    for (const auto& light : lights.value("point", nlohmann::json::array())) {
+        Renderer::Light::Pbr::Point point {};
+        point.position = to_vec3(light.at("position"));
+        point.color = to_vec3(light.at("color"));
+        EntityBuilder entity;
+        entity.add_pbr_point_light(point);
+        m_scene->add_entity(entity);
+    }
+    // Phong point lights are the ones with cubemap shadows
+    for (const auto& light : lights.value("phong_point", nlohmann::json::array())) {
+        Renderer::Light::Phong::PointInfo point {};
+        point.position = to_vec3(light.at("position"));
+        point.diffuse = to_vec3(light.at("color"));
+        point.specular = point.diffuse;
+        point.constant = 1.0F;
+        point.linear = light.value("linear", 0.09F);
+        point.quadratic = light.value("quadratic", 0.032F);
+        point.shadowmap = light.value("shadowmap", true);
+        point.far = light.value("far", point.far);
+        EntityBuilder entity;
+        entity.add_phong_point_light(point);
+        m_scene->add_entity(entity);
+    }
+    for (const auto& light : lights.value("spot", nlohmann::json::array())) {
+        Renderer::Light::Pbr::Spot spot {};
+        spot.position = to_vec3(light.at("position"));
+        spot.direction = to_vec3(light.at("direction"));
+        spot.color = to_vec3(light.at("color"));
+        spot.inner_cutoff = glm::cos(glm::radians(light.at("inner_cutoff").get<f32>()));
+        spot.outer_cutoff = glm::cos(glm::radians(light.at("outer_cutoff").get<f32>()));
+        EntityBuilder entity;
+        entity.add_pbr_spot_light(spot);
+        m_scene->add_entity(entity);
+    }
+}
+
+void Bench::place_camera(f32 t)
+{
+    const auto last = static_cast<i64>(m_keyframes.size() - 1);
+    const f32 position = t * static_cast<f32>(last);
+    const i64 segment = std::min(static_cast<i64>(position), std::max<i64>(last - 1, 0));
+    const f32 local_t = position - static_cast<f32>(segment);
+
+    const auto keyframe = [&](i64 index) -> const Keyframe& {
+        return m_keyframes[static_cast<usize>(std::clamp<i64>(index, 0, last))];
+    };
+    const Keyframe& k0 = keyframe(segment - 1);
+    const Keyframe& k1 = keyframe(segment);
+    const Keyframe& k2 = keyframe(segment + 1);
+    const Keyframe& k3 = keyframe(segment + 2);
+
+    // Yaw and pitch go through the same spline, the app records them unwrapped
+    const glm::vec3 angles = catmull_rom(
+        { k0.yaw, k0.pitch, 0.0F },
+        { k1.yaw, k1.pitch, 0.0F },
+        { k2.yaw, k2.pitch, 0.0F },
+        { k3.yaw, k3.pitch, 0.0F },
+        local_t);
+
+    m_camera.set_pos(catmull_rom(k0.position, k1.position, k2.position, k3.position, local_t));
+    m_camera.set_rotation(angles.x, angles.y);
+}
+
+void Bench::run()
+{
+    LOG_INFO(std::format("Bench: {} warmup frames, {} measured frames", m_warmup_frames, m_frame_count));
+
+    const u32 total_frames = m_warmup_frames + m_frame_count;
+    i64 frame_begin_ns = Utils::Profiler::now_ns();
+    for (u32 frame = 0; frame < total_frames; frame++) {
+        Utils::Profiler::end_frame();
+        Renderer::GpuProfiler::begin_frame();
+        Renderer::Counters::begin_frame();
+
+        // The warmup holds the camera on the first keyframe so shaders and shadows are settled before the path starts
+        const u32 measured = frame < m_warmup_frames ? 0 : frame - m_warmup_frames;
+        place_camera(m_frame_count > 1 ? static_cast<f32>(measured) / static_cast<f32>(m_frame_count - 1) : 0.0F);
+
+        m_scene->update();
+        // Stepped here with the fixed delta time, the simulation thread would tie the poses to the frame rate
+        if (m_physics) {
+            m_scene->step_physics(m_delta_time);
+        }
+        if (m_rays_per_frame > 0) {
+            cast_rays(frame >= m_warmup_frames);
+        }
+        m_scene->draw();
+
+        Renderer::GpuProfiler::end_frame();
+        m_window.swap_buffers();
+
+        const i64 frame_end_ns = Utils::Profiler::now_ns();
+        if (frame >= m_warmup_frames) {
+            record_frame(static_cast<f64>(frame_end_ns - frame_begin_ns) / 1'000'000.0);
+        }
+        frame_begin_ns = frame_end_ns;
+    }
+
+    write_results();
+}
+
+void Bench::cast_rays(bool record)
+{
+    const glm::mat4 inverse_proj_view = m_camera.get_inverse_proj_view();
+    for (usize i = 0; i < m_rays.size(); i++) {
+        glm::vec4 near = inverse_proj_view * glm::vec4(m_ray_points[i], -1.0F, 1.0F);
+        glm::vec4 far = inverse_proj_view * glm::vec4(m_ray_points[i], 1.0F, 1.0F);
+        near /= near.w;
+        far /= far.w;
+        m_rays[i] = Physics::RayCast { .origin = glm::vec3(near), .direction = glm::vec3(far - near) };
+    }
+
+    const i64 begin_ns = Utils::Profiler::now_ns();
+    m_scene->cast_rays(m_rays, m_ray_hits);
+    const i64 end_ns = Utils::Profiler::now_ns();
+    if (!record) {
+        return;
+    }
+
+    m_ray_ms.emplace_back(static_cast<f64>(end_ns - begin_ns) / 1'000'000.0);
+    m_rays_hit += static_cast<u64>(std::ranges::count_if(m_ray_hits, [](const Physics::QueryHit& hit) { return !hit.body.IsInvalid(); }));
+}
+
+void Bench::record_frame(f64 frame_ms)
+{
+    m_frame_ms.emplace_back(frame_ms);
+
+    // Counters::begin_frame() moved the previous frame's values, close enough over a whole run
+    for (usize i = 0; i < Renderer::Counters::COUNTER_COUNT; i++) {
+        m_counter_totals[i] += Renderer::Counters::get(static_cast<Renderer::Counters::Counter>(i));
+    }
+
+    // GPU results arrive a few frames late and frames in flight are dropped, so passes average
+    // over the frames that were read back
+    const u64 gpu_frame = Renderer::GpuProfiler::get_results_frame();
+    if (gpu_frame == m_last_gpu_frame) {
+        return;
+    }
+    m_last_gpu_frame = gpu_frame;
+
+    for (const auto& result : Renderer::GpuProfiler::get_results()) {
+        auto it = std::ranges::find_if(m_passes, [&](const PassTiming& pass) { return std::string_view(pass.name) == result.name; });
+        if (it == m_passes.end()) {
+            m_passes.emplace_back(PassTiming { .name = result.name });
+            it = m_passes.end() - 1;
+        }
+        it->gpu_ms += result.get_gpu_ms();
+        it->cpu_ms += result.get_cpu_ms();
+        it->samples++;
+    }
+}
+
+void Bench::write_results() const
+{
+    std::vector<f64> sorted = m_frame_ms;
+    std::ranges::sort(sorted);
+
+    f64 total_ms = 0.0;
+    for (f64 frame_ms : sorted) {
+        total_ms += frame_ms;
+    }
+
+    nlohmann::json passes = nlohmann::json::array();
+    for (const auto& pass : m_passes) {
+        passes.push_back({
+            { "name", pass.name },
+            { "gpu_ms", pass.gpu_ms / pass.samples },
+            { "cpu_ms", pass.cpu_ms / pass.samples },
+            { "samples", pass.samples },
+        });
+    }
+
+    nlohmann::json counters = nlohmann::json::object();
+    for (usize i = 0; i < Renderer::Counters::COUNTER_COUNT; i++) {
+        counters[Renderer::Counters::get_name(static_cast<Renderer::Counters::Counter>(i))]
+            = static_cast<f64>(m_counter_totals[i]) / static_cast<f64>(m_frame_ms.size());
+    }
+
+    const auto temp_worst = m_scene->get_physics_system().get_temp_allocator().get_worst_step();
+    nlohmann::json results = {
+        { "config", m_config_path },
+        { "renderer", reinterpret_cast<const char*>(glGetString(GL_RENDERER)) },
+        { "frames", m_frame_ms.size() },
+        { "delta_time", m_delta_time },
+        { "physics", m_physics },
+        { "layered_point_shadows", m_scene->get_layered_point_shadows() },
+        {
+            "frame_ms",
+            {
+                { "mean", total_ms / static_cast<f64>(sorted.size()) },
+                { "min", sorted.front() },
+                { "p50", get_percentile(sorted, 50.0) },
+                { "p90", get_percentile(sorted, 90.0) },
+                { "p95", get_percentile(sorted, 95.0) },
+                { "p99", get_percentile(sorted, 99.0) },
+                { "max", sorted.back() },
+            },
+        },
+        {
+            "physics_temp_allocator",
+            {
+                { "worst_capacity", temp_worst.capacity },
+                { "worst_peak_bytes", temp_worst.peak_bytes },
+                { "worst_allocations", temp_worst.allocations },
+                { "worst_fallback_allocations", temp_worst.fallback_allocations },
+            },
+        },
+        { "passes", std::move(passes) },
+        { "counters_per_frame", std::move(counters) },
+    };
+
+    if (!m_collision_builds.empty()) {
+        nlohmann::json builds = nlohmann::json::array();
+        for (const auto& build : m_collision_builds) {
+            nlohmann::json entry = {
+                { "path", build.path },
+                { "indexed_ms", build.ms },
+                { "indexed_bytes", build.bytes },
+            };
+            if (m_compare_collision_builders) {
+                entry["reference_ms"] = build.reference_ms;
+                entry["reference_bytes"] = build.reference_bytes;
+            }
+            builds.push_back(std::move(entry));
+        }
+        results["collision_builds"] = std::move(builds);
+    }
+
+    if (!m_ray_ms.empty()) {
+        std::vector<f64> ray_ms = m_ray_ms;
+        std::ranges::sort(ray_ms);
+        f64 total_ray_ms = 0.0;
+        for (const f64 ms : ray_ms) {
+            total_ray_ms += ms;
+        }
+        const f64 ray_count = static_cast<f64>(m_rays_per_frame) * static_cast<f64>(ray_ms.size());
+        results["ray_queries"] = {
+            { "rays_per_frame", m_rays_per_frame },
+            { "mean_ms", total_ray_ms / static_cast<f64>(ray_ms.size()) },
+            { "p50_ms", get_percentile(ray_ms, 50.0) },
+            { "p99_ms", get_percentile(ray_ms, 99.0) },
+            { "rays_per_second", ray_count / (total_ray_ms / 1000.0) },
+            { "hit_rate", static_cast<f64>(m_rays_hit) / ray_count },
+        };
+        LOG_INFO(std::format("Bench: {} rays per frame in {:.3f} ms p50, {:.3f} ms p99",
+            m_rays_per_frame,
+            get_percentile(ray_ms, 50.0),
+            get_percentile(ray_ms, 99.0)));
+    }
+
+    std::ofstream file(m_output_path);
+    if (!file) {
+        LOG_ERROR(std::format("could not open results file \"{}\"", m_output_path));
+        return;
+    }
+    file << results.dump(4);
+    LOG_INFO(std::format("Bench: p50 {:.3f} ms, p99 {:.3f} ms, results written to \"{}\"",
+        get_percentile(sorted, 50.0),
+        get_percentile(sorted, 99.0),
+        m_output_path));
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "renderer.hpp"
+#include "../scene/scene.hpp"
+
+// Headless replay of a scene for comparing builds. The config names the models and lights, a
+// camera path and how many frames to run, every frame advances by the same delta time. Frame
+// time percentiles, the GPU profiler's passes and the renderer counters are written as JSON.
+// With rays_per_frame set every frame also casts that many rays through the view, timed on their own
+class Bench : public NoCopyNoMove {
+public:
+    explicit Bench(const char* config_path);
+    ~Bench();
+
+    void run();
+
+private:
+    struct Keyframe {
+        glm::vec3 position;
+        f32 yaw;
+        f32 pitch;
+    };
+
+    // Static collider built while loading, with the old per triangle builder as a reference when
+    // compare_collision_builders is set
+    struct CollisionBuild {
+        const char* path;
+        f64 ms = 0.0;
+        usize bytes = 0;
+        f64 reference_ms = 0.0;
+        usize reference_bytes = 0;
+    };
+
+    struct PassTiming {
+        const char* name;
+        f64 gpu_ms = 0.0;
+        f64 cpu_ms = 0.0;
+        u32 samples = 0;
+    };
+
+    void load_scene(const nlohmann::json& config);
+    void load_camera_path(const nlohmann::json& camera);
+    // Catmull-Rom through the keyframes, t goes from 0 to 1 over the run
+    void place_camera(f32 t);
+
+    // Casts m_rays_per_frame rays from the camera through fixed random points on the screen
+    void cast_rays(bool record);
+    void record_frame(f64 frame_ms);
+    void write_results() const;
+
+    std::string m_config_path;
+    std::string m_output_path = "bench_results.json";
+    u32 m_frame_count = 600;
+    u32 m_warmup_frames = 60;
+    f32 m_delta_time = 1.0F / 60.0F;
+    bool m_physics = false;
+    u32 m_rays_per_frame = 0;
+    bool m_compare_collision_builders = false;
+
+    Renderer::Window m_window;
+    Renderer::Camera m_camera;
+    Scene* m_scene = nullptr;
+
+    // Entities keep their model paths and names by pointer
+    std::deque<std::string> m_strings;
+    std::vector<Keyframe> m_keyframes;
+
+    std::vector<f64> m_frame_ms;
+    std::vector<PassTiming> m_passes;
+    u64 m_last_gpu_frame = 0;
+    std::array<u64, Renderer::Counters::COUNTER_COUNT> m_counter_totals {};
+
+    std::vector<CollisionBuild> m_collision_builds;
+
+    std::vector<glm::vec2> m_ray_points;
+    std::vector<Physics::RayCast> m_rays;
+    std::vector<Physics::QueryHit> m_ray_hits;
+    std::vector<f64> m_ray_ms;
+    u64 m_rays_hit = 0;
+};
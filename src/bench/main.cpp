@@ -0,0 +1,13 @@
+#include "bench.hpp"
+
+int main(int argc, char** argv)
+{
+    const char* config_path = argc > 1 ? argv[1] : "res/bench/sponza.json";
+
+    Bench bench(config_path);
+    bench.run();
+
+    LOG_TRACE("Exiting bench main function");
+
+    return 0;
+}
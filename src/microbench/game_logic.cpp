@@ -0,0 +1,58 @@
+#include "microbench.hpp"
+
+#include "../game_logic/character.hpp"
+
+namespace Microbench {
+
+void add_game_logic_benchmarks(Registry& registry)
+{
+    // Equipping recomputes the statsheet from every item, size characters are regeared
+    registry.emplace_back(Benchmark {
+        .name = "Statsheet (Character::equip_item + get_scaled_statsheet)",
+        .sizes = { 1, 64, 1024 },
+        .function = [](Context& context) {
+            std::vector<Character> characters;
+            std::vector<Item> items;
+            for (u64 i = 0; i < context.get_size(); i++) {
+                characters.emplace_back(Character::random_character("character", 500));
+                items.emplace_back(Item::random_item(520, static_cast<u32>(i % Item::TOTAL_SLOTS), "item"));
+            }
+
+            context.measure([&]() {
+                for (usize i = 0; i < characters.size(); i++) {
+                    do_not_optimize(characters[i].equip_item(items[i]).get_item_level());
+                    do_not_optimize(characters[i].get_scaled_statsheet().m_primary);
+                }
+            });
+        },
+    });
+
+    registry.emplace_back(Benchmark {
+        .name = "Ability::get_effectiveness",
+        .sizes = { 1, 64, 1024 },
+        .function = [](Context& context) {
+            std::vector<Character> casters;
+            std::vector<Character> targets;
+            for (u64 i = 0; i < context.get_size(); i++) {
+                casters.emplace_back(Character::random_character("caster", 500));
+                targets.emplace_back(Character::random_character("target", 500));
+            }
+            const Ability ability(
+                Statsheet<f64> {
+                    .m_primary = 1.0,
+                    .m_crit = 1.0,
+                    .m_haste = 1.0,
+                    .m_expertise = 1.0,
+                },
+                Ability::PHYSICAL_DAMAGE);
+
+            context.measure([&]() {
+                for (usize i = 0; i < casters.size(); i++) {
+                    do_not_optimize(ability.get_effectiveness(casters[i], targets[i]));
+                }
+            });
+        },
+    });
+}
+
+} // namespace Microbench
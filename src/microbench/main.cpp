@@ -0,0 +1,36 @@
+#include "microbench.hpp"
+
+#include "../physics/engine.hpp"
+
+// rpg-microbench [--filter <name part>] [--output <path>]
+int main(int argc, char** argv)
+{
+    std::string_view filter;
+    const char* output_path = "microbench_results.json";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string_view option = argv[i];
+        if (option == "--filter") {
+            filter = argv[i + 1];
+        } else if (option == "--output") {
+            output_path = argv[i + 1];
+        } else {
+            util_error(std::format("Microbench: unknown option \"{}\"", option));
+        }
+    }
+
+    // Jolt's allocator has to be registered before the physics benchmarks build triangle lists
+    Physics::Engine::setup_singletons();
+
+    Microbench::Registry registry;
+    Microbench::add_utils_benchmarks(registry);
+    Microbench::add_scene_benchmarks(registry);
+    Microbench::add_renderer_benchmarks(registry);
+    Microbench::add_physics_benchmarks(registry);
+    Microbench::add_game_logic_benchmarks(registry);
+
+    Microbench::run(registry, filter, output_path);
+
+    Physics::Engine::cleanup_singletons();
+
+    return 0;
+}
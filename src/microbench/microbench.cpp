@@ -0,0 +1,82 @@
+#include "microbench.hpp"
+
+namespace Microbench {
+
+Context::Context(u64 size)
+    : m_size(size)
+{
+    m_result.items_per_iteration = size;
+}
+
+[[nodiscard]] u64 Context::get_size() const
+{
+    return m_size;
+}
+
+void Context::set_items_per_iteration(u64 items)
+{
+    m_result.items_per_iteration = items;
+}
+
+[[nodiscard]] const Context::Result& Context::get_result() const
+{
+    return m_result;
+}
+
+void Context::finish(u64 iterations, std::vector<f64>& batch_ns)
+{
+    std::ranges::sort(batch_ns);
+
+    f64 total_ns = 0.0;
+    for (f64 ns : batch_ns) {
+        total_ns += ns;
+    }
+
+    const auto per_iteration = [&](f64 ns) { return ns / static_cast<f64>(iterations); };
+    m_result.iterations = iterations;
+    m_result.min_ns = per_iteration(batch_ns.front());
+    m_result.median_ns = per_iteration(batch_ns[batch_ns.size() / 2]);
+    m_result.mean_ns = per_iteration(total_ns / static_cast<f64>(batch_ns.size()));
+}
+
+void run(const Registry& registry, std::string_view filter, const char* output_path)
+{
+    nlohmann::json results = nlohmann::json::array();
+
+    for (const auto& benchmark : registry) {
+        if (!std::string_view(benchmark.name).contains(filter)) {
+            continue;
+        }
+
+        for (u64 size : benchmark.sizes) {
+            Context context(size);
+            benchmark.function(context);
+            const Context::Result& result = context.get_result();
+            util_assert(result.iterations > 0, std::format("Microbench: {} never called measure()", benchmark.name));
+
+            const f64 items_per_second = static_cast<f64>(result.items_per_iteration) / (result.median_ns / 1'000'000'000.0);
+            std::println("{:<56} {:>8} {:>14.1f} ns {:>14.0f} items/s", benchmark.name, size, result.median_ns, items_per_second);
+
+            results.push_back({
+                { "name", benchmark.name },
+                { "size", size },
+                { "iterations", result.iterations },
+                { "repetitions", Context::REPETITIONS },
+                { "min_ns", result.min_ns },
+                { "median_ns", result.median_ns },
+                { "mean_ns", result.mean_ns },
+                { "items_per_second", items_per_second },
+            });
+        }
+    }
+
+    std::ofstream file(output_path);
+    if (!file) {
+        LOG_ERROR(std::format("could not open results file \"{}\"", output_path));
+        return;
+    }
+    file << nlohmann::json { { "benchmarks", std::move(results) } }.dump(4);
+    LOG_INFO(std::format("Microbench: results written to \"{}\"", output_path));
+}
+
+} // namespace Microbench
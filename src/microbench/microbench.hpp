@@ -0,0 +1,90 @@
+#pragma once
+
+// Small benchmark harness for CPU hot paths. Every benchmark runs once per size, measure() picks
+// an iteration count that takes at least MIN_BATCH_NS and repeats the batch REPETITIONS times.
+// Results go to JSON so two runs can be diffed
+namespace Microbench {
+
+// Keeps the compiler from dropping a result it sees as unused
+template <typename T>
+inline void do_not_optimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class Context : public NoCopyNoMove {
+public:
+    explicit Context(u64 size);
+
+    [[nodiscard]] u64 get_size() const;
+    // Work done by one iteration, for items per second (size by default)
+    void set_items_per_iteration(u64 items);
+
+    // Only body is timed, setup belongs before the call
+    template <typename Function>
+    void measure(Function&& body);
+
+    struct Result {
+        u64 iterations = 0;
+        f64 min_ns = 0.0;
+        f64 median_ns = 0.0;
+        f64 mean_ns = 0.0;
+        u64 items_per_iteration = 0;
+    };
+
+    [[nodiscard]] const Result& get_result() const;
+
+    static constexpr i64 MIN_BATCH_NS = 10'000'000;
+    static constexpr u32 REPETITIONS = 5;
+
+private:
+    void finish(u64 iterations, std::vector<f64>& batch_ns);
+
+    u64 m_size;
+    Result m_result;
+};
+
+struct Benchmark {
+    const char* name;
+    std::vector<u64> sizes;
+    std::function<void(Context&)> function;
+};
+
+using Registry = std::vector<Benchmark>;
+
+void add_utils_benchmarks(Registry& registry);
+void add_scene_benchmarks(Registry& registry);
+void add_renderer_benchmarks(Registry& registry);
+void add_physics_benchmarks(Registry& registry);
+void add_game_logic_benchmarks(Registry& registry);
+
+// Runs the benchmarks whose name contains filter and writes them to output_path
+void run(const Registry& registry, std::string_view filter, const char* output_path);
+
+template <typename Function>
+void Context::measure(Function&& body)
+{
+    u64 iterations = 1;
+    while (true) {
+        const i64 begin_ns = Utils::Profiler::now_ns();
+        for (u64 i = 0; i < iterations; i++) {
+            body();
+        }
+        if (Utils::Profiler::now_ns() - begin_ns >= MIN_BATCH_NS || iterations >= (1ULL << 40)) {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    std::vector<f64> batch_ns;
+    for (u32 repetition = 0; repetition < REPETITIONS; repetition++) {
+        const i64 begin_ns = Utils::Profiler::now_ns();
+        for (u64 i = 0; i < iterations; i++) {
+            body();
+        }
+        batch_ns.emplace_back(static_cast<f64>(Utils::Profiler::now_ns() - begin_ns));
+    }
+    finish(iterations, batch_ns);
+}
+
+} // namespace Microbench
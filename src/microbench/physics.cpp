@@ -0,0 +1,271 @@
+#include "microbench.hpp"
+
+#include "../physics/engine.hpp"
+#include "../physics/helpers.hpp"
+#include "../physics/queries.hpp"
+
+namespace Microbench {
+
+namespace {
+    // A grid of quads split into sub-meshes, only what the triangle list reads is filled in
+    void make_grid_mesh(Renderer::Mesh& mesh, u64 quads_per_side)
+    {
+        constexpr u64 SUB_MESHES = 4;
+        const u64 quads_per_mesh = std::max<u64>(quads_per_side * quads_per_side / SUB_MESHES, 1);
+
+        for (u64 sub_mesh = 0; sub_mesh < SUB_MESHES; sub_mesh++) {
+            const auto base = static_cast<GLsizei>(mesh.m_vertices.size());
+            const auto offset = static_cast<GLuint>(mesh.m_indices.size());
+            for (u64 quad = 0; quad < quads_per_mesh; quad++) {
+                const auto x = static_cast<f32>(quad % quads_per_side);
+                const auto z = static_cast<f32>(quad / quads_per_side + sub_mesh * quads_per_side);
+                const auto first = static_cast<u32>(mesh.m_vertices.size()) - static_cast<u32>(base);
+                for (const glm::vec2 corner : { glm::vec2(0.0F, 0.0F), glm::vec2(1.0F, 0.0F), glm::vec2(1.0F, 1.0F), glm::vec2(0.0F, 1.0F) }) {
+                    mesh.m_vertices.emplace_back(Renderer::Mesh::Vertex { .m_pos = glm::vec3(x + corner.x, 0.0F, z + corner.y) });
+                }
+                for (u32 index : { 0U, 1U, 2U, 0U, 2U, 3U }) {
+                    mesh.m_indices.emplace_back(first + index);
+                }
+            }
+            auto& base_vertex = mesh.m_base_vertices.emplace_back(static_cast<GLsizei>(mesh.m_indices.size() - offset), base);
+            base_vertex.m_offset = offset;
+        }
+    }
+
+    std::vector<JPH::Mat44> make_transforms(u64 count)
+    {
+        std::vector<JPH::Mat44> transforms;
+        transforms.reserve(count);
+        for (u64 i = 0; i < count; i++) {
+            const auto angle = static_cast<f32>(i) * 0.01F;
+            transforms.emplace_back(JPH::Mat44::sRotationTranslation(JPH::Quat::sRotation(JPH::Vec3::sAxisY(), angle), JPH::Vec3(angle, 1.0F, -angle)));
+        }
+        return transforms;
+    }
+
+    // The conversion mat4_to_mat4 replaced, kept as the reference its speedup is measured against
+    glm::mat4 mat4_to_mat4_element_wise(JPH::Mat44Arg mat4)
+    {
+        glm::mat4 out;
+        for (u32 row = 0; row < 4; row++) {
+            for (u32 col = 0; col < 4; col++) {
+                out[static_cast<int>(col)][static_cast<int>(row)] = mat4(row, col);
+            }
+        }
+        return out;
+    }
+
+    // Never destroyed, a System unregisters the Jolt types when it goes away
+    Physics::System& get_system()
+    {
+        static auto* system = new Physics::System();
+        return *system;
+    }
+
+    std::vector<JPH::BodyCreationSettings> make_cube_settings(u64 count)
+    {
+        const JPH::ShapeRefC box = new JPH::BoxShape(JPH::Vec3(0.5F, 0.5F, 0.5F));
+        std::vector<JPH::BodyCreationSettings> settings;
+        settings.reserve(count);
+        for (u64 i = 0; i < count; i++) {
+            const JPH::RVec3 position(static_cast<f32>(i % 256) * 2.0F, static_cast<f32>(i / 65536) * 2.0F, static_cast<f32>(i / 256 % 256) * 2.0F);
+            settings.emplace_back(box, position, JPH::Quat::sIdentity(), JPH::EMotionType::Dynamic, Physics::Layers::MOVING);
+        }
+        return settings;
+    }
+
+    // Spawning is timed together with removing the bodies again, both variants remove them the same way
+    void remove_bodies(Physics::System& system, std::vector<JPH::BodyID>& bodies)
+    {
+        system.m_body_interface->RemoveBodies(bodies.data(), static_cast<int>(bodies.size()));
+        system.m_body_interface->DestroyBodies(bodies.data(), static_cast<int>(bodies.size()));
+        bodies.clear();
+    }
+} // anonymous namespace
+
+void add_physics_benchmarks(Registry& registry)
+{
+    registry.emplace_back(Benchmark {
+        .name = "Physics::System::create_mesh_triangle_list_base_index",
+        .sizes = { 16, 128, 512 },
+        .function = [](Context& context) {
+            Renderer::Mesh mesh;
+            make_grid_mesh(mesh, context.get_size());
+            const glm::mat4 model = glm::scale(glm::mat4(1.0F), glm::vec3(0.1F));
+            context.set_items_per_iteration(mesh.m_indices.size() / 3);
+
+            context.measure([&]() {
+                JPH::TriangleList triangles;
+                Physics::System::create_mesh_triangle_list_base_index(triangles, model, &mesh);
+                do_not_optimize(triangles.size());
+            });
+        },
+    });
+
+    registry.emplace_back(Benchmark {
+        .name = "Physics::System::create_mesh_indexed_triangle_list",
+        .sizes = { 16, 128, 512 },
+        .function = [](Context& context) {
+            Renderer::Mesh mesh;
+            make_grid_mesh(mesh, context.get_size());
+            const glm::mat4 model = glm::scale(glm::mat4(1.0F), glm::vec3(0.1F));
+            context.set_items_per_iteration(mesh.m_indices.size() / 3);
+
+            context.measure([&]() {
+                JPH::VertexList vertices;
+                JPH::IndexedTriangleList triangles;
+                Physics::System::create_mesh_indexed_triangle_list(vertices, triangles, model, &mesh);
+                do_not_optimize(triangles.size());
+            });
+        },
+    });
+
+    registry.emplace_back(Benchmark {
+        .name = "Physics::System::create_mesh_indexed_triangle_list (welded)",
+        .sizes = { 16, 128, 512 },
+        .function = [](Context& context) {
+            Renderer::Mesh mesh;
+            make_grid_mesh(mesh, context.get_size());
+            const glm::mat4 model = glm::scale(glm::mat4(1.0F), glm::vec3(0.1F));
+            context.set_items_per_iteration(mesh.m_indices.size() / 3);
+
+            context.measure([&]() {
+                JPH::VertexList vertices;
+                JPH::IndexedTriangleList triangles;
+                Physics::System::create_mesh_indexed_triangle_list(vertices, triangles, model, &mesh, { .weld_distance = 0.001F });
+                do_not_optimize(triangles.size());
+            });
+        },
+    });
+
+    registry.emplace_back(Benchmark {
+        .name = "spawn bodies (CreateAndAddBody)",
+        .sizes = { 10000, 50000, 100000 },
+        .function = [](Context& context) {
+            Physics::System& system = get_system();
+            const auto settings = make_cube_settings(context.get_size());
+            std::vector<JPH::BodyID> bodies;
+
+            context.measure([&]() {
+                for (const JPH::BodyCreationSettings& body_settings : settings) {
+                    bodies.emplace_back(system.m_body_interface->CreateAndAddBody(body_settings, JPH::EActivation::Activate));
+                }
+                system.optimize();
+                remove_bodies(system, bodies);
+            });
+        },
+    });
+
+    registry.emplace_back(Benchmark {
+        .name = "spawn bodies (Physics::System::add_bodies)",
+        .sizes = { 10000, 50000, 100000 },
+        .function = [](Context& context) {
+            Physics::System& system = get_system();
+            const auto settings = make_cube_settings(context.get_size());
+            std::vector<JPH::BodyID> bodies;
+
+            context.measure([&]() {
+                system.add_bodies(settings, JPH::EActivation::Activate, bodies);
+                system.optimize();
+                remove_bodies(system, bodies);
+            });
+        },
+    });
+
+    registry.emplace_back(Benchmark {
+        .name = "Physics::QueryService::cast_rays",
+        .sizes = { 1000, 10000, 100000 },
+        .function = [](Context& context) {
+            Physics::System& system = get_system();
+
+            // 131072 triangles, rays come down from above on the first sub-mesh's 256 by 64 strip
+            Renderer::Mesh mesh;
+            make_grid_mesh(mesh, 256);
+            JPH::VertexList vertices;
+            JPH::IndexedTriangleList triangles;
+            Physics::System::create_mesh_indexed_triangle_list(vertices, triangles, glm::mat4(1.0F), &mesh);
+            std::vector<JPH::BodyID> bodies;
+            const JPH::BodyCreationSettings ground(
+                new JPH::MeshShapeSettings(vertices, triangles),
+                JPH::RVec3::sZero(), JPH::Quat::sIdentity(),
+                JPH::EMotionType::Static,
+                Physics::Layers::NON_MOVING);
+            system.add_bodies({ &ground, 1 }, JPH::EActivation::DontActivate, bodies);
+            system.optimize();
+
+            std::mt19937 random(1U);
+            std::uniform_real_distribution<f32> x(0.0F, 256.0F);
+            std::uniform_real_distribution<f32> z(0.0F, 64.0F);
+            std::vector<Physics::RayCast> rays;
+            for (u64 i = 0; i < context.get_size(); i++) {
+                rays.emplace_back(Physics::RayCast {
+                    .origin = glm::vec3(x(random), 10.0F, z(random)),
+                    .direction = glm::vec3(0.0F, -20.0F, 0.0F),
+                });
+            }
+            std::vector<Physics::QueryHit> hits(rays.size());
+
+            Physics::QueryService queries;
+            queries.init(system);
+            context.set_items_per_iteration(rays.size());
+
+            context.measure([&]() {
+                queries.cast_rays(rays, hits);
+                do_not_optimize(hits.back().fraction);
+            });
+
+            remove_bodies(system, bodies);
+        },
+    });
+
+    registry.emplace_back(Benchmark {
+        .name = "mat4_to_mat4 (element wise reference)",
+        .sizes = { 1024, 16384, 100000 },
+        .function = [](Context& context) {
+            const auto transforms = make_transforms(context.get_size());
+            std::vector<glm::mat4> models(transforms.size());
+            context.set_items_per_iteration(transforms.size());
+
+            context.measure([&]() {
+                for (usize i = 0; i < transforms.size(); i++) {
+                    models[i] = mat4_to_mat4_element_wise(transforms[i]);
+                }
+                do_not_optimize(models.back()[3][0]);
+            });
+        },
+    });
+
+    registry.emplace_back(Benchmark {
+        .name = "mat4_to_mat4",
+        .sizes = { 1024, 16384, 100000 },
+        .function = [](Context& context) {
+            const auto transforms = make_transforms(context.get_size());
+            std::vector<glm::mat4> models(transforms.size());
+            context.set_items_per_iteration(transforms.size());
+
+            context.measure([&]() {
+                for (usize i = 0; i < transforms.size(); i++) {
+                    models[i] = mat4_to_mat4(transforms[i]);
+                }
+                do_not_optimize(models.back()[3][0]);
+            });
+        },
+    });
+
+    registry.emplace_back(Benchmark {
+        .name = "mat4_to_mat4 (batch)",
+        .sizes = { 1024, 16384, 100000 },
+        .function = [](Context& context) {
+            const auto transforms = make_transforms(context.get_size());
+            std::vector<glm::mat4> models(transforms.size());
+            context.set_items_per_iteration(transforms.size());
+
+            context.measure([&]() {
+                mat4_to_mat4(transforms, models);
+                do_not_optimize(models.back()[3][0]);
+            });
+        },
+    });
+}
+
+} // namespace Microbench
@@ -0,0 +1,32 @@
+#include "microbench.hpp"
+
+#include "renderer.hpp"
+
+namespace Microbench {
+
+void add_renderer_benchmarks(Registry& registry)
+{
+    // One frustum per shadow cascade or light in practice, size of them per iteration
+    registry.emplace_back(Benchmark {
+        .name = "Renderer::Frustum::init",
+        .sizes = { 1, 64, 1024 },
+        .function = [](Context& context) {
+            std::vector<glm::mat4> view_projs;
+            for (u64 i = 0; i < context.get_size(); i++) {
+                const f32 angle = static_cast<f32>(i) * 0.01F;
+                const glm::mat4 view = glm::lookAt(glm::vec3(std::cos(angle), 1.0F, std::sin(angle)) * 10.0F, glm::vec3(0.0F), glm::vec3(0.0F, 1.0F, 0.0F));
+                view_projs.emplace_back(glm::perspective(glm::radians(90.0F), 16.0F / 9.0F, 0.1F, 1000.0F) * view);
+            }
+            std::vector<Renderer::Frustum> frustums(view_projs.size());
+
+            context.measure([&]() {
+                for (usize i = 0; i < view_projs.size(); i++) {
+                    frustums[i].init(view_projs[i]);
+                }
+                do_not_optimize(frustums.back().near_face.get_distance());
+            });
+        },
+    });
+}
+
+} // namespace Microbench
@@ -0,0 +1,64 @@
+#include "microbench.hpp"
+
+#include "../scene/shader_preprocessor.hpp"
+
+namespace Microbench {
+
+namespace {
+    // Shader text with block_count %Preprocess% blocks, every other one enabled
+    std::string make_preprocessor_text(u64 block_count)
+    {
+        std::string text = "#version 460 core\n";
+        for (u64 i = 0; i < block_count; i++) {
+            text += std::format("vec3 value_{} = vec3(0.0);\n", i);
+            text += std::format("%Preprocess% if Condition{}\n", i % 2);
+            text += std::format("    value_{} += texture(tex_diffuse, TexCoords).rgb;\n", i);
+            text += "%Preprocess% endif\n";
+        }
+        return text;
+    }
+
+    // Sections of line_count lines each, like the shader files scene_shaders.hpp cuts up
+    std::string make_delimited_text(u64 line_count)
+    {
+        std::string text;
+        for (const char* section : { "Vertex", "Fragment", "PBR Functions" }) {
+            text += std::format("// {} Begin\n", section);
+            for (u64 i = 0; i < line_count; i++) {
+                text += std::format("    float line_{} = {}.0;\n", i, i);
+            }
+            text += std::format("// {} End\n", section);
+        }
+        return text;
+    }
+} // anonymous namespace
+
+void add_scene_benchmarks(Registry& registry)
+{
+    registry.emplace_back(Benchmark {
+        .name = "ShaderPreprocessor::process",
+        .sizes = { 4, 64, 1024 },
+        .function = [](Context& context) {
+            const std::string text = make_preprocessor_text(context.get_size());
+
+            context.measure([&]() {
+                ShaderPreprocessor preprocessor(text, { "Condition0" });
+                do_not_optimize(preprocessor.process().size());
+            });
+        },
+    });
+
+    registry.emplace_back(Benchmark {
+        .name = "get_lines_between_delims",
+        .sizes = { 64, 1024, 16384 },
+        .function = [](Context& context) {
+            const std::string text = make_delimited_text(context.get_size());
+
+            context.measure([&]() {
+                do_not_optimize(get_lines_between_delims(text, "// Fragment Begin", "// Fragment End").size());
+            });
+        },
+    });
+}
+
+} // namespace Microbench
@@ -0,0 +1,107 @@
+#include "microbench.hpp"
+
+#include "../utils/cache.hpp"
+#include "../utils/job_system.hpp"
+
+namespace Microbench {
+
+namespace {
+    std::vector<std::string> make_keys(u64 count)
+    {
+        std::vector<std::string> keys;
+        keys.reserve(count);
+        for (u64 i = 0; i < count; i++) {
+            keys.emplace_back(std::format("res/models/model_{}/model_{}.gltf", i, i));
+        }
+        return keys;
+    }
+
+    // Stops the engine's shared workers while a benchmark runs its own pool, otherwise both pools
+    // compete for the cores and the scaling numbers measure oversubscription
+    class SharedJobsStopped : public NoCopyNoMove {
+    public:
+        SharedJobsStopped()
+            : m_was_running(Utils::Jobs::is_initialized())
+        {
+            if (m_was_running) {
+                Utils::Jobs::shutdown();
+            }
+        }
+
+        ~SharedJobsStopped()
+        {
+            if (m_was_running) {
+                Utils::Jobs::init();
+            }
+        }
+
+    private:
+        bool m_was_running;
+    };
+} // anonymous namespace
+
+void add_utils_benchmarks(Registry& registry)
+{
+    // Hits on a cache holding size entries, the way Scene looks models up by path
+    registry.emplace_back(Benchmark {
+        .name = "Utils::Cache::get_or_create",
+        .sizes = { 16, 256, 4096 },
+        .function = [](Context& context) {
+            const std::vector<std::string> keys = make_keys(context.get_size());
+            Utils::Cache<std::string, std::string> cache;
+            for (const auto& key : keys) {
+                cache.get_or_create(key, key);
+            }
+
+            context.measure([&]() {
+                for (const auto& key : keys) {
+                    do_not_optimize(cache.get_or_create(key, key).size());
+                }
+            });
+        },
+    });
+
+    registry.emplace_back(Benchmark {
+        .name = "Utils::Mapping::map",
+        .sizes = { 16, 256, 4096, 65536 },
+        .function = [](Context& context) {
+            const std::vector<std::string> keys = make_keys(context.get_size());
+            Utils::Mapping<std::string> mapping;
+            for (const auto& key : keys) {
+                do_not_optimize(mapping.map(key));
+            }
+
+            context.measure([&]() {
+                for (const auto& key : keys) {
+                    do_not_optimize(mapping.map(key));
+                }
+            });
+        },
+    });
+    // The same work spread over size workers, shows how far the job system scales
+    registry.emplace_back(Benchmark {
+        .name = "Utils::JobSystem::parallel_for",
+        .sizes = { 1, 2, 4, 8, 16 },
+        .function = [](Context& context) {
+            constexpr u32 TASKS = 1024;
+            constexpr u32 STEPS_PER_TASK = 4096;
+            const SharedJobsStopped shared_jobs_stopped;
+            Utils::JobSystem job_system(static_cast<u32>(context.get_size()));
+            std::vector<f32> results(TASKS);
+            context.set_items_per_iteration(TASKS);
+
+            context.measure([&]() {
+                job_system.parallel_for(TASKS, [&](u32 task) {
+                    f32 value = static_cast<f32>(task);
+                    for (u32 step = 0; step < STEPS_PER_TASK; step++) {
+                        value = std::sqrt(value + static_cast<f32>(step));
+                    }
+                    results[task] = value;
+                });
+                do_not_optimize(results.back());
+            });
+        },
+    });
+}
+
+} // namespace Microbench
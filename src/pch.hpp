@@ -29,19 +29,27 @@
 #include "utils/file.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdlib>
 #include <functional>
+#include <mutex>
 #include <print>
+#include <thread>
 
 #include <array>
+#include <bit>
 #include <cmath>
 #include <cstdint>
 #include <deque>
 #include <numbers>
+#include <optional>
 #include <random>
+#include <span>
 #include <stdexcept>
 #include <stdfloat>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -56,3 +64,6 @@ using i32 = int32_t;
 using i64 = int64_t;
 using f32 = float;
 using f64 = double;
+
+#include "utils/profiler.hpp"
+#include "utils/flight_recorder.hpp"
@@ -0,0 +1,108 @@
+#include "collision_cache.hpp"
+
+#include <Jolt/Core/HashCombine.h>
+#include <Jolt/Core/StreamWrapper.h>
+
+namespace Physics::CollisionCache {
+
+namespace {
+    constexpr u32 MAGIC = 0x4C4F4352; // "RCOL"
+    // Bump when the layout changes or Jolt's shape serialization does
+    constexpr u32 VERSION = 1;
+
+    struct Header {
+        u32 magic = MAGIC;
+        u32 version = VERSION;
+        u64 hash = 0;
+        // How long cooking took, reported when a later run skips it
+        f64 cook_ms = 0.0;
+    };
+
+    f64 elapsed_ms(i64 begin_ns)
+    {
+        return static_cast<f64>(Utils::Profiler::now_ns() - begin_ns) / 1'000'000.0;
+    }
+
+    JPH::ShapeRefC load(const std::string& cache_path, u64 hash)
+    {
+        std::ifstream file(cache_path, std::ios::in | std::ios::binary);
+        if (!file) {
+            return nullptr;
+        }
+
+        const i64 begin_ns = Utils::Profiler::now_ns();
+        JPH::StreamInWrapper stream(file);
+        Header header;
+        stream.Read(header);
+        if (stream.IsFailed() || header.magic != MAGIC || header.version != VERSION || header.hash != hash) {
+            LOG_INFO(std::format("Collision cache \"{}\" is stale, cooking again", cache_path));
+            return nullptr;
+        }
+
+        JPH::Shape::IDToShapeMap shapes;
+        JPH::Shape::IDToMaterialMap materials;
+        JPH::Shape::ShapeResult result = JPH::Shape::sRestoreWithChildren(stream, shapes, materials);
+        if (result.HasError()) {
+            LOG_WARN(std::format("Collision cache \"{}\" could not be restored: {}", cache_path, result.GetError().c_str()));
+            return nullptr;
+        }
+
+        const f64 load_ms = elapsed_ms(begin_ns);
+        LOG_INFO(std::format("Loaded collision cache \"{}\" in {:.1f} ms, saved {:.1f} ms of cooking", cache_path, load_ms, header.cook_ms - load_ms));
+        return result.Get();
+    }
+
+    void save(const std::string& cache_path, const JPH::Shape& shape, const Header& header)
+    {
+        std::ofstream file(cache_path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file) {
+            LOG_WARN(std::format("could not write collision cache \"{}\"", cache_path));
+            return;
+        }
+
+        JPH::StreamOutWrapper stream(file);
+        stream.Write(header);
+        JPH::Shape::ShapeToIDMap shapes;
+        JPH::Shape::MaterialToIDMap materials;
+        shape.SaveWithChildren(stream, shapes, materials);
+        if (stream.IsFailed()) {
+            LOG_WARN(std::format("could not write collision cache \"{}\"", cache_path));
+        }
+    }
+
+    JPH::ShapeRefC get_or_cook(const std::string& cache_path, u64 hash, usize triangle_count, const std::function<JPH::ShapeSettings::ShapeResult()>& cook)
+    {
+        if (JPH::ShapeRefC shape = load(cache_path, hash); shape != nullptr) {
+            return shape;
+        }
+
+        const i64 begin_ns = Utils::Profiler::now_ns();
+        JPH::ShapeSettings::ShapeResult result = cook();
+        util_assert(!result.HasError(), std::format("Failed to cook mesh shape for \"{}\": {}", cache_path, result.GetError().c_str()));
+
+        const Header header { .hash = hash, .cook_ms = elapsed_ms(begin_ns) };
+        LOG_INFO(std::format("Cooked mesh shape with {} triangles in {:.1f} ms", triangle_count, header.cook_ms));
+        save(cache_path, *result.Get(), header);
+
+        return result.Get();
+    }
+} // anonymous namespace
+
+[[nodiscard]] JPH::ShapeRefC get_or_create_mesh_shape(const std::string& cache_path, const JPH::TriangleList& triangles)
+{
+    PROFILE_SCOPE("Physics::CollisionCache::get_or_create_mesh_shape");
+
+    const u64 hash = JPH::HashBytes(triangles.data(), static_cast<JPH::uint>(triangles.size() * sizeof(JPH::Triangle)));
+    return get_or_cook(cache_path, hash, triangles.size(), [&]() { return JPH::MeshShapeSettings(triangles).Create(); });
+}
+
+[[nodiscard]] JPH::ShapeRefC get_or_create_mesh_shape(const std::string& cache_path, const JPH::VertexList& vertices, const JPH::IndexedTriangleList& triangles)
+{
+    PROFILE_SCOPE("Physics::CollisionCache::get_or_create_mesh_shape");
+
+    const u64 hash = JPH::HashBytes(triangles.data(), static_cast<JPH::uint>(triangles.size() * sizeof(JPH::IndexedTriangle)),
+        JPH::HashBytes(vertices.data(), static_cast<JPH::uint>(vertices.size() * sizeof(JPH::Float3))));
+    return get_or_cook(cache_path, hash, triangles.size(), [&]() { return JPH::MeshShapeSettings(vertices, triangles).Create(); });
+}
+
+} // namespace Physics::CollisionCache
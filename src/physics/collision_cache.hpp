@@ -0,0 +1,13 @@
+#pragma once
+
+#include "engine.hpp"
+
+namespace Physics::CollisionCache {
+
+// Cooks triangles into a mesh shape and saves it to cache_path, later calls with the same
+// triangles load the saved shape instead of building the BVH again. The key is a hash of the
+// triangles, which are already in world space, so a changed mesh or transform cooks it again
+[[nodiscard]] JPH::ShapeRefC get_or_create_mesh_shape(const std::string& cache_path, const JPH::TriangleList& triangles);
+[[nodiscard]] JPH::ShapeRefC get_or_create_mesh_shape(const std::string& cache_path, const JPH::VertexList& vertices, const JPH::IndexedTriangleList& triangles);
+
+} // namespace Physics::CollisionCache
@@ -2,11 +2,57 @@
 
 #include "helpers.hpp"
 
+#include "../utils/job_system.hpp"
+
+#include <Jolt/Core/HashCombine.h>
+
 namespace Physics {
 
 namespace {
-    JPH::JobSystemThreadPool* s_job_system = nullptr;
-}
+    // Vertices transformed by one job
+    constexpr usize VERTICES_PER_JOB = 16384;
+
+    struct CellHash {
+        usize operator()(const glm::ivec3& cell) const
+        {
+            return JPH::HashBytes(&cell, sizeof(cell));
+        }
+    };
+
+    // Snaps vertices to a grid with cells distance wide, the first vertex landing in a cell stands
+    // in for all of them. Triangles left with fewer than three distinct corners are dropped
+    void weld(JPH::VertexList& vertices, JPH::IndexedTriangleList& triangles, f32 distance)
+    {
+        PROFILE_SCOPE("Physics::weld");
+
+        std::unordered_map<glm::ivec3, u32, CellHash> cells;
+        cells.reserve(vertices.size());
+        std::vector<u32> remap(vertices.size());
+        JPH::VertexList welded;
+        welded.reserve(vertices.size());
+        for (usize i = 0; i < vertices.size(); i++) {
+            const JPH::Float3& vertex = vertices[i];
+            const glm::ivec3 cell(glm::floor(glm::vec3(vertex.x, vertex.y, vertex.z) / distance));
+            auto [it, inserted] = cells.try_emplace(cell, static_cast<u32>(welded.size()));
+            if (inserted) {
+                welded.push_back(vertex);
+            }
+            remap[i] = it->second;
+        }
+
+        usize kept = 0;
+        for (const JPH::IndexedTriangle& triangle : triangles) {
+            const u32 i1 = remap[triangle.mIdx[0]];
+            const u32 i2 = remap[triangle.mIdx[1]];
+            const u32 i3 = remap[triangle.mIdx[2]];
+            if (i1 != i2 && i2 != i3 && i1 != i3) {
+                triangles[kept++] = JPH::IndexedTriangle(i1, i2, i3, triangle.mMaterialIndex);
+            }
+        }
+        triangles.resize(kept);
+        vertices.swap(welded);
+    }
+} // anonymous namespace
 
 namespace Engine {
 
@@ -15,13 +61,15 @@ namespace Engine {
         JPH::RegisterDefaultAllocator();
         JPH::Factory::sInstance = new JPH::Factory();
         JPH::RegisterTypes();
-        s_job_system = new JPH::JobSystemThreadPool(JPH::cMaxPhysicsJobs, JPH::cMaxPhysicsBarriers, std::thread::hardware_concurrency() - 1);
+        Utils::Profiler::install_jolt_hooks();
+
+        // The engine's job system allocates its jobs through Jolt, so it starts here
+        Utils::Jobs::init();
     }
 
     void cleanup_singletons()
     {
-        delete s_job_system;
-        s_job_system = nullptr;
+        Utils::Jobs::shutdown();
 
         delete JPH::Factory::sInstance;
         JPH::Factory::sInstance = nullptr;
@@ -29,7 +77,8 @@ namespace Engine {
 
 } // namespace Engine
 
-System::System()
+System::System(const SystemSettings& settings)
+    : m_temp_allocator(settings.temp_allocator_size)
 {
     m_physics_system.Init(cMaxBodies, cNumBodyMutexes, cMaxBodyPairs, cMaxContactConstraints, m_broad_phase_layer_interface, m_object_vs_broadphase_layer_filter, m_object_vs_object_layer_filter);
     m_body_interface = &m_physics_system.GetBodyInterface();
@@ -37,8 +86,7 @@ System::System()
 
 System::~System()
 {
-    m_body_interface->RemoveBodies(m_bodies.data(), m_bodies.size());
-    m_body_interface->DestroyBodies(m_bodies.data(), m_bodies.size());
+    // Bodies belong to whoever created them, Scene destroys its own through the registry
 
     // Unregisters all types with the factory and cleans up the default material
     JPH::UnregisterTypes();
@@ -46,13 +94,16 @@ System::~System()
 
 void System::update(float delta_time)
 {
+    PROFILE_SCOPE("Physics::System::update");
+
     // If you take larger steps than 1 / 60th of a second you
     // need to do multiple collision steps in order to keep the simulation stable.
     // Do 1 collision step per 1 / 60th of a second (round up).
     // For some reason I have to cap it at a number or it will segfault the program
     const int collision_steps = std::min(std::max(static_cast<int>(std::ceil(delta_time / (1.0f / 60.0f))), 1), 10);
 
-    m_physics_system.Update(delta_time, collision_steps, &m_temp_allocator, s_job_system);
+    m_physics_system.Update(delta_time, collision_steps, &m_temp_allocator, &Utils::Jobs::get());
+    m_temp_allocator.end_step();
 }
 
 void System::create_mesh_triangle_list(JPH::TriangleList& triangles, const std::deque<Renderer::Mesh>* meshes)
@@ -84,9 +135,9 @@ void System::create_mesh_triangle_list(JPH::TriangleList& triangles, const glm::
         glm::vec3 v3;
         u32 j = 0;
         while (j + 2 < mesh->m_indices.size()) {
-            v1 = glm::vec4(mesh->m_vertices[mesh->m_indices.at(j + 0)].m_pos, 1.0F) * model;
-            v2 = glm::vec4(mesh->m_vertices[mesh->m_indices.at(j + 1)].m_pos, 1.0F) * model;
-            v3 = glm::vec4(mesh->m_vertices[mesh->m_indices.at(j + 2)].m_pos, 1.0F) * model;
+            v1 = model * glm::vec4(mesh->m_vertices[mesh->m_indices.at(j + 0)].m_pos, 1.0F);
+            v2 = model * glm::vec4(mesh->m_vertices[mesh->m_indices.at(j + 1)].m_pos, 1.0F);
+            v3 = model * glm::vec4(mesh->m_vertices[mesh->m_indices.at(j + 2)].m_pos, 1.0F);
             j += 3;
 
             JPH::Triangle triangle(vec3_to_float3(v1), vec3_to_float3(v2), vec3_to_float3(v3));
@@ -132,9 +183,9 @@ void System::create_mesh_triangle_list_base_index(JPH::TriangleList& triangles,
         auto count = mesh->m_base_vertices[i].m_count;
         u32 j = offset;
         while (j + 2 < count + offset) {
-            v1 = glm::vec4(mesh->m_vertices[mesh->m_indices.at(j + 0) + base].m_pos, 1.0F) * model;
-            v2 = glm::vec4(mesh->m_vertices[mesh->m_indices.at(j + 1) + base].m_pos, 1.0F) * model;
-            v3 = glm::vec4(mesh->m_vertices[mesh->m_indices.at(j + 2) + base].m_pos, 1.0F) * model;
+            v1 = model * glm::vec4(mesh->m_vertices[mesh->m_indices.at(j + 0) + base].m_pos, 1.0F);
+            v2 = model * glm::vec4(mesh->m_vertices[mesh->m_indices.at(j + 1) + base].m_pos, 1.0F);
+            v3 = model * glm::vec4(mesh->m_vertices[mesh->m_indices.at(j + 2) + base].m_pos, 1.0F);
             j += 3;
 
             JPH::Triangle triangle(vec3_to_float3(v1), vec3_to_float3(v2), vec3_to_float3(v3));
@@ -145,9 +196,100 @@ void System::create_mesh_triangle_list_base_index(JPH::TriangleList& triangles,
     }
 }
 
+void System::create_mesh_indexed_triangle_list(JPH::VertexList& vertices, JPH::IndexedTriangleList& triangles, const glm::mat4& model, const Renderer::Mesh* mesh, const MeshBuildSettings& settings)
+{
+    PROFILE_SCOPE("Physics::System::create_mesh_indexed_triangle_list");
+
+    const JPH::Mat44 transform = mat4_to_mat44(model);
+    const usize vertex_count = mesh->m_vertices.size();
+    vertices.resize(vertex_count);
+    Utils::Jobs::get().parallel_for(static_cast<u32>((vertex_count + VERTICES_PER_JOB - 1) / VERTICES_PER_JOB), [&](u32 job) {
+        const usize end = std::min((job + 1) * VERTICES_PER_JOB, vertex_count);
+        for (usize i = job * VERTICES_PER_JOB; i < end; i++) {
+            const glm::vec3& position = mesh->m_vertices[i].m_pos;
+            (transform * JPH::Vec3(position.x, position.y, position.z)).StoreFloat3(&vertices[i]);
+        }
+    });
+
+    // Every sub-mesh fills its own range of the output, so the jobs never touch the same triangles
+    const usize sub_mesh_count = mesh->m_base_vertices.size();
+    std::vector<usize> first_triangles(sub_mesh_count + 1, 0);
+    for (usize i = 0; i < sub_mesh_count; i++) {
+        first_triangles[i + 1] = first_triangles[i] + static_cast<usize>(mesh->m_base_vertices[i].m_count) / 3;
+    }
+    triangles.resize(first_triangles.back());
+    Utils::Jobs::get().parallel_for(static_cast<u32>(sub_mesh_count), [&](u32 sub_mesh) {
+        const Renderer::Mesh::BaseVertex& base_vertex = mesh->m_base_vertices[sub_mesh];
+        const GLuint* indices = mesh->m_indices.data() + base_vertex.m_offset;
+        const auto base = static_cast<u32>(base_vertex.m_base);
+        const usize first = first_triangles[sub_mesh];
+        for (usize i = 0; i < first_triangles[sub_mesh + 1] - first; i++) {
+            triangles[first + i] = JPH::IndexedTriangle(indices[i * 3] + base, indices[i * 3 + 1] + base, indices[i * 3 + 2] + base, 0);
+        }
+    });
+
+    if (settings.weld_distance > 0.0F) {
+        weld(vertices, triangles, settings.weld_distance);
+    }
+}
+
+void System::add_bodies(std::span<const JPH::BodyCreationSettings> settings, JPH::EActivation activation, std::vector<JPH::BodyID>& bodies)
+{
+    PROFILE_SCOPE("Physics::System::add_bodies");
+
+    const usize first = bodies.size();
+    bodies.reserve(first + settings.size());
+    for (const JPH::BodyCreationSettings& body_settings : settings) {
+        JPH::Body* body = m_body_interface->CreateBody(body_settings);
+        util_assert(body != nullptr, "Physics::System is out of bodies");
+        bodies.emplace_back(body->GetID());
+    }
+
+    for (usize begin = first; begin < bodies.size(); begin += ADD_BATCH_SIZE) {
+        const usize count = std::min(ADD_BATCH_SIZE, bodies.size() - begin);
+        m_add_batch.assign(bodies.data() + begin, bodies.data() + begin + count);
+
+        JPH::BodyInterface::AddState state = m_body_interface->AddBodiesPrepare(m_add_batch.data(), static_cast<int>(count));
+        m_body_interface->AddBodiesFinalize(m_add_batch.data(), static_cast<int>(count), state, activation);
+
+        // Batches still land in the tree as separate nodes, rebuilding it now and then keeps queries fast
+        m_bodies_since_optimize += count;
+        if (m_bodies_since_optimize >= OPTIMIZE_AFTER_BODIES) {
+            optimize();
+        }
+    }
+}
+
 void System::optimize()
 {
+    PROFILE_SCOPE("Physics::System::optimize");
     m_physics_system.OptimizeBroadPhase();
+    m_bodies_since_optimize = 0;
+}
+
+void System::get_active_bodies(JPH::BodyIDVector& bodies) const
+{
+    m_physics_system.GetActiveBodies(JPH::EBodyType::RigidBody, bodies);
+}
+
+[[nodiscard]] const JPH::BodyLockInterface& System::get_body_lock_interface() const
+{
+    return m_physics_system.GetBodyLockInterface();
+}
+
+[[nodiscard]] const TempAllocator& System::get_temp_allocator() const
+{
+    return m_temp_allocator;
+}
+
+[[nodiscard]] const JPH::NarrowPhaseQuery& System::get_narrow_phase_query() const
+{
+    return m_physics_system.GetNarrowPhaseQueryNoLock();
+}
+
+[[nodiscard]] const JPH::BodyInterface& System::get_body_interface_no_lock() const
+{
+    return m_physics_system.GetBodyInterfaceNoLock();
 }
 
 } // namespace Physics
\ No newline at end of file
@@ -1,13 +1,14 @@
 #pragma once
 
 #include "../renderer/mesh.hpp"
+#include "temp_allocator.hpp"
 
 #include <Jolt/Core/Factory.h>
-#include <Jolt/Core/JobSystemThreadPool.h>
-#include <Jolt/Core/TempAllocator.h>
+#include <Jolt/Geometry/IndexedTriangle.h>
 #include <Jolt/Geometry/Triangle.h>
 #include <Jolt/Physics/Body/BodyActivationListener.h>
 #include <Jolt/Physics/Body/BodyCreationSettings.h>
+#include <Jolt/Physics/Body/BodyLockMulti.h>
 #include <Jolt/Physics/Collision/Shape/BoxShape.h>
 #include <Jolt/Physics/Collision/Shape/MeshShape.h>
 #include <Jolt/Physics/Collision/Shape/SphereShape.h>
@@ -111,9 +112,21 @@ namespace Engine {
     void cleanup_singletons();
 }
 
+struct MeshBuildSettings {
+    // Vertices closer than this become one, 0 keeps them all. Larger values decimate the mesh by
+    // clustering its vertices
+    f32 weld_distance = 0.0F;
+};
+
+struct SystemSettings {
+    // Starting size of the arena Jolt's per step scratch memory comes from, it grows past the
+    // largest step that did not fit
+    usize temp_allocator_size = 10 * 1024 * 1024;
+};
+
 class System : public NoCopyNoMove {
 public:
-    System();
+    explicit System(const SystemSettings& settings = {});
     ~System();
 
     void update(float delta_time);
@@ -124,17 +137,36 @@ public:
     static void create_mesh_triangle_list_base_index(JPH::TriangleList& triangles, const Renderer::Mesh* mesh);
     static void create_mesh_triangle_list_base_index(JPH::TriangleList& triangles, const glm::mat4& model, const Renderer::Mesh* mesh);
 
+    // Shares vertices the way the mesh does instead of copying three per triangle. Vertices are
+    // transformed and sub-meshes filled in parallel on the engine's job system
+    static void create_mesh_indexed_triangle_list(JPH::VertexList& vertices, JPH::IndexedTriangleList& triangles, const glm::mat4& model, const Renderer::Mesh* mesh, const MeshBuildSettings& settings = {});
+
+    // Creates the bodies and adds them to the broadphase in batches instead of one at a time,
+    // optimizing it again every OPTIMIZE_AFTER_BODIES. Ids are appended in the order of settings
+    void add_bodies(std::span<const JPH::BodyCreationSettings> settings, JPH::EActivation activation, std::vector<JPH::BodyID>& bodies);
+
     void optimize();
 
+    // Rigid bodies that are awake, sleeping ones have not moved since they fell asleep
+    void get_active_bodies(JPH::BodyIDVector& bodies) const;
+    [[nodiscard]] const JPH::BodyLockInterface& get_body_lock_interface() const;
+    [[nodiscard]] const TempAllocator& get_temp_allocator() const;
+    // Neither locks the bodies
+    [[nodiscard]] const JPH::NarrowPhaseQuery& get_narrow_phase_query() const;
+    [[nodiscard]] const JPH::BodyInterface& get_body_interface_no_lock() const;
+
     JPH::BodyInterface* m_body_interface = nullptr;
-    // TODO delete this
-    // Deletion list
-    std::vector<JPH::BodyID> m_bodies;
+
+    static constexpr usize ADD_BATCH_SIZE = 4096;
+    static constexpr usize OPTIMIZE_AFTER_BODIES = 16384;
 
 private:
-    JPH::TempAllocatorMalloc m_temp_allocator;
+    TempAllocator m_temp_allocator;
+    usize m_bodies_since_optimize = 0;
+    // AddBodiesPrepare() sorts the ids it is given, the caller's order is kept here
+    std::vector<JPH::BodyID> m_add_batch;
 
-    const uint cMaxBodies = 65536;
+    const uint cMaxBodies = 262144;
     const uint cNumBodyMutexes = 0;
     const uint cMaxBodyPairs = 65536;
     const uint cMaxContactConstraints = 10240;
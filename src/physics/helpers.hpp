@@ -15,27 +15,34 @@ static constexpr JPH::DVec3 vec3_to_dvec3(glm::vec3 vec)
     return { static_cast<double>(vec.x), static_cast<double>(vec.y), static_cast<double>(vec.z) };
 }
 
-static constexpr glm::mat4 mat4_to_mat4(JPH::Mat44 mat4)
+// Both are four float columns, so Jolt stores its vector registers straight into glm's layout
+static_assert(sizeof(glm::mat4) == sizeof(JPH::Float4) * 4);
+
+static inline glm::mat4 mat4_to_mat4(JPH::Mat44Arg mat4)
 {
     glm::mat4 out;
-    for (u32 row = 0; row < 4; row++) {
-        for (u32 col = 0; col < 4; col++) {
-            out[static_cast<int>(col)][static_cast<int>(row)] = mat4(row, col);
-        }
-    }
-
+    mat4.StoreFloat4x4(reinterpret_cast<JPH::Float4*>(glm::value_ptr(out)));
     return out;
 }
 
-static constexpr glm::mat4 mat4_to_mat4(JPH::DMat44 dmat4)
+static inline glm::mat4 mat4_to_mat4(JPH::DMat44Arg dmat4)
 {
-    JPH::Mat44 mat4 = dmat4.ToMat44();
-    glm::mat4 out;
-    for (u32 row = 0; row < 4; row++) {
-        for (u32 col = 0; col < 4; col++) {
-            out[static_cast<int>(col)][static_cast<int>(row)] = mat4(row, col);
-        }
-    }
+    return mat4_to_mat4(dmat4.ToMat44());
+}
 
-    return out;
+static inline JPH::Mat44 mat4_to_mat44(const glm::mat4& mat4)
+{
+    return JPH::Mat44::sLoadFloat4x4(reinterpret_cast<const JPH::Float4*>(glm::value_ptr(mat4)));
+}
+
+// Fills out with one model matrix per transform, ready to be uploaded as instance data
+static inline void mat4_to_mat4(std::span<const JPH::Mat44> transforms, std::span<glm::mat4> out)
+{
+    util_assert(out.size() >= transforms.size(), "mat4_to_mat4() got fewer matrices than transforms");
+
+    auto* columns = reinterpret_cast<JPH::Float4*>(out.data());
+    for (const JPH::Mat44& transform : transforms) {
+        transform.StoreFloat4x4(columns);
+        columns += 4;
+    }
 }
@@ -0,0 +1,228 @@
+#include "queries.hpp"
+
+#include "helpers.hpp"
+
+#include "../utils/job_system.hpp"
+
+#include <Jolt/Physics/Collision/CastResult.h>
+#include <Jolt/Physics/Collision/CollideShape.h>
+#include <Jolt/Physics/Collision/CollisionCollectorImpl.h>
+#include <Jolt/Physics/Collision/RayCast.h>
+#include <Jolt/Physics/Collision/ShapeCast.h>
+
+namespace Physics {
+
+namespace {
+    class BroadPhaseLayerMaskFilter final : public JPH::BroadPhaseLayerFilter {
+    public:
+        explicit BroadPhaseLayerMaskFilter(LayerMask layers)
+            : m_layers(layers)
+        {
+        }
+
+        [[nodiscard]] bool ShouldCollide(JPH::BroadPhaseLayer inLayer) const override
+        {
+            return (m_layers & layer_mask(static_cast<JPH::BroadPhaseLayer::Type>(inLayer))) != 0;
+        }
+
+    private:
+        LayerMask m_layers;
+    };
+
+    class ObjectLayerMaskFilter final : public JPH::ObjectLayerFilter {
+    public:
+        explicit ObjectLayerMaskFilter(LayerMask layers)
+            : m_layers(layers)
+        {
+        }
+
+        [[nodiscard]] bool ShouldCollide(JPH::ObjectLayer inLayer) const override
+        {
+            return (m_layers & layer_mask(inLayer)) != 0;
+        }
+
+    private:
+        LayerMask m_layers;
+    };
+
+    // Jolt's penetration axis points into the hit body
+    glm::vec3 get_normal(JPH::Vec3Arg penetration_axis)
+    {
+        const JPH::Vec3 normal = -penetration_axis.NormalizedOr(JPH::Vec3::sZero());
+        return { normal.GetX(), normal.GetY(), normal.GetZ() };
+    }
+
+    // Keeps the first contact with every body, Jolt reports the hits of a body one after another
+    class FirstHitPerBodyCollector final : public JPH::CollideShapeCollector {
+    public:
+        explicit FirstHitPerBodyCollector(std::vector<QueryHit>& hits)
+            : m_hits(hits)
+        {
+        }
+
+        void AddHit(const ResultType& inResult) override
+        {
+            if (m_count > 0 && m_hits.back().body == inResult.mBodyID2) {
+                return;
+            }
+            m_hits.emplace_back(QueryHit {
+                .body = inResult.mBodyID2,
+                .fraction = 0.0F,
+                .position = glm::vec3(inResult.mContactPointOn2.GetX(), inResult.mContactPointOn2.GetY(), inResult.mContactPointOn2.GetZ()),
+                .normal = get_normal(inResult.mPenetrationAxis),
+            });
+            m_count++;
+        }
+
+        [[nodiscard]] u32 get_count() const
+        {
+            return m_count;
+        }
+
+    private:
+        std::vector<QueryHit>& m_hits;
+        u32 m_count = 0;
+    };
+
+    [[nodiscard]] u32 get_job_count(usize query_count)
+    {
+        return static_cast<u32>((query_count + QueryService::QUERIES_PER_JOB - 1) / QueryService::QUERIES_PER_JOB);
+    }
+} // anonymous namespace
+
+QueryService::~QueryService()
+{
+    initialized = false;
+}
+
+void QueryService::init(const System& system)
+{
+    util_assert(initialized == false, "QueryService::init() has already been initialized");
+
+    m_narrow_phase = &system.get_narrow_phase_query();
+    m_bodies = &system.get_body_interface_no_lock();
+
+    initialized = true;
+}
+
+void QueryService::cast_rays(std::span<const RayCast> rays, std::span<QueryHit> hits)
+{
+    PROFILE_SCOPE("Physics::QueryService::cast_rays");
+    util_assert(initialized == true, "QueryService has not been initialized");
+    util_assert(hits.size() >= rays.size(), "QueryService::cast_rays() got fewer hits than rays");
+
+    Utils::Jobs::get().parallel_for(get_job_count(rays.size()), [&](u32 job) {
+        const usize end = std::min(rays.size(), static_cast<usize>(job + 1) * QUERIES_PER_JOB);
+        for (usize i = static_cast<usize>(job) * QUERIES_PER_JOB; i < end; i++) {
+            const RayCast& ray = rays[i];
+            QueryHit& hit = hits[i];
+            hit = QueryHit {};
+
+            JPH::RayCastResult result;
+            const JPH::RRayCast jolt_ray(JPH::RVec3(ray.origin.x, ray.origin.y, ray.origin.z), vec3_to_vec3(ray.direction));
+            if (m_narrow_phase->CastRay(jolt_ray, result, BroadPhaseLayerMaskFilter(ray.layers), ObjectLayerMaskFilter(ray.layers))) {
+                hit.body = result.mBodyID;
+                hit.entity = get_entity(result.mBodyID);
+                hit.fraction = result.mFraction;
+                hit.position = ray.origin + ray.direction * result.mFraction;
+            }
+        }
+    });
+}
+
+void QueryService::overlap_spheres(std::span<const SphereOverlap> spheres, OverlapResults& results)
+{
+    PROFILE_SCOPE("Physics::QueryService::overlap_spheres");
+    util_assert(initialized == true, "QueryService has not been initialized");
+
+    const u32 job_count = get_job_count(spheres.size());
+    if (m_job_hits.size() < job_count) {
+        m_job_hits.resize(job_count);
+    }
+    results.ranges.resize(spheres.size());
+
+    Utils::Jobs::get().parallel_for(job_count, [&](u32 job) {
+        std::vector<QueryHit>& job_hits = m_job_hits[job];
+        job_hits.clear();
+
+        const JPH::CollideShapeSettings settings;
+        const usize end = std::min(spheres.size(), static_cast<usize>(job + 1) * QUERIES_PER_JOB);
+        for (usize i = static_cast<usize>(job) * QUERIES_PER_JOB; i < end; i++) {
+            const SphereOverlap& overlap = spheres[i];
+
+            // Lives on the stack, the reference count must never free it
+            JPH::SphereShape sphere(overlap.radius);
+            sphere.SetEmbedded();
+
+            // Offsets are local to the job until the hits are gathered below
+            FirstHitPerBodyCollector collector(job_hits);
+            const auto offset = static_cast<u32>(job_hits.size());
+            m_narrow_phase->CollideShape(&sphere,
+                JPH::Vec3::sReplicate(1.0F),
+                JPH::RMat44::sTranslation(JPH::RVec3(overlap.center.x, overlap.center.y, overlap.center.z)),
+                settings,
+                JPH::RVec3::sZero(),
+                collector,
+                BroadPhaseLayerMaskFilter(overlap.layers),
+                ObjectLayerMaskFilter(overlap.layers));
+            results.ranges[i] = OverlapResults::Range { .offset = offset, .count = collector.get_count() };
+        }
+        for (QueryHit& hit : job_hits) {
+            hit.entity = get_entity(hit.body);
+        }
+    });
+
+    results.hits.clear();
+    for (u32 job = 0; job < job_count; job++) {
+        const auto job_offset = static_cast<u32>(results.hits.size());
+        const usize end = std::min(spheres.size(), static_cast<usize>(job + 1) * QUERIES_PER_JOB);
+        for (usize i = static_cast<usize>(job) * QUERIES_PER_JOB; i < end; i++) {
+            results.ranges[i].offset += job_offset;
+        }
+        results.hits.insert(results.hits.end(), m_job_hits[job].begin(), m_job_hits[job].end());
+    }
+}
+
+void QueryService::cast_shapes(std::span<const ShapeCast> casts, std::span<QueryHit> hits)
+{
+    PROFILE_SCOPE("Physics::QueryService::cast_shapes");
+    util_assert(initialized == true, "QueryService has not been initialized");
+    util_assert(hits.size() >= casts.size(), "QueryService::cast_shapes() got fewer hits than casts");
+
+    Utils::Jobs::get().parallel_for(get_job_count(casts.size()), [&](u32 job) {
+        const JPH::ShapeCastSettings settings;
+        const usize end = std::min(casts.size(), static_cast<usize>(job + 1) * QUERIES_PER_JOB);
+        for (usize i = static_cast<usize>(job) * QUERIES_PER_JOB; i < end; i++) {
+            const ShapeCast& cast = casts[i];
+            QueryHit& hit = hits[i];
+            hit = QueryHit {};
+
+            const JPH::RShapeCast jolt_cast = JPH::RShapeCast::sFromWorldTransform(cast.shape,
+                JPH::Vec3::sReplicate(1.0F),
+                JPH::RMat44(mat4_to_mat44(cast.transform)),
+                vec3_to_vec3(cast.direction));
+            JPH::ClosestHitCollisionCollector<JPH::CastShapeCollector> collector;
+            m_narrow_phase->CastShape(jolt_cast, settings, JPH::RVec3::sZero(), collector, BroadPhaseLayerMaskFilter(cast.layers), ObjectLayerMaskFilter(cast.layers));
+            if (collector.HadHit()) {
+                const JPH::ShapeCastResult& result = collector.mHit;
+                hit.body = result.mBodyID2;
+                hit.entity = get_entity(result.mBodyID2);
+                hit.fraction = result.mFraction;
+                hit.position = glm::vec3(result.mContactPointOn2.GetX(), result.mContactPointOn2.GetY(), result.mContactPointOn2.GetZ());
+                hit.normal = get_normal(result.mPenetrationAxis);
+            }
+        }
+    });
+}
+
+[[nodiscard]] bool QueryService::is_initialized() const
+{
+    return initialized;
+}
+
+[[nodiscard]] entt::entity QueryService::get_entity(JPH::BodyID body) const
+{
+    return user_data_to_entity(m_bodies->GetUserData(body));
+}
+
+} // namespace Physics
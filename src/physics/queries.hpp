@@ -0,0 +1,104 @@
+#pragma once
+
+#include "engine.hpp"
+
+#include <Jolt/Physics/Collision/BroadPhase/BroadPhaseLayer.h>
+#include <Jolt/Physics/Collision/ObjectLayer.h>
+
+namespace Physics {
+
+// One bit per object layer, the broadphase layers are numbered the same
+using LayerMask = u32;
+static constexpr LayerMask ALL_LAYERS = std::numeric_limits<LayerMask>::max();
+
+[[nodiscard]] static constexpr LayerMask layer_mask(JPH::ObjectLayer layer)
+{
+    return LayerMask(1) << layer;
+}
+
+// Bodies carry their entity in the user data, 0 is left for bodies without one
+[[nodiscard]] static constexpr u64 entity_to_user_data(entt::entity entity)
+{
+    return static_cast<u64>(entt::to_integral(entity)) + 1;
+}
+
+[[nodiscard]] static constexpr entt::entity user_data_to_entity(u64 user_data)
+{
+    return user_data == 0 ? entt::entity(entt::null) : static_cast<entt::entity>(user_data - 1);
+}
+
+struct RayCast {
+    glm::vec3 origin;
+    // Its length is how far the ray goes
+    glm::vec3 direction;
+    LayerMask layers = ALL_LAYERS;
+};
+
+struct SphereOverlap {
+    glm::vec3 center;
+    f32 radius;
+    LayerMask layers = ALL_LAYERS;
+};
+
+struct ShapeCast {
+    JPH::ShapeRefC shape;
+    // Where the shape starts, rotation and translation only
+    glm::mat4 transform;
+    glm::vec3 direction;
+    LayerMask layers = ALL_LAYERS;
+};
+
+struct QueryHit {
+    // Invalid when nothing was hit
+    JPH::BodyID body;
+    entt::entity entity = entt::null;
+    // Along the ray or cast, 0 for overlaps
+    f32 fraction = 1.0F;
+    glm::vec3 position { 0.0F };
+    // Left at 0 for rays, finding it locks the body and picking does not need it
+    glm::vec3 normal { 0.0F };
+};
+
+struct OverlapResults {
+    struct Range {
+        u32 offset;
+        u32 count;
+    };
+
+    // Every body overlapping a sphere once, the hits of query i are ranges[i]
+    std::vector<QueryHit> hits;
+    std::vector<Range> ranges;
+};
+
+// Runs batches of scene queries against Jolt's narrow phase, QUERIES_PER_JOB at a time on the
+// engine's job system. Queries do not lock the bodies, so while a Simulation runs they have to
+// be made with its lock() held, same as anything else touching the bodies
+class QueryService : public NoCopyNoMove {
+public:
+    QueryService() = default;
+    ~QueryService();
+
+    void init(const System& system);
+
+    // Closest hit of every ray, hits has to be as long as rays
+    void cast_rays(std::span<const RayCast> rays, std::span<QueryHit> hits);
+    void overlap_spheres(std::span<const SphereOverlap> spheres, OverlapResults& results);
+    // Closest hit of every cast, hits has to be as long as casts
+    void cast_shapes(std::span<const ShapeCast> casts, std::span<QueryHit> hits);
+
+    [[nodiscard]] bool is_initialized() const;
+
+    static constexpr u32 QUERIES_PER_JOB = 256;
+
+private:
+    [[nodiscard]] entt::entity get_entity(JPH::BodyID body) const;
+
+    bool initialized = false;
+    const JPH::NarrowPhaseQuery* m_narrow_phase = nullptr;
+    const JPH::BodyInterface* m_bodies = nullptr;
+
+    // Scratch for overlap_spheres(), every job fills its own
+    std::vector<std::vector<QueryHit>> m_job_hits;
+};
+
+} // namespace Physics
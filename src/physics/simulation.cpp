@@ -0,0 +1,289 @@
+#include "simulation.hpp"
+
+namespace Physics {
+
+namespace {
+    constexpr i64 NS_PER_SECOND = 1'000'000'000;
+    // A thread this far behind skips ahead instead of running steps back to back
+    constexpr i64 MAX_STEPS_BEHIND = 4;
+} // anonymous namespace
+
+Simulation::~Simulation()
+{
+    stop();
+    initialized = false;
+}
+
+void Simulation::init(System& system, u32 steps_per_second)
+{
+    util_assert(initialized == false, "Simulation::init() has already been initialized");
+
+    m_system = &system;
+    set_steps_per_second(steps_per_second);
+
+    initialized = true;
+}
+
+void Simulation::set_running(bool running)
+{
+    util_assert(initialized == true, "Simulation has not been initialized");
+
+    if (running && !m_thread.joinable()) {
+        m_thread = std::jthread([this](const std::stop_token& stop_token) { thread_main(stop_token); });
+    }
+    if (m_running.exchange(running) != running) {
+        // Taken so the thread can't miss the notify between its check and its wait
+        std::lock_guard lock(m_step_mutex);
+        m_running_changed.notify_all();
+    }
+}
+
+[[nodiscard]] bool Simulation::is_running() const
+{
+    return m_running.load();
+}
+
+void Simulation::stop()
+{
+    if (m_thread.joinable()) {
+        m_thread.request_stop();
+        m_thread.join();
+    }
+    m_running = false;
+}
+
+[[nodiscard]] std::unique_lock<std::mutex> Simulation::lock()
+{
+    return std::unique_lock(m_step_mutex);
+}
+
+[[nodiscard]] Simulation::Handle Simulation::add_body(JPH::BodyID body)
+{
+    return add_bodies(std::span(&body, 1));
+}
+
+[[nodiscard]] Simulation::Handle Simulation::add_bodies(std::span<const JPH::BodyID> bodies)
+{
+    util_assert(initialized == true, "Simulation has not been initialized");
+
+    const u32 first = static_cast<u32>(m_bodies.size());
+    m_states.clear();
+    for (const JPH::BodyID body : bodies) {
+        const u32 slot = static_cast<u32>(m_bodies.size());
+        m_bodies.emplace_back(body);
+        if (body.GetIndex() >= m_body_slots.size()) {
+            m_body_slots.resize(body.GetIndex() + 1, INVALID_SLOT);
+        }
+        m_body_slots[body.GetIndex()] = slot;
+        m_states.emplace_back(read_body(body));
+    }
+
+    // Both snapshots get the bodies where they start so they are drawn before the first step
+    std::lock_guard lock(m_snapshot_mutex);
+    m_previous.bodies.resize(first);
+    m_previous.bodies.insert(m_previous.bodies.end(), m_states.begin(), m_states.end());
+    m_current.bodies.resize(first);
+    m_current.bodies.insert(m_current.bodies.end(), m_states.begin(), m_states.end());
+    m_is_pending.resize(m_bodies.size(), false);
+    for (u32 slot = first; slot < m_bodies.size(); slot++) {
+        mark_pending(slot);
+    }
+
+    return Handle { .index = first };
+}
+
+void Simulation::step(u32 count)
+{
+    util_assert(initialized == true, "Simulation has not been initialized");
+    util_assert(!m_thread.joinable(), "Simulation::step() called while the simulation thread exists");
+
+    const i64 step_ns = m_step_ns.load();
+    for (u32 i = 0; i < count; i++) {
+        run_step(m_current.time_ns + step_ns, m_step_snapshot);
+    }
+}
+
+[[nodiscard]] i64 Simulation::get_time_ns() const
+{
+    util_assert(initialized == true, "Simulation has not been initialized");
+
+    // Only ever written by whoever steps, which is the caller in manual mode
+    return m_current.time_ns;
+}
+
+void Simulation::interpolate(i64 time_ns, std::vector<BodyTransform>& bodies)
+{
+    util_assert(initialized == true, "Simulation has not been initialized");
+
+    std::lock_guard lock(m_snapshot_mutex);
+
+    // The render thread is one step behind, so it lands between the last two steps
+    const i64 step_ns = m_step_ns.load();
+    const f32 alpha = m_current.time_ns == m_previous.time_ns
+        ? 1.0F
+        : std::clamp(static_cast<f32>(time_ns - step_ns - m_previous.time_ns) / static_cast<f32>(m_current.time_ns - m_previous.time_ns), 0.0F, 1.0F);
+
+    // Whatever moved in the last two steps is still between poses, pending covers the steps
+    // published since the last call that this frame never saw
+    for (const u32 slot : m_current.moved) {
+        mark_pending(slot);
+    }
+    for (const u32 slot : m_previous.moved) {
+        mark_pending(slot);
+    }
+
+    bodies.clear();
+    for (const u32 slot : m_pending) {
+        m_is_pending[slot] = false;
+
+        const BodyState& previous = slot < m_previous.bodies.size() ? m_previous.bodies[slot] : m_current.bodies[slot];
+        const BodyState& current = m_current.bodies[slot];
+
+        const glm::vec3 position = glm::mix(previous.position, current.position, alpha);
+        const glm::quat rotation = glm::slerp(previous.rotation, current.rotation, alpha);
+        auto& body = bodies.emplace_back(BodyTransform {
+            .handle = Handle { .index = slot },
+            .transform = glm::mat4_cast(rotation),
+        });
+        // Same as translate() * mat4_cast() without multiplying through an identity matrix
+        body.transform[3] = glm::vec4(position, 1.0F);
+    }
+    m_pending.clear();
+}
+
+void Simulation::set_steps_per_second(u32 steps_per_second)
+{
+    util_assert(steps_per_second > 0, "Simulation needs at least one step per second");
+    m_step_ns = NS_PER_SECOND / steps_per_second;
+}
+
+[[nodiscard]] u32 Simulation::get_steps_per_second() const
+{
+    return static_cast<u32>(NS_PER_SECOND / m_step_ns.load());
+}
+
+[[nodiscard]] u64 Simulation::get_step_count() const
+{
+    return m_step_count.load();
+}
+
+[[nodiscard]] f64 Simulation::get_step_ms() const
+{
+    return static_cast<f64>(m_step_duration_ns.load()) / 1'000'000.0;
+}
+
+[[nodiscard]] bool Simulation::is_initialized() const
+{
+    return initialized;
+}
+
+void Simulation::thread_main(const std::stop_token& stop_token)
+{
+    Utils::Profiler::set_thread_name("physics");
+
+    Snapshot snapshot;
+    i64 next_step_ns = Utils::Profiler::now_ns();
+    while (!stop_token.stop_requested()) {
+        if (!m_running.load()) {
+            std::unique_lock lock(m_step_mutex);
+            m_running_changed.wait(lock, stop_token, [this]() { return m_running.load(); });
+            next_step_ns = Utils::Profiler::now_ns();
+            continue;
+        }
+
+        const i64 step_ns = m_step_ns.load();
+        run_step(next_step_ns, snapshot);
+
+        next_step_ns += step_ns;
+        const i64 now_ns = Utils::Profiler::now_ns();
+        if (now_ns - next_step_ns > MAX_STEPS_BEHIND * step_ns) {
+            next_step_ns = now_ns;
+        }
+        std::this_thread::sleep_for(std::chrono::nanoseconds(next_step_ns - now_ns));
+    }
+}
+
+void Simulation::run_step(i64 time_ns, Snapshot& snapshot)
+{
+    {
+        PROFILE_SCOPE("Physics::Simulation::step");
+        std::lock_guard lock(m_step_mutex);
+
+        const i64 begin_ns = Utils::Profiler::now_ns();
+        m_system->update(static_cast<f32>(m_step_ns.load()) / static_cast<f32>(NS_PER_SECOND));
+        snapshot.time_ns = time_ns;
+        capture(snapshot);
+        m_step_duration_ns = Utils::Profiler::now_ns() - begin_ns;
+    }
+
+    {
+        std::lock_guard lock(m_snapshot_mutex);
+        std::swap(m_previous, m_current);
+        std::swap(m_current, snapshot);
+        for (const u32 slot : m_current.moved) {
+            mark_pending(slot);
+        }
+    }
+    m_step_count++;
+}
+
+void Simulation::capture(Snapshot& snapshot)
+{
+    // The snapshot was last written two steps ago, so it only lacks what the previous step and this
+    // one moved. Only this thread writes m_current outside of add_bodies(), which holds the step
+    // mutex too and is also where the snapshot falls behind in size
+    if (snapshot.bodies.size() < m_current.bodies.size()) {
+        snapshot.bodies.insert(snapshot.bodies.end(), m_current.bodies.begin() + static_cast<i64>(snapshot.bodies.size()), m_current.bodies.end());
+    }
+    for (const u32 slot : m_current.moved) {
+        snapshot.bodies[slot] = m_current.bodies[slot];
+    }
+
+    snapshot.moved.clear();
+    m_moved_bodies.clear();
+    m_system->get_active_bodies(m_active_bodies);
+    for (const JPH::BodyID body : m_active_bodies) {
+        const u32 index = body.GetIndex();
+        if (index < m_body_slots.size() && m_body_slots[index] != INVALID_SLOT && m_bodies[m_body_slots[index]] == body) {
+            snapshot.moved.emplace_back(m_body_slots[index]);
+            m_moved_bodies.emplace_back(body);
+        }
+    }
+
+    // One lock for the whole batch instead of one per body through the BodyInterface
+    JPH::BodyLockMultiRead bodies(m_system->get_body_lock_interface(), m_moved_bodies.data(), static_cast<i32>(m_moved_bodies.size()));
+    for (usize i = 0; i < m_moved_bodies.size(); i++) {
+        const JPH::Body* body = bodies.GetBody(static_cast<i32>(i));
+        if (body == nullptr) {
+            continue;
+        }
+
+        const JPH::RVec3 position = body->GetCenterOfMassPosition();
+        const JPH::Quat rotation = body->GetRotation();
+        snapshot.bodies[snapshot.moved[i]] = BodyState {
+            .position = glm::vec3(position.GetX(), position.GetY(), position.GetZ()),
+            .rotation = glm::quat(rotation.GetW(), rotation.GetX(), rotation.GetY(), rotation.GetZ()),
+        };
+    }
+}
+
+void Simulation::mark_pending(u32 slot)
+{
+    if (!m_is_pending[slot]) {
+        m_is_pending[slot] = true;
+        m_pending.emplace_back(slot);
+    }
+}
+
+[[nodiscard]] Simulation::BodyState Simulation::read_body(JPH::BodyID body) const
+{
+    const JPH::BodyInterface& bodies = *m_system->m_body_interface;
+    const JPH::RVec3 position = bodies.GetCenterOfMassPosition(body);
+    const JPH::Quat rotation = bodies.GetRotation(body);
+    return BodyState {
+        .position = glm::vec3(position.GetX(), position.GetY(), position.GetZ()),
+        .rotation = glm::quat(rotation.GetW(), rotation.GetX(), rotation.GetY(), rotation.GetZ()),
+    };
+}
+
+} // namespace Physics
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "engine.hpp"
+
+namespace Physics {
+
+// Steps a System at a fixed rate on its own thread. Every step publishes the transforms of the
+// tracked bodies Jolt reports as active, the last two are kept and interpolate() blends between
+// them for the render thread, which draws one step behind the simulation. A step only writes the
+// slots that moved in it or the step before, so sleeping bodies cost nothing on either side.
+// Tracked bodies keep their slot for the life of the simulation, there is no way to remove one,
+// so they have to live as long as it does. Anything else touching the bodies while the thread
+// runs has to hold lock(). Runs that have to be reproducible leave the thread off and call step()
+// themselves, their snapshots are stamped with simulation time instead of the clock
+class Simulation : public NoCopyNoMove {
+public:
+    // Registry component pointing at a body's slot in the snapshots
+    struct Handle {
+        u32 index;
+    };
+
+    struct BodyTransform {
+        Handle handle;
+        glm::mat4 transform;
+    };
+
+    Simulation() = default;
+    ~Simulation();
+
+    void init(System& system, u32 steps_per_second = 60);
+
+    // Starts the thread on first use, paused steps are not made up for later
+    void set_running(bool running);
+    [[nodiscard]] bool is_running() const;
+    // Joins the thread, needed before the system goes away
+    void stop();
+
+    [[nodiscard]] std::unique_lock<std::mutex> lock();
+
+    // Call with the lock held, the body shows up in the snapshots from now on
+    [[nodiscard]] Handle add_body(JPH::BodyID body);
+    // Same as add_body() for every body in one go, their handles follow the returned first one
+    [[nodiscard]] Handle add_bodies(std::span<const JPH::BodyID> bodies);
+
+    // Runs count steps on the calling thread, only while the thread is not running
+    void step(u32 count);
+    // Time of the latest step, simulation time for step() and Utils::Profiler::now_ns() otherwise
+    [[nodiscard]] i64 get_time_ns() const;
+
+    // Transforms at time_ns of the bodies that moved since the last call, bodies that stayed
+    // asleep are left out. time_ns is on the same clock as get_time_ns()
+    void interpolate(i64 time_ns, std::vector<BodyTransform>& bodies);
+
+    void set_steps_per_second(u32 steps_per_second);
+    [[nodiscard]] u32 get_steps_per_second() const;
+    [[nodiscard]] u64 get_step_count() const;
+    // Time the last step took on the simulation thread
+    [[nodiscard]] f64 get_step_ms() const;
+    [[nodiscard]] bool is_initialized() const;
+
+private:
+    struct BodyState {
+        glm::vec3 position;
+        glm::quat rotation;
+    };
+
+    struct Snapshot {
+        // Scheduled time of the step, steps are step_ns apart no matter when they ran
+        i64 time_ns = 0;
+        // Every tracked body, sleeping ones keep the state they fell asleep in. Persistent, a
+        // step only rewrites the slots that changed since the snapshot was last published
+        std::vector<BodyState> bodies;
+        // Slots the step wrote
+        std::vector<u32> moved;
+    };
+
+    static constexpr u32 INVALID_SLOT = std::numeric_limits<u32>::max();
+
+    void thread_main(const std::stop_token& stop_token);
+    // Steps the system and publishes the result as the step at time_ns
+    void run_step(i64 time_ns, Snapshot& snapshot);
+    void capture(Snapshot& snapshot);
+    // Call with the snapshot mutex held
+    void mark_pending(u32 slot);
+    [[nodiscard]] BodyState read_body(JPH::BodyID body) const;
+
+    bool initialized = false;
+    System* m_system = nullptr;
+
+    std::jthread m_thread;
+    std::atomic<bool> m_running = false;
+    std::atomic<i64> m_step_ns = 0;
+    std::atomic<u64> m_step_count = 0;
+    std::atomic<i64> m_step_duration_ns = 0;
+    std::condition_variable_any m_running_changed;
+
+    // Held for a whole step and by lock()
+    std::mutex m_step_mutex;
+    std::vector<JPH::BodyID> m_bodies;
+    // Slot of every tracked body by BodyID::GetIndex()
+    std::vector<u32> m_body_slots;
+    // Scratch for add_bodies()
+    std::vector<BodyState> m_states;
+    // Scratch for capture()
+    JPH::BodyIDVector m_active_bodies;
+    std::vector<JPH::BodyID> m_moved_bodies;
+
+    // Guards the published pair and the pending slots, held just long enough to swap or read them
+    std::mutex m_snapshot_mutex;
+    Snapshot m_previous;
+    Snapshot m_current;
+    // Slots published since the last interpolate()
+    std::vector<u32> m_pending;
+    std::vector<bool> m_is_pending;
+
+    // Scratch of step(), the thread keeps its own
+    Snapshot m_step_snapshot;
+};
+
+} // namespace Physics
@@ -0,0 +1,103 @@
+#include "temp_allocator.hpp"
+
+#include <Jolt/Core/Memory.h>
+
+namespace Physics {
+
+TempAllocator::TempAllocator(usize capacity)
+    : m_base(static_cast<u8*>(JPH::AlignedAllocate(capacity, JPH_RVECTOR_ALIGNMENT)))
+    , m_capacity(capacity)
+{
+    m_step.capacity = m_capacity;
+}
+
+TempAllocator::~TempAllocator()
+{
+    util_assert(m_top == 0 && m_fallback_live == 0, "TempAllocator destroyed with memory still allocated");
+    JPH::AlignedFree(m_base);
+}
+
+[[nodiscard]] void* TempAllocator::Allocate(JPH::uint inSize)
+{
+    if (inSize == 0) {
+        return nullptr;
+    }
+
+    const usize size = JPH::AlignUp(inSize, JPH_RVECTOR_ALIGNMENT);
+    void* address = nullptr;
+    if (m_top + size <= m_capacity) {
+        address = m_base + m_top;
+        m_top += size;
+    } else {
+        address = JPH::AlignedAllocate(size, JPH_RVECTOR_ALIGNMENT);
+        m_fallback_live += size;
+        m_step.fallback_allocations++;
+        m_step.fallback_bytes += size;
+    }
+
+    m_step.allocations++;
+    m_step.peak_bytes = std::max(m_step.peak_bytes, m_top + m_fallback_live);
+    return address;
+}
+
+void TempAllocator::Free(void* inAddress, JPH::uint inSize)
+{
+    if (inAddress == nullptr) {
+        return;
+    }
+
+    const usize size = JPH::AlignUp(inSize, JPH_RVECTOR_ALIGNMENT);
+    if (owns(inAddress)) {
+        util_assert(m_base + m_top - size == inAddress, "TempAllocator frees have to be in reverse order");
+        m_top -= size;
+    } else {
+        JPH::AlignedFree(inAddress);
+        m_fallback_live -= size;
+    }
+}
+
+void TempAllocator::end_step()
+{
+    util_assert(m_top == 0 && m_fallback_live == 0, "TempAllocator::end_step() with memory still allocated");
+
+    {
+        std::lock_guard lock(m_stats_mutex);
+        m_last_step = m_step;
+        if (m_step.peak_bytes >= m_worst_step.peak_bytes) {
+            m_worst_step = m_step;
+        }
+    }
+
+    if (m_step.fallback_allocations > 0) {
+        const auto grown = static_cast<usize>(static_cast<f32>(m_step.peak_bytes) * GROWTH_FACTOR);
+        const usize capacity = JPH::AlignUp(grown, GROWTH_ALIGNMENT);
+        LOG_INFO(std::format("Physics::TempAllocator: {} allocations ({} bytes) fell back to the heap, growing from {} to {} bytes",
+            m_step.fallback_allocations, m_step.fallback_bytes, m_capacity, capacity));
+
+        JPH::AlignedFree(m_base);
+        m_base = static_cast<u8*>(JPH::AlignedAllocate(capacity, JPH_RVECTOR_ALIGNMENT));
+        m_capacity = capacity;
+    }
+
+    m_step = Stats { .capacity = m_capacity };
+}
+
+[[nodiscard]] TempAllocator::Stats TempAllocator::get_last_step() const
+{
+    std::lock_guard lock(m_stats_mutex);
+    return m_last_step;
+}
+
+[[nodiscard]] TempAllocator::Stats TempAllocator::get_worst_step() const
+{
+    std::lock_guard lock(m_stats_mutex);
+    return m_worst_step;
+}
+
+[[nodiscard]] bool TempAllocator::owns(const void* address) const
+{
+    const auto* byte = static_cast<const u8*>(address);
+    return byte >= m_base && byte < m_base + m_capacity;
+}
+
+} // namespace Physics
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Jolt/Core/TempAllocator.h>
+
+namespace Physics {
+
+// Stack allocator for the scratch memory Jolt asks for during a step, like TempAllocatorImpl.
+// An allocation that does not fit the arena goes to the heap instead of failing, end_step() then
+// grows the arena past the step's peak so the next step fits. Like TempAllocatorImpl it is not
+// thread safe and frees have to come in reverse order, Jolt uses it that way
+class TempAllocator final : public JPH::TempAllocator {
+public:
+    struct Stats {
+        usize capacity = 0;
+        // Most bytes in use at once, heap fallbacks included
+        usize peak_bytes = 0;
+        u32 allocations = 0;
+        u32 fallback_allocations = 0;
+        usize fallback_bytes = 0;
+    };
+
+    explicit TempAllocator(usize capacity);
+    ~TempAllocator() override;
+
+    [[nodiscard]] void* Allocate(JPH::uint inSize) override;
+    void Free(void* inAddress, JPH::uint inSize) override;
+
+    // Call after every step with nothing allocated, publishes the step's stats
+    void end_step();
+
+    // Safe to call from any thread
+    [[nodiscard]] Stats get_last_step() const;
+    // The step with the highest peak so far, what the arena needs for the worst scene
+    [[nodiscard]] Stats get_worst_step() const;
+
+    // The arena grows to the peak times this, so a slowly growing scene does not grow it every step
+    static constexpr f32 GROWTH_FACTOR = 1.5F;
+    static constexpr usize GROWTH_ALIGNMENT = 64 * 1024;
+
+private:
+    [[nodiscard]] bool owns(const void* address) const;
+
+    u8* m_base = nullptr;
+    usize m_capacity = 0;
+    usize m_top = 0;
+    usize m_fallback_live = 0;
+    Stats m_step;
+
+    mutable std::mutex m_stats_mutex;
+    Stats m_last_step;
+    Stats m_worst_step;
+};
+
+} // namespace Physics
@@ -1,5 +1,8 @@
 #include "buffer.hpp"
 
+#include "counters.hpp"
+#include "gl_state.hpp"
+
 namespace Renderer {
 
 void Buffer::init()
@@ -14,6 +17,7 @@ Buffer::~Buffer()
 {
     if (initialized) {
         glDeleteBuffers(1, &m_id);
+        GlState::forget_buffer(m_id);
         initialized = false;
     }
 }
@@ -22,6 +26,9 @@ void Buffer::buffer_data(GLsizeiptr size, const void* data, GLenum usage)
 {
     util_assert(initialized == true, "Buffer has not been initialized");
     glNamedBufferData(m_id, size, data, usage);
+    if (data != nullptr) {
+        Counters::add(Counters::Counter::BytesUploaded, static_cast<u64>(size));
+    }
 }
 
 // GL_DYNAMIC_STORAGE_BIT, GL_MAP_READ_BIT GL_MAP_WRITE_BIT, GL_MAP_PERSISTENT_BIT, GL_MAP_COHERENT_BIT, and GL_CLIENT_STORAGE_BIT.
@@ -29,24 +36,28 @@ void Buffer::buffer_storage(GLsizeiptr size, const void* data, GLbitfield flags)
 {
     util_assert(initialized == true, "Buffer has not been initialized");
     glNamedBufferStorage(m_id, size, data, flags);
+    if (data != nullptr) {
+        Counters::add(Counters::Counter::BytesUploaded, static_cast<u64>(size));
+    }
 }
 
 void Buffer::buffer_sub_data(GLsizeiptr offset, GLsizeiptr size, const void* data)
 {
     util_assert(initialized == true, "Buffer has not been initialized");
     glNamedBufferSubData(m_id, offset, size, data);
+    Counters::add(Counters::Counter::BytesUploaded, static_cast<u64>(size));
 }
 
 void Buffer::bind_buffer(GLenum target) const
 {
     util_assert(initialized == true, "Buffer has not been initialized");
-    glBindBuffer(target, m_id);
+    GlState::bind_buffer(target, m_id);
 }
 
 void Buffer::unbind_buffer(GLenum target) const
 {
     util_assert(initialized == true, "Buffer has not been initialized");
-    glBindBuffer(target, 0);
+    GlState::bind_buffer(target, 0);
 }
 
 [[nodiscard]] bool Buffer::is_initialized() const
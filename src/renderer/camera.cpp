@@ -217,4 +217,26 @@ void Camera::set_speed(float speed)
     this->m_speed = speed;
 }
 
+void Camera::set_pos(glm::vec3 pos)
+{
+    m_pos = pos;
+}
+
+void Camera::set_rotation(float yaw, float pitch)
+{
+    m_yaw = yaw;
+    m_pitch = std::clamp(pitch, -89.0F, 89.0F);
+    update_vectors();
+}
+
+[[nodiscard]] float Camera::get_yaw() const
+{
+    return m_yaw;
+}
+
+[[nodiscard]] float Camera::get_pitch() const
+{
+    return m_pitch;
+}
+
 } // namespace Renderer
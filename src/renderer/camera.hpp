@@ -52,6 +52,11 @@ public:
     }
 
     void set_speed(float speed);
+    void set_pos(glm::vec3 pos);
+    // Degrees, the pitch is clamped like rotate() does
+    void set_rotation(float yaw, float pitch);
+    [[nodiscard]] float get_yaw() const;
+    [[nodiscard]] float get_pitch() const;
 
 private:
     float m_fov {};
@@ -0,0 +1,99 @@
+#include "counters.hpp"
+
+namespace Renderer::Counters {
+
+namespace {
+    struct State {
+        std::array<u64, COUNTER_COUNT> current {};
+        std::array<u64, COUNTER_COUNT> last {};
+        // Floats for ImGui::PlotLines, history_offset is the oldest entry
+        std::array<std::array<f32, HISTORY_SIZE>, COUNTER_COUNT> history {};
+        usize history_offset = 0;
+    };
+
+    State state;
+
+    constexpr std::array<const char*, COUNTER_COUNT> NAMES = {
+        "draw calls",
+        "multi draw commands",
+        "instances",
+        "triangles",
+        "bytes uploaded",
+        "program binds",
+        "texture binds",
+        "uniform sets",
+        "shader compiles",
+    };
+
+    usize get_index(Counter counter)
+    {
+        const auto index = static_cast<usize>(counter);
+        util_assert(index < COUNTER_COUNT, std::format("Counters: invalid counter {}", index));
+        return index;
+    }
+} // anonymous namespace
+
+void add(Counter counter, u64 value)
+{
+    state.current[get_index(counter)] += value;
+}
+
+void add_draw(u64 index_count, u64 instance_count)
+{
+    state.current[static_cast<usize>(Counter::Instances)] += instance_count;
+    state.current[static_cast<usize>(Counter::Triangles)] += index_count / 3 * instance_count;
+}
+
+void begin_frame()
+{
+    state.last = state.current;
+    state.current = {};
+
+    for (usize i = 0; i < COUNTER_COUNT; i++) {
+        state.history[i][state.history_offset] = static_cast<f32>(state.last[i]);
+        Utils::FlightRecorder::set_counter(NAMES[i], static_cast<f64>(state.last[i]));
+    }
+    state.history_offset = (state.history_offset + 1) % HISTORY_SIZE;
+}
+
+[[nodiscard]] u64 get(Counter counter)
+{
+    return state.last[get_index(counter)];
+}
+
+[[nodiscard]] std::vector<u64> get_history(Counter counter)
+{
+    const auto& history = state.history[get_index(counter)];
+
+    std::vector<u64> values;
+    values.reserve(HISTORY_SIZE);
+    for (usize i = 0; i < HISTORY_SIZE; i++) {
+        values.emplace_back(static_cast<u64>(history[(state.history_offset + i) % HISTORY_SIZE]));
+    }
+    return values;
+}
+
+[[nodiscard]] const char* get_name(Counter counter)
+{
+    return NAMES[get_index(counter)];
+}
+
+void draw_imgui()
+{
+    for (usize i = 0; i < COUNTER_COUNT; i++) {
+        const auto& history = state.history[i];
+        const f32 max = *std::ranges::max_element(history);
+
+        const std::string label = std::format("{}: {}", NAMES[i], state.last[i]);
+        ImGui::PlotLines(NAMES[i],
+            history.data(),
+            static_cast<i32>(HISTORY_SIZE),
+            static_cast<i32>(state.history_offset),
+            label.c_str(),
+            0.0F,
+            std::max(max * 1.1F, 1.0F),
+            ImVec2(0.0F, 40.0F));
+    }
+}
+
+} // namespace Renderer::Counters
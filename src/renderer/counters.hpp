@@ -0,0 +1,40 @@
+#pragma once
+
+// Work the renderer hands to the driver, counted per frame. begin_frame() moves the frame that
+// ended into get() and a short history, so a slower frame can be matched with what changed
+namespace Renderer::Counters {
+
+enum class Counter : u8 {
+    DrawCalls = 0,
+    // Commands inside glMultiDrawElementsIndirect calls, before any GPU culling
+    MultiDrawCommands,
+    Instances,
+    Triangles,
+    BytesUploaded,
+    // Binds that reached the driver, the GL state cache drops the redundant ones
+    ProgramBinds,
+    TextureBinds,
+    UniformSets,
+    ShaderCompiles,
+    Count,
+};
+
+constexpr usize COUNTER_COUNT = static_cast<usize>(Counter::Count);
+constexpr usize HISTORY_SIZE = 240;
+
+void add(Counter counter, u64 value = 1);
+// Counts a draw of count indices per instance
+void add_draw(u64 index_count, u64 instance_count);
+
+// Once per frame before anything renders
+void begin_frame();
+
+// Value of the last finished frame
+[[nodiscard]] u64 get(Counter counter);
+// The last finished frames, oldest first
+[[nodiscard]] std::vector<u64> get_history(Counter counter);
+[[nodiscard]] const char* get_name(Counter counter);
+
+void draw_imgui();
+
+} // namespace Renderer::Counters
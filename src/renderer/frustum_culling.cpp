@@ -8,6 +8,13 @@ Plane::Plane(const glm::vec3& p1, const glm::vec3& norm)
 {
 }
 
+Plane::Plane(const glm::vec4& equation)
+{
+    const float length = glm::length(glm::vec3(equation));
+    normal = glm::vec3(equation) / length;
+    distance = -equation.w / length;
+}
+
 float Plane::get_signed_distance_to_plane(const glm::vec3& point) const
 {
     return glm::dot(normal, point) - distance;
@@ -55,58 +62,72 @@ void Frustum::init(const Camera& cam)
         glm::cross(front_mult_far + up * halfvside, right) };
 }
 
-} // namespace Renderer
+Frustum::Frustum(const glm::mat4& view_proj)
+{
+    init(view_proj);
+}
+
+void Frustum::init(const glm::mat4& view_proj)
+{
+    const glm::mat4 m = glm::transpose(view_proj);
+
+    left_face = Plane(m[3] + m[0]);
+    right_face = Plane(m[3] - m[0]);
+    bottom_face = Plane(m[3] + m[1]);
+    top_face = Plane(m[3] - m[1]);
+    near_face = Plane(m[3] + m[2]);
+    far_face = Plane(m[3] - m[2]);
+}
+
+AABB::AABB(const glm::vec3& min, const glm::vec3& max)
+{
+    init(min, max);
+}
 
-// struct AABB {
-//     inline AABB() = default;
-//     inline AABB(const glm::vec3& min, const glm::vec3& max);
-
-//     inline void init(const glm::vec3& min, const glm::vec3& max);
-
-//     inline std::array<glm::vec3, 8> getVerticies() const;
-//     inline bool isOnOrForwardPlane(const Plane& plane) const;
-//     inline bool isOnFrustum(const Frustum& camFrustum) const;
-
-// private:
-//     glm::vec3 center { 0.f, 0.f, 0.f };
-//     glm::vec3 extents { 0.f, 0.f, 0.f };
-// };
-
-// inline AABB::AABB(const glm::vec3& min, const glm::vec3& max)
-// {
-//     init(min, max);
-// }
-
-// inline void AABB::init(const glm::vec3& min, const glm::vec3& max)
-// {
-//     center = { (max + min) * 0.5f };
-//     extents = { max.x - center.x, max.y - center.y, max.z - center.z };
-// }
-
-// inline std::array<glm::vec3, 8> AABB::getVerticies() const
-// {
-//     std::array<glm::vec3, 8> verticies;
-//     verticies[0] = { center.x - extents.x, center.y - extents.y, center.z - extents.z };
-//     verticies[1] = { center.x + extents.x, center.y - extents.y, center.z - extents.z };
-//     verticies[2] = { center.x - extents.x, center.y + extents.y, center.z - extents.z };
-//     verticies[3] = { center.x + extents.x, center.y + extents.y, center.z - extents.z };
-//     verticies[4] = { center.x - extents.x, center.y - extents.y, center.z + extents.z };
-//     verticies[5] = { center.x + extents.x, center.y - extents.y, center.z + extents.z };
-//     verticies[6] = { center.x - extents.x, center.y + extents.y, center.z + extents.z };
-//     verticies[7] = { center.x + extents.x, center.y + extents.y, center.z + extents.z };
-//     return verticies;
-// }
-
-// inline bool AABB::isOnOrForwardPlane(const Plane& plane) const
-// {
-//     // Compute the projection interval radius of b onto L(t) = b.c + t * p.n
-//     const glm::vec3 normal = plane.getNormal();
-//     const float r = extents.x * std::abs(normal.x) + extents.y * std::abs(normal.y) + extents.z * std::abs(normal.z);
-
-//     return -r <= plane.getSignedDistanceToPlane(center);
-// }
-
-// inline bool AABB::isOnFrustum(const Frustum& camFrustum) const
-// {
-//     return (isOnOrForwardPlane(camFrustum.leftFace) && isOnOrForwardPlane(camFrustum.rightFace) && isOnOrForwardPlane(camFrustum.topFace) && isOnOrForwardPlane(camFrustum.bottomFace) && isOnOrForwardPlane(camFrustum.nearFace) && isOnOrForwardPlane(camFrustum.farFace));
-// };
\ No newline at end of file
+void AABB::init(const glm::vec3& min, const glm::vec3& max)
+{
+    center = (max + min) * 0.5F;
+    extents = max - center;
+}
+
+AABB AABB::transform(const glm::mat4& model) const
+{
+    AABB result;
+    result.center = glm::vec3(model * glm::vec4(center, 1.0F));
+
+    const glm::mat3 basis = glm::mat3(model);
+    for (int i = 0; i < 3; i++) {
+        result.extents[i] = std::abs(basis[0][i]) * extents.x
+            + std::abs(basis[1][i]) * extents.y
+            + std::abs(basis[2][i]) * extents.z;
+    }
+
+    return result;
+}
+
+bool AABB::is_on_or_forward_plane(const Plane& plane) const
+{
+    // Compute the projection interval radius of the box onto the plane normal
+    const glm::vec3 normal = plane.get_normal();
+    const float r = extents.x * std::abs(normal.x) + extents.y * std::abs(normal.y) + extents.z * std::abs(normal.z);
+
+    return -r <= plane.get_signed_distance_to_plane(center);
+}
+
+bool AABB::is_on_frustum(const Frustum& frustum) const
+{
+    return is_on_or_forward_plane(frustum.left_face)
+        && is_on_or_forward_plane(frustum.right_face)
+        && is_on_or_forward_plane(frustum.top_face)
+        && is_on_or_forward_plane(frustum.bottom_face)
+        && is_on_or_forward_plane(frustum.near_face)
+        && is_on_or_forward_plane(frustum.far_face);
+}
+
+float AABB::get_distance_to_point(const glm::vec3& point) const
+{
+    const glm::vec3 delta = glm::max(glm::abs(point - center) - extents, glm::vec3(0.0F));
+    return glm::length(delta);
+}
+
+} // namespace Renderer
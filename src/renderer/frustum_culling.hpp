@@ -8,6 +8,8 @@ struct Plane {
     Plane() = default;
 
     Plane(const glm::vec3& p1, const glm::vec3& norm);
+    // From a plane equation ax + by + cz + d = 0
+    explicit Plane(const glm::vec4& equation);
 
     [[nodiscard]] float get_signed_distance_to_plane(const glm::vec3& point) const;
 
@@ -22,7 +24,10 @@ private:
 struct Frustum {
     Frustum() = default;
     explicit Frustum(const Camera& cam);
+    // Extracts the planes from a projection * view matrix (Gribb-Hartmann)
+    explicit Frustum(const glm::mat4& view_proj);
     void init(const Camera& cam);
+    void init(const glm::mat4& view_proj);
 
     Plane top_face;
     Plane bottom_face;
@@ -34,4 +39,20 @@ struct Frustum {
     Plane near_face;
 };
 
+struct AABB {
+    AABB() = default;
+    AABB(const glm::vec3& min, const glm::vec3& max);
+
+    void init(const glm::vec3& min, const glm::vec3& max);
+
+    // Bounds of the box after being transformed by model (stays axis aligned)
+    [[nodiscard]] AABB transform(const glm::mat4& model) const;
+    [[nodiscard]] bool is_on_or_forward_plane(const Plane& plane) const;
+    [[nodiscard]] bool is_on_frustum(const Frustum& frustum) const;
+    [[nodiscard]] float get_distance_to_point(const glm::vec3& point) const;
+
+    glm::vec3 center { 0.0F, 0.0F, 0.0F };
+    glm::vec3 extents { 0.0F, 0.0F, 0.0F };
+};
+
 } // namespace Renderer
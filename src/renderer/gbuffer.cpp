@@ -2,84 +2,69 @@
 
 namespace Renderer {
 
-void GBuffer::init(int screen_width, int screen_height)
+void GBuffer::declare(RenderGraph& graph, i32 width, i32 height)
 {
-    util_assert(initialized == false, "GBuffer::init() has already been initialized");
+    m_buffer_width = width;
+    m_buffer_height = height;
 
-    m_buffer_width = screen_width;
-    m_buffer_height = screen_height;
+    RenderGraph::TextureDesc desc { .width = width, .height = height, .internal_format = GL_RGBA8 };
+    m_albedo_ao = graph.create_texture("gbuffer_albedo_ao", desc);
 
-    m_buffer.init();
+    desc.internal_format = GL_RG16_SNORM;
+    m_normal = graph.create_texture("gbuffer_normal", desc);
 
-    Renderer::TextureInfo texture_info;
-    texture_info.size = Renderer::TextureSize { .width = screen_width, .height = screen_height, .depth = 0 };
-    texture_info.internal_format = GL_RGBA16F;
-    texture_info.mipmaps = GL_FALSE;
-    m_position.init(texture_info);
-    m_buffer.bind_texture(GL_COLOR_ATTACHMENT0, m_position.get_id(), 0);
+    desc.internal_format = GL_RG8;
+    m_material = graph.create_texture("gbuffer_material", desc);
 
-    m_normal.init(texture_info);
-    m_buffer.bind_texture(GL_COLOR_ATTACHMENT1, m_normal.get_id(), 0);
-
-    texture_info.internal_format = GL_RGBA16F;
-    m_albedo.init(texture_info);
-    m_buffer.bind_texture(GL_COLOR_ATTACHMENT2, m_albedo.get_id(), 0);
-
-    m_depth.init();
-    m_depth.buffer_storage(GL_DEPTH_COMPONENT24, screen_width, screen_height);
-
-    m_buffer.bind_renderbuffer(GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depth.get_id());
-
-    std::array<u32, 3> attachments = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-    m_buffer.bind_draw_buffers(attachments.size(), attachments.data());
-
-    initialized = true;
+    desc.internal_format = GL_DEPTH_COMPONENT24;
+    m_depth = graph.create_texture("gbuffer_depth", desc);
 }
 
-GBuffer::~GBuffer()
+void GBuffer::write(RenderGraph::Builder& builder) const
 {
-    initialized = false;
-}
+    util_assert(m_albedo_ao != RenderGraph::INVALID_RESOURCE, "GBuffer has not been declared");
 
-void GBuffer::reinit(int screen_width, int screen_height)
-{
-    this->~GBuffer();
-    init(screen_width, screen_height);
+    // Attachment order matches the gbuffer fragment shader outputs
+    builder.write(m_albedo_ao, RenderGraph::Access::ColorAttachment);
+    builder.write(m_normal, RenderGraph::Access::ColorAttachment);
+    builder.write(m_material, RenderGraph::Access::ColorAttachment);
+    builder.write(m_depth, RenderGraph::Access::DepthAttachment);
 }
 
-void GBuffer::bind()
+void GBuffer::read(RenderGraph::Builder& builder) const
 {
-    util_assert(initialized == true, "GBuffer has not been initialized");
-    m_buffer.bind();
+    util_assert(m_albedo_ao != RenderGraph::INVALID_RESOURCE, "GBuffer has not been declared");
+
+    builder.read(m_albedo_ao, RenderGraph::Access::Sampled);
+    builder.read(m_normal, RenderGraph::Access::Sampled);
+    builder.read(m_material, RenderGraph::Access::Sampled);
+    builder.read(m_depth, RenderGraph::Access::Sampled);
 }
 
-void GBuffer::set_uniforms(Renderer::ShaderProgram& shader)
+void GBuffer::set_uniforms(RenderGraph& graph, Renderer::ShaderProgram& shader) const
 {
-    util_assert(initialized == true, "GBuffer has not been initialized");
+    util_assert(m_albedo_ao != RenderGraph::INVALID_RESOURCE, "GBuffer has not been declared");
 
     GLuint texture_unit = Texture::get_texture_unit();
-    m_position.bind(texture_unit);
-    shader.set_int("gPosition", static_cast<i32>(texture_unit));
+    graph.get_texture(m_albedo_ao).bind(texture_unit);
+    shader.set_int("gAlbedoAO", static_cast<i32>(texture_unit));
 
     texture_unit = Texture::get_texture_unit();
-    m_normal.bind(texture_unit);
+    graph.get_texture(m_normal).bind(texture_unit);
     shader.set_int("gNormal", static_cast<i32>(texture_unit));
 
     texture_unit = Texture::get_texture_unit();
-    m_albedo.bind(texture_unit);
-    shader.set_int("gAlbedoSpec", static_cast<int>(texture_unit));
-}
+    graph.get_texture(m_material).bind(texture_unit);
+    shader.set_int("gMaterial", static_cast<i32>(texture_unit));
 
-void GBuffer::unbind()
-{
-    util_assert(initialized == true, "GBuffer has not been initialized");
-    m_buffer.unbind();
+    texture_unit = Texture::get_texture_unit();
+    graph.get_texture(m_depth).bind(texture_unit);
+    shader.set_int("gDepth", static_cast<i32>(texture_unit));
 }
 
-void GBuffer::blit_depth_buffer()
+[[nodiscard]] usize GBuffer::get_size_bytes() const
 {
-    util_assert(initialized == true, "GBuffer has not been initialized");
-    glBlitNamedFramebuffer(m_buffer.get_id(), 0, 0, 0, m_buffer_width, m_buffer_height, 0, 0, m_buffer_width, m_buffer_height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    return static_cast<usize>(m_buffer_width) * static_cast<usize>(m_buffer_height) * BYTES_PER_PIXEL;
 }
 
 } // namespace Renderer
@@ -1,36 +1,37 @@
 #pragma once
 
-#include "framebuffer.hpp"
-#include "renderbuffer.hpp"
+#include "render_graph.hpp"
 #include "shader.hpp"
-#include "texture.hpp"
 
 namespace Renderer {
 
+// Gbuffer textures as render graph transients, the graph allocates them and keeps them across
+// frames while the size stays the same
 class GBuffer : public NoCopyNoMove {
 public:
     GBuffer() = default;
-    ~GBuffer();
+    ~GBuffer() = default;
 
-    void init(int screen_width, int screen_height);
-    void reinit(int screen_width, int screen_height);
-    void bind();
-    void unbind();
+    // Creates this frame's transients, call after RenderGraph::begin_frame()
+    void declare(RenderGraph& graph, i32 width, i32 height);
 
-    void blit_depth_buffer();
+    // Color and depth attachments of the geometry pass
+    void write(RenderGraph::Builder& builder) const;
+    void read(RenderGraph::Builder& builder) const;
 
-    void set_uniforms(Renderer::ShaderProgram& shader);
+    void set_uniforms(RenderGraph& graph, Renderer::ShaderProgram& shader) const;
 
-private:
-    bool initialized = false;
-
-    Renderer::Framebuffer m_buffer;
+    // Albedo + ao (RGBA8), octahedral normal (RG16_SNORM), metallic + roughness (RG8) and depth
+    static constexpr u32 BYTES_PER_PIXEL = 4 + 4 + 2 + 4;
+    [[nodiscard]] usize get_size_bytes() const;
 
-    Renderer::Texture m_position;
-    Renderer::Texture m_normal;
-    Renderer::Texture m_albedo;
+private:
+    RenderGraph::Resource m_albedo_ao = RenderGraph::INVALID_RESOURCE;
+    RenderGraph::Resource m_normal = RenderGraph::INVALID_RESOURCE;
+    RenderGraph::Resource m_material = RenderGraph::INVALID_RESOURCE;
 
-    Renderer::Renderbuffer m_depth;
+    // Sampled by the lighting pass to rebuild the world position
+    RenderGraph::Resource m_depth = RenderGraph::INVALID_RESOURCE;
 
     i32 m_buffer_width {};
     i32 m_buffer_height {};
@@ -0,0 +1,218 @@
+#include "gl_state.hpp"
+
+#include "counters.hpp"
+
+namespace Renderer::GlState {
+
+namespace {
+    // GL names are never this value, it marks a binding the cache doesn't know
+    constexpr GLuint UNKNOWN = std::numeric_limits<GLuint>::max();
+
+    struct State {
+        GLuint program = UNKNOWN;
+        GLuint vertex_array = UNKNOWN;
+        std::unordered_map<GLenum, GLuint> buffers;
+        std::unordered_map<u64, GLuint> indexed_buffers;
+        std::vector<GLuint> texture_units;
+        std::unordered_map<GLenum, bool> caps;
+
+        GLenum depth_func = GL_NONE;
+        i8 depth_mask = -1;
+        i8 color_mask = -1;
+        GLenum cull_face = GL_NONE;
+        std::pair<GLenum, GLenum> blend_func = { GL_NONE, GL_NONE };
+
+        Stats stats;
+        Stats frame_stats;
+    };
+
+    State state;
+
+    // True when the call can be skipped, value is updated either way
+    template <typename T>
+    bool cached(T& current, const T& value)
+    {
+        state.stats.calls++;
+        if (current == value) {
+            state.stats.saved++;
+            return true;
+        }
+        current = value;
+        return false;
+    }
+
+    u64 get_indexed_key(GLenum target, GLuint index)
+    {
+        return (static_cast<u64>(target) << 32) | index;
+    }
+} // anonymous namespace
+
+void use_program(GLuint program)
+{
+    if (!cached(state.program, program)) {
+        glUseProgram(program);
+        Counters::add(Counters::Counter::ProgramBinds);
+    }
+}
+
+void bind_vertex_array(GLuint vertex_array)
+{
+    if (!cached(state.vertex_array, vertex_array)) {
+        glBindVertexArray(vertex_array);
+        // The element buffer binding belongs to the vertex array
+        state.buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+    }
+}
+
+void bind_buffer(GLenum target, GLuint buffer)
+{
+    auto [it, inserted] = state.buffers.try_emplace(target, UNKNOWN);
+    if (!cached(it->second, buffer)) {
+        glBindBuffer(target, buffer);
+    }
+}
+
+void bind_buffer_base(GLenum target, GLuint index, GLuint buffer)
+{
+    auto [it, inserted] = state.indexed_buffers.try_emplace(get_indexed_key(target, index), UNKNOWN);
+    if (!cached(it->second, buffer)) {
+        glBindBufferBase(target, index, buffer);
+        // glBindBufferBase binds the generic binding point too
+        state.buffers[target] = buffer;
+    }
+}
+
+void bind_texture_unit(GLuint unit, GLuint texture)
+{
+    if (unit >= state.texture_units.size()) {
+        state.texture_units.resize(unit + 1, UNKNOWN);
+    }
+    if (!cached(state.texture_units[unit], texture)) {
+        glBindTextureUnit(unit, texture);
+        Counters::add(Counters::Counter::TextureBinds);
+    }
+}
+
+void set_enabled(GLenum cap, bool enabled)
+{
+    auto it = state.caps.find(cap);
+    if (it != state.caps.end()) {
+        if (cached(it->second, enabled)) {
+            return;
+        }
+    } else {
+        state.stats.calls++;
+        state.caps.emplace(cap, enabled);
+    }
+
+    if (enabled) {
+        glEnable(cap);
+    } else {
+        glDisable(cap);
+    }
+}
+
+void enable(GLenum cap)
+{
+    set_enabled(cap, true);
+}
+
+void disable(GLenum cap)
+{
+    set_enabled(cap, false);
+}
+
+void depth_func(GLenum func)
+{
+    if (!cached(state.depth_func, func)) {
+        glDepthFunc(func);
+    }
+}
+
+void depth_mask(bool enabled)
+{
+    if (!cached(state.depth_mask, static_cast<i8>(enabled))) {
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+    }
+}
+
+void color_mask(bool enabled)
+{
+    if (!cached(state.color_mask, static_cast<i8>(enabled))) {
+        const GLboolean mask = enabled ? GL_TRUE : GL_FALSE;
+        glColorMask(mask, mask, mask, mask);
+    }
+}
+
+void cull_face(GLenum mode)
+{
+    if (!cached(state.cull_face, mode)) {
+        glCullFace(mode);
+    }
+}
+
+void blend_func(GLenum source, GLenum destination)
+{
+    if (!cached(state.blend_func, std::pair { source, destination })) {
+        glBlendFunc(source, destination);
+    }
+}
+
+void forget_program(GLuint program)
+{
+    if (state.program == program) {
+        state.program = UNKNOWN;
+    }
+}
+
+void forget_vertex_array(GLuint vertex_array)
+{
+    if (state.vertex_array == vertex_array) {
+        state.vertex_array = UNKNOWN;
+    }
+}
+
+void forget_buffer(GLuint buffer)
+{
+    for (auto& [target, bound] : state.buffers) {
+        if (bound == buffer) {
+            bound = UNKNOWN;
+        }
+    }
+    for (auto& [key, bound] : state.indexed_buffers) {
+        if (bound == buffer) {
+            bound = UNKNOWN;
+        }
+    }
+}
+
+void forget_texture(GLuint texture)
+{
+    for (auto& bound : state.texture_units) {
+        if (bound == texture) {
+            bound = UNKNOWN;
+        }
+    }
+}
+
+void invalidate()
+{
+    const Stats stats = state.stats;
+    const Stats frame_stats = state.frame_stats;
+    state = State {};
+    state.stats = stats;
+    state.frame_stats = frame_stats;
+}
+
+void begin_frame()
+{
+    state.frame_stats = state.stats;
+    state.stats = Stats {};
+}
+
+[[nodiscard]] const Stats& get_frame_stats()
+{
+    return state.frame_stats;
+}
+
+} // namespace Renderer::GlState
@@ -0,0 +1,42 @@
+#pragma once
+
+// Shadow copy of the GL state the renderer touches, calls that would not change anything are
+// dropped. Everything that binds or toggles this state has to go through here or invalidate()
+// the cache afterwards. ImGui's backend restores whatever it changes, so it is safe to ignore
+namespace Renderer::GlState {
+
+struct Stats {
+    // Calls made through the cache and the ones that never reached the driver
+    u32 calls = 0;
+    u32 saved = 0;
+};
+
+void use_program(GLuint program);
+void bind_vertex_array(GLuint vertex_array);
+void bind_buffer(GLenum target, GLuint buffer);
+void bind_buffer_base(GLenum target, GLuint index, GLuint buffer);
+void bind_texture_unit(GLuint unit, GLuint texture);
+
+void set_enabled(GLenum cap, bool enabled);
+void enable(GLenum cap);
+void disable(GLenum cap);
+void depth_func(GLenum func);
+void depth_mask(bool enabled);
+void color_mask(bool enabled);
+void cull_face(GLenum mode);
+void blend_func(GLenum source, GLenum destination);
+
+// Called when the object is deleted, GL reuses names and a stale entry would skip the next bind
+void forget_program(GLuint program);
+void forget_vertex_array(GLuint vertex_array);
+void forget_buffer(GLuint buffer);
+void forget_texture(GLuint texture);
+
+// Forgets everything, for code that changed the state behind the cache's back
+void invalidate();
+
+// Moves the counters of the frame that ended into get_frame_stats()
+void begin_frame();
+[[nodiscard]] const Stats& get_frame_stats();
+
+} // namespace Renderer::GlState
@@ -0,0 +1,123 @@
+#include "gpu_culling.hpp"
+
+#include "extensions.hpp"
+#include "frustum_culling.hpp"
+#include "gl_state.hpp"
+
+namespace Renderer {
+
+GpuCulling::~GpuCulling()
+{
+    initialized = false;
+}
+
+void GpuCulling::init()
+{
+    util_assert(initialized == false, "GpuCulling::init() has already been initialized");
+    util_assert(is_supported(), "GpuCulling requires GL_ARB_bindless_texture for the indirect draw path");
+
+    auto reset_shader_info = get_reset_shader_info();
+    m_reset_shader.init(reset_shader_info.data(), reset_shader_info.size());
+
+    auto cull_shader_info = get_cull_shader_info();
+    m_cull_shader.init(cull_shader_info.data(), cull_shader_info.size());
+
+    std::array<u32, 4> zero_stats {};
+    for (auto& stats_buffer : m_stats_buffers) {
+        stats_buffer.init();
+        stats_buffer.buffer_storage(sizeof(zero_stats), zero_stats.data(), GL_DYNAMIC_STORAGE_BIT);
+    }
+
+    initialized = true;
+}
+
+void GpuCulling::begin_frame(const glm::mat4& view_proj)
+{
+    util_assert(initialized == true, "GpuCulling has not been initialized");
+
+    // The oldest buffer was written STATS_FRAMES frames ago, read it back before reusing it
+    Buffer& stats_buffer = m_stats_buffers.at(m_frame % STATS_FRAMES);
+    if (m_frame >= STATS_FRAMES) {
+        std::array<u32, 4> stats {};
+        glGetNamedBufferSubData(stats_buffer.get_id(), 0, sizeof(stats), stats.data());
+        m_stats.frustum_culled = stats[0];
+        m_stats.visible_phase_0 = stats[2];
+        m_stats.visible_phase_1 = stats[3];
+        // Phase 1 recovers some of what phase 0 rejected
+        m_stats.occluded = stats[1] - std::min(stats[1], stats[3]);
+    }
+    glClearNamedBufferData(stats_buffer.get_id(), GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, STATS_BINDING, stats_buffer.get_id());
+    m_frame++;
+
+    const Frustum frustum(view_proj);
+    const std::array<const Plane*, 6> planes = {
+        &frustum.left_face,
+        &frustum.right_face,
+        &frustum.bottom_face,
+        &frustum.top_face,
+        &frustum.near_face,
+        &frustum.far_face,
+    };
+
+    m_cull_shader.bind();
+    m_cull_shader.set_mat4("view_proj", view_proj);
+    for (usize i = 0; i < planes.size(); i++) {
+        m_cull_shader.set_vec4(std::format("frustum_planes[{}]", i).c_str(), glm::vec4(planes[i]->get_normal(), -planes[i]->get_distance()));
+    }
+}
+
+void GpuCulling::begin_phase(u32 phase, HiZ& hi_z)
+{
+    util_assert(initialized == true, "GpuCulling has not been initialized");
+    util_assert(phase < PHASE_COUNT, std::format("GpuCulling phase \"{}\" is out of range", phase));
+
+    m_cull_shader.bind();
+    m_cull_shader.set_int("phase", static_cast<int>(phase));
+    m_cull_shader.set_bool("use_hi_z", hi_z.is_valid());
+
+    GLuint texture_unit = Texture::get_texture_unit();
+    hi_z.get_texture().bind(texture_unit);
+    m_cull_shader.set_int("hi_z", static_cast<int>(texture_unit));
+}
+
+void GpuCulling::end_phase()
+{
+    util_assert(initialized == true, "GpuCulling has not been initialized");
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+[[nodiscard]] ShaderProgram& GpuCulling::get_reset_shader()
+{
+    util_assert(initialized == true, "GpuCulling has not been initialized");
+    return m_reset_shader;
+}
+
+[[nodiscard]] ShaderProgram& GpuCulling::get_cull_shader()
+{
+    util_assert(initialized == true, "GpuCulling has not been initialized");
+    return m_cull_shader;
+}
+
+[[nodiscard]] const GpuCulling::Stats& GpuCulling::get_stats() const
+{
+    util_assert(initialized == true, "GpuCulling has not been initialized");
+    return m_stats;
+}
+
+[[nodiscard]] bool GpuCulling::is_initialized() const
+{
+    return initialized;
+}
+
+[[nodiscard]] bool GpuCulling::is_supported()
+{
+    return Renderer::Extensions::is_extension_supported("GL_ARB_bindless_texture");
+}
+
+[[nodiscard]] GLuint GpuCulling::get_group_count(usize invocations)
+{
+    return static_cast<GLuint>((invocations + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE);
+}
+
+} // namespace Renderer
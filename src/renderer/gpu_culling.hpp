@@ -0,0 +1,286 @@
+#pragma once
+
+#include "buffer.hpp"
+#include "hi_z.hpp"
+#include "shader.hpp"
+
+namespace Renderer {
+
+// Frustum and hierarchical-Z occlusion culling of every (command, instance) pair on the gpu.
+// Phase 0 tests against last frame's HiZ, phase 1 re-tests what phase 0 rejected against the
+// HiZ built from this frame's phase 0 depth so objects that became visible only lag a phase
+class GpuCulling : public NoCopyNoMove {
+public:
+    struct Stats {
+        u32 frustum_culled = 0;
+        u32 occluded = 0;
+        u32 visible_phase_0 = 0;
+        u32 visible_phase_1 = 0;
+    };
+
+    GpuCulling() = default;
+    ~GpuCulling();
+
+    void init();
+
+    void begin_frame(const glm::mat4& view_proj);
+    void begin_phase(u32 phase, HiZ& hi_z);
+    // Makes the culled commands visible to indirect draws
+    void end_phase();
+
+    [[nodiscard]] ShaderProgram& get_reset_shader();
+    [[nodiscard]] ShaderProgram& get_cull_shader();
+    // Counts lag STATS_FRAMES frames behind so reading them never stalls
+    [[nodiscard]] const Stats& get_stats() const;
+    [[nodiscard]] bool is_initialized() const;
+
+    // Needs the indirect path
+    [[nodiscard]] static bool is_supported();
+    [[nodiscard]] static GLuint get_group_count(usize invocations);
+
+    static constexpr u32 PHASE_COUNT = 2;
+    static constexpr GLuint WORK_GROUP_SIZE = 64;
+
+    // Shader storage bindings, 1 is the model matrices like every other pass
+    static constexpr GLuint COMMANDS_BINDING = 5;
+    static constexpr GLuint CULLED_COMMANDS_BINDING = 6;
+    static constexpr GLuint BOUNDS_BINDING = 7;
+    static constexpr GLuint INSTANCE_REMAP_BINDING = 8;
+    static constexpr GLuint VISIBILITY_BINDING = 9;
+    static constexpr GLuint STATS_BINDING = 10;
+
+private:
+    static consteval std::array<Renderer::ShaderInfo, 1> get_reset_shader_info()
+    {
+        return std::array<Renderer::ShaderInfo, 1> {
+            Renderer::ShaderInfo {
+                .is_file = false,
+                .shader = get_reset_compute_shader(),
+                .type = GL_COMPUTE_SHADER,
+            },
+        };
+    }
+
+    static consteval std::array<Renderer::ShaderInfo, 1> get_cull_shader_info()
+    {
+        return std::array<Renderer::ShaderInfo, 1> {
+            Renderer::ShaderInfo {
+                .is_file = false,
+                .shader = get_cull_compute_shader(),
+                .type = GL_COMPUTE_SHADER,
+            },
+        };
+    }
+
+    static consteval const char* get_reset_compute_shader()
+    {
+        return R"(
+            #version 460 core
+            layout (local_size_x = 64) in;
+
+            struct Command {
+                uint count;
+                uint instance_count;
+                uint first_index;
+                int base_vertex;
+                uint base_instance;
+            };
+
+            layout(binding = 5, std430) readonly buffer ssbo_commands {
+                Command commands[];
+            };
+
+            layout(binding = 6, std430) writeonly buffer ssbo_culled_commands {
+                Command culled_commands[];
+            };
+
+            uniform int command_count;
+            uniform int instance_count;
+            uniform int phase;
+
+            void main()
+            {
+                int command = int(gl_GlobalInvocationID.x);
+                if (command >= command_count) {
+                    return;
+                }
+
+                // Every (phase, command) gets its own run of instance_count slots in the remap
+                int slot = phase * command_count + command;
+                Command culled = commands[command];
+                culled.instance_count = 0;
+                culled.base_instance = uint(slot * instance_count);
+                culled_commands[slot] = culled;
+            }
+        )";
+    }
+
+    static consteval const char* get_cull_compute_shader()
+    {
+        return R"(
+            #version 460 core
+            layout (local_size_x = 64) in;
+
+            struct Command {
+                uint count;
+                uint instance_count;
+                uint first_index;
+                int base_vertex;
+                uint base_instance;
+            };
+
+            layout(binding = 1, std430) readonly buffer ssbo_models {
+                mat4 models[];
+            };
+
+            layout(binding = 6, std430) buffer ssbo_culled_commands {
+                Command culled_commands[];
+            };
+
+            // Local space center and extents per command
+            layout(binding = 7, std430) readonly buffer ssbo_bounds {
+                vec4 bounds[];
+            };
+
+            layout(binding = 8, std430) writeonly buffer ssbo_instance_remap {
+                uint instance_remap[];
+            };
+
+            // 1 when phase 0 drew the instance
+            layout(binding = 9, std430) buffer ssbo_visibility {
+                uint visibility[];
+            };
+
+            // frustum culled, rejected by phase 0, visible in phase 0, visible in phase 1
+            layout(binding = 10, std430) buffer ssbo_stats {
+                uint stats[];
+            };
+
+            uniform mat4 view_proj;
+            uniform vec4 frustum_planes[6];
+            uniform sampler2D hi_z;
+            uniform bool use_hi_z;
+
+            uniform int command_count;
+            uniform int instance_count;
+            uniform int phase;
+
+            bool is_in_frustum(vec3 center, vec3 extents)
+            {
+                for (int i = 0; i < 6; i++) {
+                    vec4 plane = frustum_planes[i];
+                    if (dot(plane.xyz, center) + plane.w + dot(abs(plane.xyz), extents) < 0.0) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            bool is_occluded(vec3 center, vec3 extents)
+            {
+                vec3 ndc_min = vec3(1.0);
+                vec3 ndc_max = vec3(-1.0);
+                for (int i = 0; i < 8; i++) {
+                    vec3 corner = center + extents * vec3(
+                        (i & 1) != 0 ? 1.0 : -1.0,
+                        (i & 2) != 0 ? 1.0 : -1.0,
+                        (i & 4) != 0 ? 1.0 : -1.0);
+                    vec4 clip = view_proj * vec4(corner, 1.0);
+
+                    // Crosses the camera plane, the projected rectangle is meaningless
+                    if (clip.w <= 0.0) {
+                        return false;
+                    }
+
+                    vec3 ndc = clip.xyz / clip.w;
+                    ndc_min = min(ndc_min, ndc);
+                    ndc_max = max(ndc_max, ndc);
+                }
+
+                vec2 uv_min = clamp(ndc_min.xy * 0.5 + 0.5, 0.0, 1.0);
+                vec2 uv_max = clamp(ndc_max.xy * 0.5 + 0.5, 0.0, 1.0);
+                float closest_depth = ndc_min.z * 0.5 + 0.5;
+
+                // Pick the level where the rectangle is at most one texel wide, so it touches 2x2 texels at most
+                vec2 size = (uv_max - uv_min) * vec2(textureSize(hi_z, 0));
+                int level = int(ceil(log2(max(max(size.x, size.y), 1.0))));
+                level = clamp(level, 0, textureQueryLevels(hi_z) - 1);
+
+                ivec2 level_size = textureSize(hi_z, level);
+                ivec2 texel_min = clamp(ivec2(uv_min * vec2(level_size)), ivec2(0), level_size - 1);
+                ivec2 texel_max = clamp(ivec2(uv_max * vec2(level_size)), ivec2(0), level_size - 1);
+
+                float farthest_depth = 0.0;
+                for (int y = texel_min.y; y <= texel_max.y; y++) {
+                    for (int x = texel_min.x; x <= texel_max.x; x++) {
+                        farthest_depth = max(farthest_depth, texelFetch(hi_z, ivec2(x, y), level).g);
+                    }
+                }
+
+                return closest_depth > farthest_depth;
+            }
+
+            void main()
+            {
+                int id = int(gl_GlobalInvocationID.x);
+                if (id >= command_count * instance_count) {
+                    return;
+                }
+
+                // Phase 1 only re-tests what phase 0 rejected
+                if (phase == 1 && visibility[id] != 0) {
+                    return;
+                }
+
+                int command = id / instance_count;
+                int instance = id % instance_count;
+
+                mat4 model = models[instance];
+                vec3 local_center = bounds[command * 2].xyz;
+                vec3 local_extents = bounds[command * 2 + 1].xyz;
+
+                vec3 center = vec3(model * vec4(local_center, 1.0));
+                mat3 basis = mat3(model);
+                vec3 extents = abs(basis[0]) * local_extents.x
+                    + abs(basis[1]) * local_extents.y
+                    + abs(basis[2]) * local_extents.z;
+
+                bool visible = is_in_frustum(center, extents);
+                if (!visible) {
+                    if (phase == 0) {
+                        atomicAdd(stats[0], 1u);
+                    }
+                } else if (use_hi_z && is_occluded(center, extents)) {
+                    visible = false;
+                    if (phase == 0) {
+                        atomicAdd(stats[1], 1u);
+                    }
+                }
+
+                if (visible) {
+                    int slot = phase * command_count + command;
+                    uint remap_index = atomicAdd(culled_commands[slot].instance_count, 1u);
+                    instance_remap[slot * instance_count + int(remap_index)] = uint(instance);
+                    atomicAdd(stats[2 + phase], 1u);
+                }
+
+                if (phase == 0) {
+                    visibility[id] = visible ? 1u : 0u;
+                }
+            }
+        )";
+    }
+
+    static constexpr u32 STATS_FRAMES = 3;
+
+    bool initialized = false;
+
+    Renderer::ShaderProgram m_reset_shader;
+    Renderer::ShaderProgram m_cull_shader;
+
+    std::array<Renderer::Buffer, STATS_FRAMES> m_stats_buffers;
+    u64 m_frame = 0;
+    Stats m_stats;
+};
+
+} // namespace Renderer
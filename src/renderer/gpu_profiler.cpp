@@ -0,0 +1,223 @@
+#include "gpu_profiler.hpp"
+
+#include "../utils/profiler.hpp"
+
+namespace Renderer::GpuProfiler {
+
+namespace {
+    constexpr u32 POOL_COUNT = 2;
+
+    struct Record {
+        const char* name;
+        u32 depth;
+        u32 begin_query;
+        u32 end_query;
+        i64 cpu_begin_ns;
+        i64 cpu_end_ns;
+    };
+
+    struct Pool {
+        std::vector<GLuint> queries;
+        u32 used = 0;
+        std::vector<Record> records;
+        bool pending = false;
+        // CPU minus GPU clock when the frame started
+        i64 clock_offset_ns = 0;
+        u64 frame = 0;
+    };
+
+    struct State {
+        std::array<Pool, POOL_COUNT> pools;
+        u32 current = 0;
+        bool recording = false;
+        u64 frame = 0;
+        std::vector<u32> open_records;
+
+        std::vector<ScopeResult> results;
+        u64 results_frame = 0;
+        u64 dropped_frames = 0;
+
+        bool has_trace_track = false;
+        u32 trace_track = 0;
+    };
+
+    State state;
+
+    u32 next_query(Pool& pool)
+    {
+        if (pool.used == pool.queries.size()) {
+            // Grows in steps, scopes per frame settle quickly
+            const usize count = std::max<usize>(pool.queries.size(), 32);
+            pool.queries.resize(pool.queries.size() + count);
+            glCreateQueries(GL_TIMESTAMP, static_cast<GLsizei>(count), pool.queries.data() + pool.used);
+        }
+        glQueryCounter(pool.queries[pool.used], GL_TIMESTAMP);
+        return pool.used++;
+    }
+
+    void add_trace_events(const std::vector<ScopeResult>& results)
+    {
+        if (!state.has_trace_track) {
+            state.trace_track = Utils::Profiler::register_track("GPU");
+            state.has_trace_track = true;
+        }
+        for (const auto& result : results) {
+            Utils::Profiler::add_trace_event(state.trace_track, result.name, result.gpu_begin_ns, result.gpu_end_ns);
+        }
+    }
+
+    // Reads a pool back if the gpu is done with it, false when it is still in flight
+    bool resolve(Pool& pool)
+    {
+        if (!pool.pending) {
+            return true;
+        }
+
+        if (pool.used > 0) {
+            GLint available = GL_FALSE;
+            glGetQueryObjectiv(pool.queries[pool.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available == GL_FALSE) {
+                return false;
+            }
+        }
+
+        std::vector<GLuint64> timestamps(pool.used);
+        for (u32 i = 0; i < pool.used; i++) {
+            glGetQueryObjectui64v(pool.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+        }
+
+        state.results.clear();
+        for (const auto& record : pool.records) {
+            state.results.emplace_back(ScopeResult {
+                .name = record.name,
+                .depth = record.depth,
+                .gpu_begin_ns = static_cast<i64>(timestamps[record.begin_query]) + pool.clock_offset_ns,
+                .gpu_end_ns = static_cast<i64>(timestamps[record.end_query]) + pool.clock_offset_ns,
+                .cpu_begin_ns = record.cpu_begin_ns,
+                .cpu_end_ns = record.cpu_end_ns,
+            });
+        }
+        state.results_frame = pool.frame;
+        pool.pending = false;
+
+        // The flight recorder keeps them even when no trace is being captured
+        add_trace_events(state.results);
+        return true;
+    }
+} // anonymous namespace
+
+void begin_frame()
+{
+    util_assert(state.recording == false, "GpuProfiler::begin_frame() called twice without end_frame()");
+
+    state.frame++;
+    state.current = (state.current + 1) % POOL_COUNT;
+    Pool& pool = state.pools[state.current];
+
+    // Still in flight, skip this frame instead of stalling
+    if (!resolve(pool)) {
+        state.dropped_frames++;
+        return;
+    }
+
+    GLint64 gpu_now = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+    pool.clock_offset_ns = Utils::Profiler::now_ns() - gpu_now;
+    pool.used = 0;
+    pool.records.clear();
+    pool.frame = state.frame;
+    state.open_records.clear();
+    state.recording = true;
+}
+
+void end_frame()
+{
+    if (!state.recording) {
+        return;
+    }
+    util_assert(state.open_records.empty(), "GpuProfiler::end_frame() called with open scopes");
+
+    state.pools[state.current].pending = true;
+    state.recording = false;
+}
+
+void begin_scope(const char* name)
+{
+    if (!state.recording) {
+        return;
+    }
+
+    Pool& pool = state.pools[state.current];
+    pool.records.emplace_back(Record {
+        .name = name,
+        .depth = static_cast<u32>(state.open_records.size()),
+        .begin_query = next_query(pool),
+        .end_query = 0,
+        .cpu_begin_ns = Utils::Profiler::now_ns(),
+        .cpu_end_ns = 0,
+    });
+    state.open_records.emplace_back(static_cast<u32>(pool.records.size() - 1));
+}
+
+void end_scope()
+{
+    if (!state.recording) {
+        return;
+    }
+    util_assert(!state.open_records.empty(), "GpuProfiler::end_scope() called without begin_scope()");
+
+    Pool& pool = state.pools[state.current];
+    Record& record = pool.records[state.open_records.back()];
+    record.end_query = next_query(pool);
+    record.cpu_end_ns = Utils::Profiler::now_ns();
+    state.open_records.pop_back();
+}
+
+[[nodiscard]] std::span<const ScopeResult> get_results()
+{
+    return state.results;
+}
+
+[[nodiscard]] u64 get_results_frame()
+{
+    return state.results_frame;
+}
+
+void draw_imgui()
+{
+    ImGui::Text("Frame %llu, %llu frames dropped while queries were in flight",
+        static_cast<unsigned long long>(state.results_frame),
+        static_cast<unsigned long long>(state.dropped_frames));
+
+    if (ImGui::BeginTable("gpu_profiler", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Scope");
+        ImGui::TableSetupColumn("GPU ms");
+        ImGui::TableSetupColumn("CPU ms");
+        ImGui::TableHeadersRow();
+
+        for (const auto& result : state.results) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Indent(static_cast<f32>(result.depth) * 10.0F);
+            ImGui::TextUnformatted(result.name);
+            ImGui::Unindent(static_cast<f32>(result.depth) * 10.0F);
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%.3f", result.get_gpu_ms());
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.3f", result.get_cpu_ms());
+        }
+        ImGui::EndTable();
+    }
+}
+
+void shutdown()
+{
+    for (auto& pool : state.pools) {
+        if (!pool.queries.empty()) {
+            glDeleteQueries(static_cast<GLsizei>(pool.queries.size()), pool.queries.data());
+        }
+    }
+    state = State {};
+}
+
+} // namespace Renderer::GpuProfiler
@@ -0,0 +1,46 @@
+#pragma once
+
+// Named GPU scopes timed with GL_TIMESTAMP queries. There are two query pools, a frame's results
+// are read back when its pool comes around again two frames later, and a frame whose queries
+// are still in flight is dropped instead of waited on. Every scope also keeps the CPU time spent
+// recording it. While the CPU profiler captures a trace the GPU times go on their own track
+namespace Renderer::GpuProfiler {
+
+struct ScopeResult {
+    const char* name;
+    u32 depth;
+    // Nanoseconds on the CPU clock, GPU times are moved there with a per frame offset
+    i64 gpu_begin_ns;
+    i64 gpu_end_ns;
+    i64 cpu_begin_ns;
+    i64 cpu_end_ns;
+
+    [[nodiscard]] f64 get_gpu_ms() const { return static_cast<f64>(gpu_end_ns - gpu_begin_ns) / 1'000'000.0; }
+    [[nodiscard]] f64 get_cpu_ms() const { return static_cast<f64>(cpu_end_ns - cpu_begin_ns) / 1'000'000.0; }
+};
+
+// Brackets everything between swaps, scopes outside a frame are ignored
+void begin_frame();
+void end_frame();
+
+// Names have to outlive the frame, string literals in practice
+void begin_scope(const char* name);
+void end_scope();
+
+class Scope : public NoCopyNoMove {
+public:
+    explicit Scope(const char* name) { begin_scope(name); }
+    ~Scope() { end_scope(); }
+};
+
+// Scopes of the newest frame that was read back
+[[nodiscard]] std::span<const ScopeResult> get_results();
+// Frame number of get_results(), changes when a newer frame was read back
+[[nodiscard]] u64 get_results_frame();
+
+void draw_imgui();
+
+// Deletes the queries, has to run while the context is alive
+void shutdown();
+
+} // namespace Renderer::GpuProfiler
@@ -0,0 +1,78 @@
+#include "gpu_timer.hpp"
+
+namespace Renderer {
+
+GpuTimer::~GpuTimer()
+{
+    if (initialized) {
+        glDeleteQueries(QUERY_COUNT, m_queries.data());
+        initialized = false;
+    }
+}
+
+void GpuTimer::init()
+{
+    util_assert(initialized == false, "GpuTimer::init() has already been initialized");
+    glCreateQueries(GL_TIME_ELAPSED, QUERY_COUNT, m_queries.data());
+    initialized = true;
+}
+
+void GpuTimer::begin()
+{
+    util_assert(initialized == true, "GpuTimer has not been initialized");
+    util_assert(m_active == false, "GpuTimer::begin() called twice without end()");
+
+    poll_results();
+
+    // Every query is still in flight, skip timing this frame instead of waiting on the gpu
+    if (m_pending[m_current]) {
+        return;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[m_current]);
+    m_active = true;
+}
+
+void GpuTimer::end()
+{
+    util_assert(initialized == true, "GpuTimer has not been initialized");
+    if (!m_active) {
+        return;
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    m_pending[m_current] = true;
+    m_current = (m_current + 1) % QUERY_COUNT;
+    m_active = false;
+}
+
+void GpuTimer::poll_results()
+{
+    while (m_pending[m_oldest]) {
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(m_queries[m_oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_FALSE) {
+            return;
+        }
+
+        GLuint64 elapsed_ns = 0;
+        glGetQueryObjectui64v(m_queries[m_oldest], GL_QUERY_RESULT, &elapsed_ns);
+        m_ms = static_cast<f32>(static_cast<f64>(elapsed_ns) / 1'000'000.0);
+
+        m_pending[m_oldest] = false;
+        m_oldest = (m_oldest + 1) % QUERY_COUNT;
+    }
+}
+
+[[nodiscard]] f32 GpuTimer::get_ms() const
+{
+    util_assert(initialized == true, "GpuTimer has not been initialized");
+    return m_ms;
+}
+
+[[nodiscard]] bool GpuTimer::is_initialized() const
+{
+    return initialized;
+}
+
+} // namespace Renderer
@@ -0,0 +1,35 @@
+#pragma once
+
+namespace Renderer {
+
+// GL_TIME_ELAPSED query ring, results are read back a few frames later without stalling
+class GpuTimer : public NoCopyNoMove {
+public:
+    GpuTimer() = default;
+    ~GpuTimer();
+
+    void init();
+
+    void begin();
+    void end();
+
+    [[nodiscard]] f32 get_ms() const;
+    [[nodiscard]] bool is_initialized() const;
+
+private:
+    static constexpr usize QUERY_COUNT = 3;
+
+    bool initialized = false;
+
+    std::array<GLuint, QUERY_COUNT> m_queries {};
+    std::array<bool, QUERY_COUNT> m_pending {};
+    usize m_current = 0;
+    usize m_oldest = 0;
+    bool m_active = false;
+
+    f32 m_ms = 0.0F;
+
+    void poll_results();
+};
+
+} // namespace Renderer
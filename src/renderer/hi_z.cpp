@@ -0,0 +1,126 @@
+#include "hi_z.hpp"
+
+namespace Renderer {
+
+namespace {
+    constexpr i32 WORK_GROUP_SIZE = 8;
+
+    GLuint get_group_count(i32 size)
+    {
+        return static_cast<GLuint>((size + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE);
+    }
+} // anonymous namespace
+
+HiZ::~HiZ()
+{
+    initialized = false;
+}
+
+void HiZ::init(i32 width, i32 height)
+{
+    util_assert(initialized == false, "HiZ::init() has already been initialized");
+
+    m_width = width;
+    m_height = height;
+    m_mip_count = static_cast<i32>(std::bit_width(static_cast<u32>(std::max(m_width, m_height))));
+    m_valid = false;
+
+    Renderer::TextureInfo texture_info;
+    texture_info.size = Renderer::TextureSize { .width = m_width, .height = m_height, .depth = 0 };
+    texture_info.internal_format = GL_RG32F;
+    texture_info.levels = m_mip_count;
+    texture_info.mipmaps = GL_FALSE;
+    texture_info.wrap_s = GL_CLAMP_TO_EDGE;
+    texture_info.wrap_t = GL_CLAMP_TO_EDGE;
+    m_texture.init(texture_info);
+
+    if (!m_shader.is_initialized()) {
+        auto shader_info = get_shader_info();
+        m_shader.init(shader_info.data(), shader_info.size());
+    }
+
+    initialized = true;
+}
+
+void HiZ::reinit(i32 width, i32 height)
+{
+    util_assert(initialized == true, "HiZ has not been initialized");
+
+    m_texture.~Texture();
+    initialized = false;
+    init(width, height);
+}
+
+void HiZ::build(Texture& depth)
+{
+    util_assert(initialized == true, "HiZ has not been initialized");
+
+    m_shader.bind();
+    GLuint texture_unit = Texture::get_texture_unit();
+    m_shader.set_int("src", static_cast<int>(texture_unit));
+
+    for (i32 level = 0; level < m_mip_count; level++) {
+        glm::ivec2 dst_size = get_mip_size(level);
+
+        if (level == 0) {
+            depth.bind(texture_unit);
+            m_shader.set_bool("from_depth", true);
+            m_shader.set_int("src_level", 0);
+            m_shader.set_ivec2("src_size", dst_size);
+        } else {
+            m_texture.bind(texture_unit);
+            m_shader.set_bool("from_depth", false);
+            m_shader.set_int("src_level", level - 1);
+            m_shader.set_ivec2("src_size", get_mip_size(level - 1));
+        }
+        m_shader.set_ivec2("dst_size", dst_size);
+
+        m_texture.bind_image(0, level, GL_WRITE_ONLY, GL_RG32F);
+        glDispatchCompute(get_group_count(dst_size.x), get_group_count(dst_size.y), 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+
+    m_valid = true;
+}
+
+[[nodiscard]] glm::ivec2 HiZ::get_mip_size(i32 level) const
+{
+    return { std::max(m_width >> level, 1), std::max(m_height >> level, 1) };
+}
+
+[[nodiscard]] bool HiZ::is_valid() const
+{
+    util_assert(initialized == true, "HiZ has not been initialized");
+    return m_valid;
+}
+
+[[nodiscard]] Texture& HiZ::get_texture()
+{
+    util_assert(initialized == true, "HiZ has not been initialized");
+    return m_texture;
+}
+
+[[nodiscard]] i32 HiZ::get_mip_count() const
+{
+    util_assert(initialized == true, "HiZ has not been initialized");
+    return m_mip_count;
+}
+
+[[nodiscard]] i32 HiZ::get_width() const
+{
+    util_assert(initialized == true, "HiZ has not been initialized");
+    return m_width;
+}
+
+[[nodiscard]] i32 HiZ::get_height() const
+{
+    util_assert(initialized == true, "HiZ has not been initialized");
+    return m_height;
+}
+
+[[nodiscard]] bool HiZ::is_initialized() const
+{
+    return initialized;
+}
+
+} // namespace Renderer
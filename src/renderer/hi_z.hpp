@@ -0,0 +1,104 @@
+#pragma once
+
+#include "shader.hpp"
+#include "texture.hpp"
+
+namespace Renderer {
+
+// Hierarchical depth buffer, every mip stores the min (r) and max (g) depth of the texels below it
+class HiZ : public NoCopyNoMove {
+public:
+    HiZ() = default;
+    ~HiZ();
+
+    void init(i32 width, i32 height);
+    void reinit(i32 width, i32 height);
+
+    // Rebuilds the pyramid from a depth texture of the same size
+    void build(Texture& depth);
+
+    // False until the first build after (re)initialization
+    [[nodiscard]] bool is_valid() const;
+    [[nodiscard]] Texture& get_texture();
+    [[nodiscard]] i32 get_mip_count() const;
+    [[nodiscard]] i32 get_width() const;
+    [[nodiscard]] i32 get_height() const;
+    [[nodiscard]] bool is_initialized() const;
+
+private:
+    static consteval std::array<Renderer::ShaderInfo, 1> get_shader_info()
+    {
+        return std::array<Renderer::ShaderInfo, 1> {
+            Renderer::ShaderInfo {
+                .is_file = false,
+                .shader = get_compute_shader(),
+                .type = GL_COMPUTE_SHADER,
+            },
+        };
+    }
+
+    static consteval const char* get_compute_shader()
+    {
+        return R"(
+            #version 460 core
+            layout (local_size_x = 8, local_size_y = 8) in;
+
+            layout (binding = 0, rg32f) uniform writeonly image2D dst;
+
+            // Depth texture for level 0, the pyramid itself for the rest
+            uniform sampler2D src;
+            uniform int src_level;
+            uniform bool from_depth;
+            uniform ivec2 src_size;
+            uniform ivec2 dst_size;
+
+            void main()
+            {
+                ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+                if (any(greaterThanEqual(texel, dst_size))) {
+                    return;
+                }
+
+                if (from_depth) {
+                    float depth = texelFetch(src, texel, 0).r;
+                    imageStore(dst, texel, vec4(depth, depth, 0.0, 0.0));
+                    return;
+                }
+
+                // Odd sized levels fold the last row/column into the last texel so nothing is skipped
+                ivec2 footprint = ivec2(2);
+                if (texel.x == dst_size.x - 1 && (src_size.x & 1) != 0) {
+                    footprint.x = 3;
+                }
+                if (texel.y == dst_size.y - 1 && (src_size.y & 1) != 0) {
+                    footprint.y = 3;
+                }
+
+                vec2 min_max = vec2(1.0, 0.0);
+                for (int y = 0; y < footprint.y; y++) {
+                    for (int x = 0; x < footprint.x; x++) {
+                        ivec2 src_texel = min(texel * 2 + ivec2(x, y), src_size - 1);
+                        vec2 value = texelFetch(src, src_texel, src_level).rg;
+                        min_max.x = min(min_max.x, value.x);
+                        min_max.y = max(min_max.y, value.y);
+                    }
+                }
+                imageStore(dst, texel, vec4(min_max, 0.0, 0.0));
+            }
+        )";
+    }
+
+    [[nodiscard]] glm::ivec2 get_mip_size(i32 level) const;
+
+    bool initialized = false;
+    bool m_valid = false;
+
+    i32 m_width {};
+    i32 m_height {};
+    i32 m_mip_count {};
+
+    Renderer::Texture m_texture;
+    Renderer::ShaderProgram m_shader;
+};
+
+} // namespace Renderer
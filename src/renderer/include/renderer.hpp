@@ -3,8 +3,13 @@
 
 #include "../buffer.hpp"
 #include "../camera.hpp"
+#include "../counters.hpp"
 #include "../extensions.hpp"
 #include "../framebuffer.hpp"
+#include "../frustum_culling.hpp"
+#include "../gl_state.hpp"
+#include "../gpu_profiler.hpp"
+#include "../gpu_timer.hpp"
 #include "../renderbuffer.hpp"
 #include "../shader.hpp"
 #include "../texture.hpp"
@@ -12,15 +17,21 @@
 #include "../window.hpp"
 
 #include "../gbuffer.hpp"
+#include "../gpu_culling.hpp"
+#include "../hi_z.hpp"
 #include "../model.hpp"
+#include "../present.hpp"
 #include "../quad.hpp"
+#include "../render_graph.hpp"
+#include "../render_queue.hpp"
+#include "../shadow_atlas.hpp"
 #include "../shadowmap.hpp"
+#include "../tiled_lighting.hpp"
+#include "../visibility_buffer.hpp"
 
 #include "../light/phong/directional.hpp"
 #include "../light/phong/point.hpp"
 
 #include "../light/pbr/directional.hpp"
 #include "../light/pbr/point.hpp"
-#include "../light/pbr/spot.hpp"
-
-// #include "../frustum.hpp"
\ No newline at end of file
+#include "../light/pbr/spot.hpp"
\ No newline at end of file
@@ -11,6 +11,10 @@ Directional::~Directional()
 {
     if (initialized) {
         if (m_info.shadowmap) {
+            // Hands the tile back so a destroyed light does not keep its corner of the atlas
+            if (m_shadowmap_internal->m_atlas != nullptr) {
+                m_shadowmap_internal->m_atlas->free(m_shadowmap_internal->m_tile);
+            }
             delete m_shadowmap_internal;
         }
         initialized = false;
@@ -23,7 +27,6 @@ void Directional::init(DirectionalInfo& info)
 
     if (info.shadowmap) {
         m_shadowmap_internal = new ShadowMap_Internal();
-        m_shadowmap_internal->m_shadowmap.init();
     }
 
     m_info = info;
@@ -44,6 +47,8 @@ void Directional::update(DirectionalInfo& info)
             glm::vec3(0.0F, 1.0F, 0.0F));
 
         m_shadowmap_internal->m_light_space_matrix = light_projection * light_view;
+        m_shadowmap_internal->m_frustum.init(m_shadowmap_internal->m_light_space_matrix);
+        m_shadowmap_internal->m_dirty = true;
     }
 
     m_info = info;
@@ -54,15 +59,16 @@ void Directional::shadowmap_draw(Renderer::ShaderProgram& shader, const std::fun
     util_assert(initialized == true, "Light::Directional has not been initialized");
     util_assert(m_info.shadowmap == true, "Trying to call shadowmap_draw on a directional light without a shadowmap enabled");
 
-    glViewport(0, 0, m_shadowmap_internal->m_shadowmap.get_width(), m_shadowmap_internal->m_shadowmap.get_height());
-    m_shadowmap_internal->m_shadowmap.bind();
+    util_assert(m_shadowmap_internal->m_atlas != nullptr && m_shadowmap_internal->m_tile.is_valid(), "Directional::shadowmap_draw() called before a shadow tile was set");
+
+    m_shadowmap_internal->m_atlas->bind_tile(m_shadowmap_internal->m_tile);
 
-    glClear(GL_DEPTH_BUFFER_BIT);
     shader.bind();
     shader.set_mat4("light_space_matrix", m_shadowmap_internal->m_light_space_matrix);
     draw_function();
 
-    m_shadowmap_internal->m_shadowmap.unbind();
+    m_shadowmap_internal->m_atlas->unbind();
+    m_shadowmap_internal->m_dirty = false;
 }
 
 void Directional::set_uniforms(Renderer::ShaderProgram& shader, const char* light_name)
@@ -75,8 +81,9 @@ void Directional::set_uniforms(Renderer::ShaderProgram& shader, const char* ligh
     shader.set_vec3(std::format("{}.specular", light_name).c_str(), m_info.specular);
     if (m_info.shadowmap) {
         shader.set_mat4(std::format("{}.light_space_matrix", light_name).c_str(), m_shadowmap_internal->m_light_space_matrix);
+        shader.set_vec4(std::format("{}.shadow_rect", light_name).c_str(), m_shadowmap_internal->m_atlas->get_tile_rect(m_shadowmap_internal->m_tile));
         GLuint texture_unit = Texture::get_texture_unit();
-        m_shadowmap_internal->m_shadowmap.get_texture().bind(texture_unit);
+        m_shadowmap_internal->m_atlas->get_texture().bind(texture_unit);
         shader.set_int(std::format("{}.shadow_map", light_name).c_str(), static_cast<int>(texture_unit));
     }
 }
@@ -87,4 +94,47 @@ bool Directional::has_shadowmap()
     return m_info.shadowmap;
 }
 
+void Directional::set_shadow_tile(Renderer::ShadowAtlas& atlas, const Renderer::ShadowAtlas::Tile& tile)
+{
+    util_assert(initialized == true, "Light::Directional has not been initialized");
+    util_assert(m_info.shadowmap == true, "Trying to set a shadow tile on a directional light without a shadowmap enabled");
+
+    m_shadowmap_internal->m_atlas = &atlas;
+    m_shadowmap_internal->m_tile = tile;
+    m_shadowmap_internal->m_dirty = true;
+}
+
+[[nodiscard]] Renderer::ShadowAtlas::Tile& Directional::get_shadow_tile()
+{
+    util_assert(initialized == true, "Light::Directional has not been initialized");
+    util_assert(m_info.shadowmap == true, "Trying to get the shadow tile of a directional light without a shadowmap enabled");
+    return m_shadowmap_internal->m_tile;
+}
+
+void Directional::mark_shadow_dirty()
+{
+    util_assert(initialized == true, "Light::Directional has not been initialized");
+    if (m_info.shadowmap) {
+        m_shadowmap_internal->m_dirty = true;
+    }
+}
+
+[[nodiscard]] bool Directional::is_shadow_dirty() const
+{
+    util_assert(initialized == true, "Light::Directional has not been initialized");
+    return m_info.shadowmap && m_shadowmap_internal->m_dirty;
+}
+
+[[nodiscard]] bool Directional::is_in_shadow_volume(const AABB& bounds) const
+{
+    util_assert(initialized == true, "Light::Directional has not been initialized");
+    return m_info.shadowmap && bounds.is_on_frustum(m_shadowmap_internal->m_frustum);
+}
+
+[[nodiscard]] const DirectionalInfo& Directional::get_info() const
+{
+    util_assert(initialized == true, "Light::Directional has not been initialized");
+    return m_info;
+}
+
 } // namespace Renderer::Light::Phong
\ No newline at end of file
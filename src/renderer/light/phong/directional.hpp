@@ -1,7 +1,8 @@
 #pragma once
 
+#include "../frustum_culling.hpp"
 #include "../shader.hpp"
-#include "../shadowmap.hpp"
+#include "../shadow_atlas.hpp"
 
 namespace Renderer::Light::Phong {
 
@@ -26,12 +27,25 @@ public:
 
     void update(DirectionalInfo& info);
 
+    // Draws into the light's atlas tile, changes viewport need to fix after
     void shadowmap_draw(Renderer::ShaderProgram& shader, const std::function<void()>& draw_function);
 
     void set_uniforms(Renderer::ShaderProgram& shader, const char* light_name);
 
     bool has_shadowmap();
 
+    // The atlas owns the texture, the light only remembers which tile it was given and frees it
+    // when destroyed, so the atlas has to outlive the light
+    void set_shadow_tile(Renderer::ShadowAtlas& atlas, const Renderer::ShadowAtlas::Tile& tile);
+    [[nodiscard]] Renderer::ShadowAtlas::Tile& get_shadow_tile();
+
+    // Cached shadows are only redrawn when the light changed or something moved inside its volume
+    void mark_shadow_dirty();
+    [[nodiscard]] bool is_shadow_dirty() const;
+    [[nodiscard]] bool is_in_shadow_volume(const AABB& bounds) const;
+
+    [[nodiscard]] const DirectionalInfo& get_info() const;
+
 private:
     bool initialized = false;
 
@@ -39,7 +53,10 @@ private:
 
     struct ShadowMap_Internal {
         glm::mat4 m_light_space_matrix {};
-        Renderer::ShadowMap m_shadowmap;
+        Frustum m_frustum;
+        Renderer::ShadowAtlas* m_atlas = nullptr;
+        Renderer::ShadowAtlas::Tile m_tile;
+        bool m_dirty = true;
     };
     ShadowMap_Internal* m_shadowmap_internal = nullptr;
 };
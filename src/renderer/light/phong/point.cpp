@@ -45,6 +45,7 @@ void Point::update(PointInfo& info)
         m_shadowmap_internal->m_light_space_matrix.at(3) = light_projection * glm::lookAt(info.position, info.position + glm::vec3(0.0, -1.0, 0.0), glm::vec3(0.0, 0.0, -1.0));
         m_shadowmap_internal->m_light_space_matrix.at(4) = light_projection * glm::lookAt(info.position, info.position + glm::vec3(0.0, 0.0, 1.0), glm::vec3(0.0, -1.0, 0.0));
         m_shadowmap_internal->m_light_space_matrix.at(5) = light_projection * glm::lookAt(info.position, info.position + glm::vec3(0.0, 0.0, -1.0), glm::vec3(0.0, -1.0, 0.0));
+        m_shadowmap_internal->m_dirty = true;
     }
 
     m_info = info;
@@ -71,6 +72,88 @@ void Point::shadowmap_draw(Renderer::ShaderProgram& shader, const std::function<
     draw_function();
 
     m_shadowmap_internal->m_shadowmap.unbind();
+    m_shadowmap_internal->m_dirty = false;
+}
+
+void Point::shadowmap_draw_layered(Renderer::ShaderProgram& shader, std::span<const AABB> casters, const std::function<void(u32 face_count)>& draw_function)
+{
+    util_assert(initialized == true, "Light::Point has not been initialized");
+    util_assert(m_info.shadowmap == true, "Trying to call shadowmap_draw_layered on a point light without a shadowmap enabled");
+
+    glViewport(0, 0, m_shadowmap_internal->m_shadowmap.get_width(), m_shadowmap_internal->m_shadowmap.get_height());
+    m_shadowmap_internal->m_shadowmap.bind();
+
+    // Clears every face of the layered framebuffer, including the ones that get skipped
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    std::array<i32, 6> faces {};
+    u32 face_count = get_visible_faces(casters, faces);
+    if (face_count > 0) {
+        shader.bind();
+        for (usize i = 0; i < m_shadowmap_internal->m_light_space_matrix.size(); i++) {
+            shader.set_mat4(std::format("light_space_matrices[{}]", i).c_str(), m_shadowmap_internal->m_light_space_matrix[i]);
+        }
+        for (u32 i = 0; i < face_count; i++) {
+            shader.set_int(std::format("faces[{}]", i).c_str(), faces[i]);
+        }
+        shader.set_int("face_count", static_cast<i32>(face_count));
+        shader.set_float("far_plane", m_info.far);
+        shader.set_vec3("light_pos", m_info.position);
+        draw_function(face_count);
+    }
+
+    m_shadowmap_internal->m_shadowmap.unbind();
+    m_shadowmap_internal->m_dirty = false;
+}
+
+u32 Point::get_visible_faces(std::span<const AABB> casters, std::array<i32, 6>& faces) const
+{
+    // Same face order as m_light_space_matrix (+x, -x, +y, -y, +z, -z)
+    static constexpr std::array<glm::vec3, 6> face_directions = {
+        glm::vec3(1.0F, 0.0F, 0.0F),
+        glm::vec3(-1.0F, 0.0F, 0.0F),
+        glm::vec3(0.0F, 1.0F, 0.0F),
+        glm::vec3(0.0F, -1.0F, 0.0F),
+        glm::vec3(0.0F, 0.0F, 1.0F),
+        glm::vec3(0.0F, 0.0F, -1.0F),
+    };
+
+    u32 face_count = 0;
+    for (usize face = 0; face < face_directions.size(); face++) {
+        const glm::vec3 direction = face_directions[face];
+        const usize axis = face / 2;
+        const glm::vec3 side_a = face_directions[((axis + 1) % 3) * 2];
+        const glm::vec3 side_b = face_directions[((axis + 2) % 3) * 2];
+
+        // The 4 side planes of the 90 degree face frustum all go through the light
+        const std::array<Plane, 4> planes = {
+            Plane(m_info.position, direction + side_a),
+            Plane(m_info.position, direction - side_a),
+            Plane(m_info.position, direction + side_b),
+            Plane(m_info.position, direction - side_b),
+        };
+
+        for (const auto& caster : casters) {
+            if (caster.get_distance_to_point(m_info.position) > m_info.far) {
+                continue;
+            }
+
+            bool inside = true;
+            for (const auto& plane : planes) {
+                if (!caster.is_on_or_forward_plane(plane)) {
+                    inside = false;
+                    break;
+                }
+            }
+
+            if (inside) {
+                faces.at(face_count++) = static_cast<i32>(face);
+                break;
+            }
+        }
+    }
+
+    return face_count;
 }
 
 void Point::set_uniforms(Renderer::ShaderProgram& shader, const char* light_name)
@@ -99,4 +182,50 @@ bool Point::has_shadowmap()
     return m_info.shadowmap;
 }
 
+void Point::set_shadow_resolution(i32 resolution)
+{
+    util_assert(initialized == true, "Point has not been initialized");
+    util_assert(m_info.shadowmap == true, "Trying to set the shadow resolution of a point light without a shadowmap enabled");
+
+    if (resolution == m_shadowmap_internal->m_shadowmap.get_width()) {
+        return;
+    }
+
+    m_shadowmap_internal->m_shadowmap.reinit_cubemap(resolution, resolution);
+    update(m_info);
+}
+
+[[nodiscard]] i32 Point::get_shadow_resolution() const
+{
+    util_assert(initialized == true, "Point has not been initialized");
+    util_assert(m_info.shadowmap == true, "Trying to get the shadow resolution of a point light without a shadowmap enabled");
+    return m_shadowmap_internal->m_shadowmap.get_width();
+}
+
+void Point::mark_shadow_dirty()
+{
+    util_assert(initialized == true, "Point has not been initialized");
+    if (m_info.shadowmap) {
+        m_shadowmap_internal->m_dirty = true;
+    }
+}
+
+[[nodiscard]] bool Point::is_shadow_dirty() const
+{
+    util_assert(initialized == true, "Point has not been initialized");
+    return m_info.shadowmap && m_shadowmap_internal->m_dirty;
+}
+
+[[nodiscard]] bool Point::is_in_shadow_volume(const AABB& bounds) const
+{
+    util_assert(initialized == true, "Point has not been initialized");
+    return m_info.shadowmap && bounds.get_distance_to_point(m_info.position) <= m_info.far;
+}
+
+[[nodiscard]] const PointInfo& Point::get_info() const
+{
+    util_assert(initialized == true, "Point has not been initialized");
+    return m_info;
+}
+
 } // namespace Renderer::Light::Phong
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../frustum_culling.hpp"
 #include "../shader.hpp"
 #include "../shadowmap.hpp"
 
@@ -33,18 +34,35 @@ public:
 
     // Changes viewport need to fix after
     void shadowmap_draw(Renderer::ShaderProgram& shader, const std::function<void()>& draw_function);
+    // Single pass version of shadowmap_draw, draw_function has to draw every instance
+    // face_count times. Faces that do not contain any of the casters are skipped
+    void shadowmap_draw_layered(Renderer::ShaderProgram& shader, std::span<const AABB> casters, const std::function<void(u32 face_count)>& draw_function);
 
     void set_uniforms(Renderer::ShaderProgram& shader, const char* light_name);
 
     bool has_shadowmap();
 
+    // Reallocates the cubemap when the resolution changes
+    void set_shadow_resolution(i32 resolution);
+    [[nodiscard]] i32 get_shadow_resolution() const;
+
+    // Cached shadows are only redrawn when the light changed or something moved inside its range
+    void mark_shadow_dirty();
+    [[nodiscard]] bool is_shadow_dirty() const;
+    [[nodiscard]] bool is_in_shadow_volume(const AABB& bounds) const;
+
+    [[nodiscard]] const PointInfo& get_info() const;
+
 private:
+    [[nodiscard]] u32 get_visible_faces(std::span<const AABB> casters, std::array<i32, 6>& faces) const;
+
     bool initialized = false;
 
     PointInfo m_info {};
     struct ShadowMap_Internal {
         std::array<glm::mat4, 6> m_light_space_matrix {};
         Renderer::ShadowMap m_shadowmap;
+        bool m_dirty = true;
     };
     ShadowMap_Internal* m_shadowmap_internal = nullptr;
 };
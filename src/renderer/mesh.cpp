@@ -1,9 +1,29 @@
 #include "mesh.hpp"
 
+#include "counters.hpp"
+#include "gl_state.hpp"
 #include "model.hpp"
 
 namespace Renderer {
 
+namespace {
+    // Culled draws are counted with everything they could have drawn
+    void count_multi_draw(std::span<const IndirectCommands> commands, u64 instance_count)
+    {
+        Counters::add(Counters::Counter::DrawCalls);
+        Counters::add(Counters::Counter::MultiDrawCommands, commands.size());
+        for (const auto& command : commands) {
+            Counters::add_draw(command.count, instance_count);
+        }
+    }
+
+    void count_draw(const IndirectCommands& command, u64 instance_count)
+    {
+        Counters::add(Counters::Counter::DrawCalls);
+        Counters::add_draw(command.count, instance_count);
+    }
+} // anonymous namespace
+
 Mesh::~Mesh()
 {
     initialized = false;
@@ -32,7 +52,7 @@ void Mesh::update_model_ssbos(const std::span<glm::mat4> model_matrices)
         }
     }
 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_model_ssbo.get_id());
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 1, m_model_ssbo.get_id());
 }
 
 void Mesh::draw()
@@ -50,8 +70,7 @@ void Mesh::draw()
             nullptr,
             m_commands.size(),
             0);
-
-        m_cmd_buff.unbind_buffer(GL_DRAW_INDIRECT_BUFFER);
+        count_multi_draw(m_commands, m_instance_count);
     } else {
         for (usize i = 0; i < m_commands.size(); i++) {
             glDrawElementsInstancedBaseVertexBaseInstance(
@@ -62,36 +81,46 @@ void Mesh::draw()
                 m_commands[i].instance_count,
                 m_commands[i].base_vertex,
                 m_commands[i].base_instance);
+            count_draw(m_commands[i], m_commands[i].instance_count);
         }
     }
 }
 
 void Mesh::draw(ShaderProgram& shader)
+{
+    util_assert(initialized == true, "Mesh has not been initialized");
+    draw_commands(shader, 0, m_commands.size());
+}
+
+void Mesh::draw(ShaderProgram& shader, AlphaMode alpha_mode)
 {
     util_assert(initialized == true, "Mesh has not been initialized");
 
+    const CommandRange& range = m_alpha_mode_ranges.at(static_cast<usize>(alpha_mode));
+    if (range.count > 0) {
+        draw_commands(shader, range.first, range.count);
+    }
+}
+
+void Mesh::draw_commands(ShaderProgram& shader, usize first, usize count)
+{
     m_vao.bind();
 
     if (Renderer::Extensions::is_extension_supported("GL_ARB_bindless_texture")) {
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_diff_ssbo.get_id());
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_metallic_roughness_ssbo.get_id());
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_normals_ssbo.get_id());
-        shader.set_int("diffuse_max_textures", m_diffuse_bindless_ids.size());
-        shader.set_int("metallic_roughness_max_textures", m_metallic_roughness_bindless_ids.size());
-        shader.set_int("normals_max_textures", m_normal_bindless_ids.size());
+        bind_bindless_textures(shader);
 
         m_cmd_buff.bind_buffer(GL_DRAW_INDIRECT_BUFFER);
 
+        // gl_DrawID restarts at 0 for every call, the shaders index the textures with gl_BaseInstance instead
         glMultiDrawElementsIndirect(
             GL_TRIANGLES,
             GL_UNSIGNED_INT,
-            nullptr,
-            m_commands.size(),
+            (void*)(first * sizeof(IndirectCommands)),
+            count,
             0);
-
-        m_cmd_buff.unbind_buffer(GL_DRAW_INDIRECT_BUFFER);
+        count_multi_draw(std::span(m_commands).subspan(first, count), m_instance_count);
     } else {
-        for (usize i = 0; i < m_commands.size(); i++) {
+        for (usize i = first; i < first + count; i++) {
             // 1 diffuse 1 metallic_roughness 1 normal 1 specular (at most.. or its broken)
             GLuint texture_unit = Texture::get_texture_unit();
             m_diffuse_textures[i]->bind(texture_unit);
@@ -113,12 +142,203 @@ void Mesh::draw(ShaderProgram& shader)
                 m_commands[i].instance_count,
                 m_commands[i].base_vertex,
                 m_commands[i].base_instance);
+            count_draw(m_commands[i], m_commands[i].instance_count);
 
             Texture::reset_texture_units();
         }
     }
 }
 
+void Mesh::bind_bindless_textures(ShaderProgram& shader)
+{
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 2, m_diff_ssbo.get_id());
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 3, m_metallic_roughness_ssbo.get_id());
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 4, m_normals_ssbo.get_id());
+    shader.set_int("diffuse_max_textures", m_diffuse_bindless_ids.size());
+    shader.set_int("metallic_roughness_max_textures", m_metallic_roughness_bindless_ids.size());
+    shader.set_int("normals_max_textures", m_normal_bindless_ids.size());
+}
+
+void Mesh::cull(GpuCulling& culling, u32 phase)
+{
+    util_assert(initialized == true, "Mesh has not been initialized");
+    util_assert(GpuCulling::is_supported(), "Mesh::cull() requires the indirect draw path");
+
+    const auto command_count = static_cast<GLuint>(m_commands.size());
+
+    if (m_instance_count > m_culling_instance_capacity) {
+        m_culling_instance_capacity = m_instance_count;
+
+        const usize slots = static_cast<usize>(command_count) * m_culling_instance_capacity;
+        m_instance_remap_ssbo.buffer_data(GpuCulling::PHASE_COUNT * slots * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+        m_visibility_ssbo.buffer_data(slots * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+        glClearNamedBufferData(m_visibility_ssbo.get_id(), GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    }
+
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 1, m_model_ssbo.get_id());
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, GpuCulling::COMMANDS_BINDING, m_cmd_buff.get_id());
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, GpuCulling::CULLED_COMMANDS_BINDING, m_culled_cmd_buff.get_id());
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, GpuCulling::BOUNDS_BINDING, m_bounds_ssbo.get_id());
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, GpuCulling::INSTANCE_REMAP_BINDING, m_instance_remap_ssbo.get_id());
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, GpuCulling::VISIBILITY_BINDING, m_visibility_ssbo.get_id());
+
+    ShaderProgram& reset_shader = culling.get_reset_shader();
+    reset_shader.bind();
+    reset_shader.set_int("command_count", static_cast<int>(command_count));
+    reset_shader.set_int("instance_count", static_cast<int>(m_instance_count));
+    reset_shader.set_int("phase", static_cast<int>(phase));
+    glDispatchCompute(GpuCulling::get_group_count(command_count), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    ShaderProgram& cull_shader = culling.get_cull_shader();
+    cull_shader.bind();
+    cull_shader.set_int("command_count", static_cast<int>(command_count));
+    cull_shader.set_int("instance_count", static_cast<int>(m_instance_count));
+    glDispatchCompute(GpuCulling::get_group_count(static_cast<usize>(command_count) * m_instance_count), 1, 1);
+}
+
+void Mesh::draw_culled(ShaderProgram& shader, AlphaMode alpha_mode, u32 phase)
+{
+    util_assert(initialized == true, "Mesh has not been initialized");
+    util_assert(GpuCulling::is_supported(), "Mesh::draw_culled() requires the indirect draw path");
+
+    const CommandRange& range = m_alpha_mode_ranges.at(static_cast<usize>(alpha_mode));
+    if (range.count == 0) {
+        return;
+    }
+
+    m_vao.bind();
+
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 1, m_model_ssbo.get_id());
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, GpuCulling::INSTANCE_REMAP_BINDING, m_instance_remap_ssbo.get_id());
+    bind_bindless_textures(shader);
+    shader.set_int("instance_stride", static_cast<int>(m_instance_count));
+    shader.set_int("command_count", static_cast<int>(m_commands.size()));
+
+    m_culled_cmd_buff.bind_buffer(GL_DRAW_INDIRECT_BUFFER);
+
+    glMultiDrawElementsIndirect(
+        GL_TRIANGLES,
+        GL_UNSIGNED_INT,
+        (void*)((phase * m_commands.size() + range.first) * sizeof(IndirectCommands)),
+        range.count,
+        0);
+    count_multi_draw(std::span(m_commands).subspan(range.first, range.count), m_instance_count);
+}
+
+void Mesh::draw_visibility(ShaderProgram& shader, AlphaMode alpha_mode, u32 draw_offset)
+{
+    util_assert(initialized == true, "Mesh has not been initialized");
+    util_assert(VisibilityBuffer::is_supported(), "Mesh::draw_visibility() requires the indirect draw path");
+    util_assert(draw_offset + get_command_count() * m_instance_count <= VisibilityBuffer::MAX_DRAWS,
+        std::format("Mesh::draw_visibility() draw ids past {} do not fit the visibility buffer", VisibilityBuffer::MAX_DRAWS));
+    // Triangle ids are masked to TRIANGLE_ID_BITS, a larger sub-mesh would shade the wrong triangles
+    for (const auto& command : m_commands) {
+        util_assert(command.count / 3 <= VisibilityBuffer::MAX_TRIANGLES,
+            std::format("Mesh::draw_visibility() sub-meshes past {} triangles do not fit the visibility buffer", VisibilityBuffer::MAX_TRIANGLES));
+    }
+
+    shader.set_int("draw_offset", static_cast<int>(draw_offset));
+    shader.set_int("command_count", static_cast<int>(m_commands.size()));
+    draw(shader, alpha_mode);
+}
+
+void Mesh::bind_visibility_resources(ShaderProgram& shader, u32 draw_offset)
+{
+    util_assert(initialized == true, "Mesh has not been initialized");
+    util_assert(VisibilityBuffer::is_supported(), "Mesh::bind_visibility_resources() requires the indirect draw path");
+
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 1, m_model_ssbo.get_id());
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, VisibilityBuffer::VERTICES_BINDING, m_vbo.get_id());
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, VisibilityBuffer::INDICES_BINDING, m_ebo.get_id());
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, VisibilityBuffer::COMMANDS_BINDING, m_cmd_buff.get_id());
+    bind_bindless_textures(shader);
+
+    shader.set_int("draw_offset", static_cast<int>(draw_offset));
+    shader.set_int("draw_count", static_cast<int>(get_command_count() * m_instance_count));
+    shader.set_int("command_count", static_cast<int>(m_commands.size()));
+}
+
+[[nodiscard]] u32 Mesh::get_command_count() const
+{
+    util_assert(initialized == true, "Mesh has not been initialized");
+    return static_cast<u32>(m_commands.size());
+}
+
+void Mesh::setup_culling_buffers()
+{
+    std::vector<glm::vec4> bounds;
+    bounds.reserve(m_command_bounds.size() * 2);
+    for (const auto& command_bounds : m_command_bounds) {
+        bounds.emplace_back(command_bounds.center, 0.0F);
+        bounds.emplace_back(command_bounds.extents, 0.0F);
+    }
+    m_bounds_ssbo.init();
+    m_bounds_ssbo.buffer_storage(bounds.size() * sizeof(bounds[0]), bounds.data(), 0);
+
+    m_culled_cmd_buff.init();
+    m_culled_cmd_buff.buffer_storage(GpuCulling::PHASE_COUNT * m_commands.size() * sizeof(IndirectCommands), nullptr, 0);
+
+    // Sized on the first cull once the instance count is known
+    m_instance_remap_ssbo.init();
+    m_visibility_ssbo.init();
+}
+
+[[nodiscard]] bool Mesh::has_alpha_mode(AlphaMode alpha_mode) const
+{
+    util_assert(initialized == true, "Mesh has not been initialized");
+    return m_alpha_mode_ranges.at(static_cast<usize>(alpha_mode)).count > 0;
+}
+
+void Mesh::draw_layered(GLuint layer_count)
+{
+    util_assert(initialized == true, "Mesh has not been initialized");
+
+    m_vao.bind();
+
+    const GLuint layered_instance_count = m_instance_count * layer_count;
+
+    if (Renderer::Extensions::is_extension_supported("GL_ARB_bindless_texture")) {
+        if (!m_layered_cmd_buff.is_initialized()) {
+            m_layered_cmd_buff.init();
+            m_layered_cmd_buff.buffer_storage(m_commands.size() * sizeof(IndirectCommands), m_commands.data(), GL_DYNAMIC_STORAGE_BIT);
+            m_layered_instance_count = m_instance_count;
+        }
+
+        if (m_layered_instance_count != layered_instance_count) {
+            m_layered_instance_count = layered_instance_count;
+
+            std::vector<IndirectCommands> commands = m_commands;
+            for (auto& command : commands) {
+                command.instance_count = layered_instance_count;
+            }
+            m_layered_cmd_buff.buffer_sub_data(0, commands.size() * sizeof(commands[0]), commands.data());
+        }
+
+        m_layered_cmd_buff.bind_buffer(GL_DRAW_INDIRECT_BUFFER);
+
+        glMultiDrawElementsIndirect(
+            GL_TRIANGLES,
+            GL_UNSIGNED_INT,
+            nullptr,
+            m_commands.size(),
+            0);
+        count_multi_draw(m_commands, layered_instance_count);
+    } else {
+        for (usize i = 0; i < m_commands.size(); i++) {
+            glDrawElementsInstancedBaseVertexBaseInstance(
+                GL_TRIANGLES,
+                m_commands[i].count,
+                GL_UNSIGNED_INT,
+                (void*)(m_commands[i].first_index * sizeof(GLuint)),
+                layered_instance_count,
+                m_commands[i].base_vertex,
+                m_commands[i].base_instance);
+            count_draw(m_commands[i], layered_instance_count);
+        }
+    }
+}
+
 void Mesh::setup_mesh()
 {
     util_assert(initialized == false, "Mesh::setup_mesh() has already been initialized");
@@ -150,6 +370,8 @@ void Mesh::setup_mesh()
         m_commands[i].base_vertex = m_base_vertices.at(i).m_base;
     }
 
+    sort_commands_by_alpha_mode();
+
     if (Renderer::Extensions::is_extension_supported("GL_ARB_bindless_texture")) {
         m_cmd_buff.init();
         m_cmd_buff.buffer_storage(m_commands.size() * sizeof(IndirectCommands), m_commands.data(), GL_DYNAMIC_STORAGE_BIT);
@@ -185,9 +407,53 @@ void Mesh::setup_mesh()
         if (m_normal_bindless_ids.size() > 0) {
             m_normals_ssbo.buffer_storage(m_normal_bindless_ids.size() * sizeof(GLuint64), m_normal_bindless_ids.data(), GL_DYNAMIC_STORAGE_BIT);
         }
+
+        setup_culling_buffers();
     }
 
     initialized = true;
 }
 
+void Mesh::sort_commands_by_alpha_mode()
+{
+    m_alpha_modes.resize(m_commands.size(), AlphaMode::Opaque);
+    m_command_bounds.resize(m_commands.size(), m_bounds);
+
+    std::vector<usize> order(m_commands.size());
+    for (usize i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::ranges::stable_sort(order, {}, [&](usize i) { return m_alpha_modes[i]; });
+
+    // The textures are indexed per command so they have to follow the new order,
+    // m_base_vertices keeps the load order since nothing indexes it afterwards
+    const auto apply_order = [&](auto& values) {
+        auto sorted = values;
+        for (usize i = 0; i < order.size(); i++) {
+            sorted[i] = values[order[i]];
+        }
+        values = std::move(sorted);
+    };
+    apply_order(m_commands);
+    apply_order(m_alpha_modes);
+    apply_order(m_command_bounds);
+    if (m_diffuse_textures.size() == order.size()) {
+        apply_order(m_diffuse_textures);
+        apply_order(m_metallic_roughness_textures);
+        apply_order(m_normal_textures);
+    }
+
+    m_alpha_mode_ranges = {};
+    for (usize i = 0; i < m_commands.size(); i++) {
+        // The shaders read the command index from gl_BaseInstance
+        m_commands[i].base_instance = i;
+
+        CommandRange& range = m_alpha_mode_ranges.at(static_cast<usize>(m_alpha_modes[i]));
+        if (range.count == 0) {
+            range.first = i;
+        }
+        range.count++;
+    }
+}
+
 } // namespace Renderer
@@ -3,9 +3,12 @@
 #include "assimp/material.h"
 #include "buffer.hpp"
 #include "extensions.hpp"
+#include "frustum_culling.hpp"
+#include "gpu_culling.hpp"
 #include "shader.hpp"
 #include "texture.hpp"
 #include "vertex.hpp"
+#include "visibility_buffer.hpp"
 
 namespace Renderer {
 
@@ -14,6 +17,13 @@ struct TextureRef {
     aiTextureType m_type = aiTextureType_DIFFUSE;
 };
 
+// How a sub-mesh's material uses alpha, commands are grouped in this order
+enum class AlphaMode : u8 {
+    Opaque = 0,
+    Mask,
+    Blend,
+};
+
 struct IndirectCommands {
     GLuint count;
     GLuint instance_count;
@@ -52,6 +62,21 @@ public:
 
     void draw();
     void draw(ShaderProgram& shader);
+    // Only draws the sub-meshes using alpha_mode
+    void draw(ShaderProgram& shader, AlphaMode alpha_mode);
+    // Draws every instance layer_count times, used for single pass layered rendering
+    void draw_layered(GLuint layer_count);
+
+    // Writes the commands and instances that survive culling for phase, needs update_model_ssbos first
+    void cull(GpuCulling& culling, u32 phase);
+    // Draws what cull() kept for phase, the vertex shader needs GpuCulling defined
+    void draw_culled(ShaderProgram& shader, AlphaMode alpha_mode, u32 phase);
+
+    // Writes (draw_offset + instance * command count + command, triangle) ids, needs update_model_ssbos first
+    void draw_visibility(ShaderProgram& shader, AlphaMode alpha_mode, u32 draw_offset);
+    // Binds the vertices, indices and commands for the material pass of the ids written above
+    void bind_visibility_resources(ShaderProgram& shader, u32 draw_offset);
+    [[nodiscard]] u32 get_command_count() const;
 
     std::vector<Vertex> m_vertices;
     std::vector<u32> m_indices;
@@ -61,9 +86,21 @@ public:
     std::vector<Texture*> m_normal_textures;
 
     std::vector<BaseVertex> m_base_vertices;
+    // One per sub-mesh like the textures
+    std::vector<AlphaMode> m_alpha_modes;
+    // Local bounds of every sub-mesh, m_bounds covers all of them
+    std::vector<AABB> m_command_bounds;
+
+    AABB m_bounds;
+
+    [[nodiscard]] bool has_alpha_mode(AlphaMode alpha_mode) const;
 
 private:
     void setup_mesh();
+    void sort_commands_by_alpha_mode();
+    void draw_commands(ShaderProgram& shader, usize first, usize count);
+    void bind_bindless_textures(ShaderProgram& shader);
+    void setup_culling_buffers();
 
     bool initialized = false;
 
@@ -81,7 +118,23 @@ private:
     Buffer m_metallic_roughness_ssbo;
     Buffer m_normals_ssbo;
 
+    Buffer m_layered_cmd_buff;
+    GLuint m_layered_instance_count = 0;
+
+    // Gpu culling, the culled commands and remap hold one run per phase
+    Buffer m_bounds_ssbo;
+    Buffer m_culled_cmd_buff;
+    Buffer m_instance_remap_ssbo;
+    Buffer m_visibility_ssbo;
+    GLuint m_culling_instance_capacity = 0;
+
     std::vector<IndirectCommands> m_commands;
+
+    struct CommandRange {
+        usize first = 0;
+        usize count = 0;
+    };
+    std::array<CommandRange, 3> m_alpha_mode_ranges {};
     std::vector<GLuint64> m_diffuse_bindless_ids;
     std::vector<GLuint64> m_metallic_roughness_bindless_ids;
     std::vector<GLuint64> m_normal_bindless_ids;
@@ -1,5 +1,7 @@
 #include "model.hpp"
 
+#include "../utils/job_system.hpp"
+
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
@@ -14,6 +16,7 @@ Model::Model(const char* file_path)
 
 void Model::init(const char* file_path)
 {
+    PROFILE_SCOPE("Model::init");
     util_assert(initialized == false, "Model::init() has already been initialized");
 
     m_directory = file_path;
@@ -25,13 +28,33 @@ void Model::init(const char* file_path)
     m_directory = m_directory.substr(0, m_directory.find_last_of('/'));
 
     util_assert(scene->mRootNode != nullptr, "Model::Model: Root node is nullptr");
+    decode_textures(scene);
     process_node(scene->mRootNode, scene);
+    m_images.clear();
 
     usize offset = 0;
     for (usize i = 0; i < m_mesh.m_base_vertices.size(); i++) {
         m_mesh.m_base_vertices.at(i).m_offset = offset;
         offset += m_mesh.m_base_vertices.at(i).m_count;
     }
+
+    glm::vec3 bounds_min(std::numeric_limits<float>::max());
+    glm::vec3 bounds_max(std::numeric_limits<float>::lowest());
+    for (const auto& base_vertex : m_mesh.m_base_vertices) {
+        glm::vec3 command_min(std::numeric_limits<float>::max());
+        glm::vec3 command_max(std::numeric_limits<float>::lowest());
+        for (usize i = base_vertex.m_offset; i < base_vertex.m_offset + base_vertex.m_count; i++) {
+            const glm::vec3& position = m_mesh.m_vertices.at(base_vertex.m_base + m_mesh.m_indices[i]).m_pos;
+            command_min = glm::min(command_min, position);
+            command_max = glm::max(command_max, position);
+        }
+        m_mesh.m_command_bounds.emplace_back(command_min, command_max);
+
+        bounds_min = glm::min(bounds_min, command_min);
+        bounds_max = glm::max(bounds_max, command_max);
+    }
+    m_mesh.m_bounds.init(bounds_min, bounds_max);
+
     m_mesh.setup_mesh();
 
     initialized = true;
@@ -60,12 +83,83 @@ void Model::draw(ShaderProgram& shader, const std::span<glm::mat4> model)
     m_mesh.draw(shader);
 }
 
+void Model::draw(ShaderProgram& shader, const std::span<glm::mat4> model, AlphaMode alpha_mode)
+{
+    util_assert(initialized == true, "Model has not been initialized");
+
+    if (!m_mesh.has_alpha_mode(alpha_mode)) {
+        return;
+    }
+    m_mesh.update_model_ssbos(model);
+    m_mesh.draw(shader, alpha_mode);
+}
+
+void Model::cull(GpuCulling& culling, const std::span<glm::mat4> model, u32 phase)
+{
+    util_assert(initialized == true, "Model has not been initialized");
+
+    // Phase 0 is the first use of the matrices this frame, phase 1 reuses them
+    if (phase == 0) {
+        m_mesh.update_model_ssbos(model);
+    }
+    m_mesh.cull(culling, phase);
+}
+
+void Model::draw_culled(ShaderProgram& shader, AlphaMode alpha_mode, u32 phase)
+{
+    util_assert(initialized == true, "Model has not been initialized");
+    m_mesh.draw_culled(shader, alpha_mode, phase);
+}
+
+void Model::draw_visibility(ShaderProgram& shader, const std::span<glm::mat4> model, AlphaMode alpha_mode, u32 draw_offset)
+{
+    util_assert(initialized == true, "Model has not been initialized");
+
+    if (!m_mesh.has_alpha_mode(alpha_mode)) {
+        return;
+    }
+    m_mesh.update_model_ssbos(model);
+    m_mesh.draw_visibility(shader, alpha_mode, draw_offset);
+}
+
+void Model::bind_visibility_resources(ShaderProgram& shader, u32 draw_offset)
+{
+    util_assert(initialized == true, "Model has not been initialized");
+    m_mesh.bind_visibility_resources(shader, draw_offset);
+}
+
+[[nodiscard]] u32 Model::get_visibility_draw_count(usize instance_count) const
+{
+    util_assert(initialized == true, "Model has not been initialized");
+    return m_mesh.get_command_count() * static_cast<u32>(instance_count);
+}
+
+void Model::draw_untextured_layered(const std::span<glm::mat4> model, u32 layer_count)
+{
+    util_assert(initialized == true, "Model has not been initialized");
+
+    m_mesh.update_model_ssbos(model);
+    m_mesh.draw_layered(layer_count);
+}
+
 const Mesh* Model::get_mesh()
 {
     util_assert(initialized == true, "Model has not been initialized");
     return &m_mesh;
 }
 
+[[nodiscard]] const AABB& Model::get_bounds() const
+{
+    util_assert(initialized == true, "Model has not been initialized");
+    return m_mesh.m_bounds;
+}
+
+[[nodiscard]] bool Model::has_alpha_mode(AlphaMode alpha_mode) const
+{
+    util_assert(initialized == true, "Model has not been initialized");
+    return m_mesh.has_alpha_mode(alpha_mode);
+}
+
 void Model::process_node(aiNode* node, const aiScene* scene)
 {
     for (u32 i = 0; i < node->mNumMeshes; i++) {
@@ -142,6 +236,10 @@ void Model::process_mesh(aiMesh* mesh, const aiScene* scene)
 
         // Texture* ao_map = load_material_textures(material, aiTextureType_AMBIENT_OCCLUSION);
         // m_mesh.m_textures.push_back(ao_map);
+
+        m_mesh.m_alpha_modes.push_back(get_material_alpha_mode(material));
+    } else {
+        m_mesh.m_alpha_modes.push_back(AlphaMode::Opaque);
     }
 
     count = static_cast<GLsizei>(m_mesh.m_indices.size()) - count;
@@ -151,12 +249,45 @@ void Model::process_mesh(aiMesh* mesh, const aiScene* scene)
         base_vertex);
 }
 
+void Model::decode_textures(const aiScene* scene)
+{
+    PROFILE_SCOPE("Model::decode_textures");
+
+    std::vector<std::string> paths;
+    for (u32 i = 0; i < scene->mNumMaterials; i++) {
+        for (const aiTextureType type : { aiTextureType_DIFFUSE, aiTextureType_GLTF_METALLIC_ROUGHNESS, aiTextureType_NORMALS }) {
+            std::string path = get_texture_path(scene->mMaterials[i], type);
+            if (!path.empty() && std::ranges::find(paths, path) == paths.end()) {
+                paths.emplace_back(std::move(path));
+            }
+        }
+    }
+
+    // stb_image only touches the file and its own buffers, GL uploads stay on this thread
+    std::vector<Image> images(paths.size());
+    Utils::Jobs::get().parallel_for(static_cast<u32>(paths.size()), [&](u32 i) {
+        images[i] = Image::load(paths[i].c_str(), false);
+    }, Utils::JobSystem::Priority::Low);
+
+    for (usize i = 0; i < paths.size(); i++) {
+        m_images.emplace(std::move(paths[i]), std::move(images[i]));
+    }
+}
+
+[[nodiscard]] std::string Model::get_texture_path(aiMaterial* mat, aiTextureType type) const
+{
+    if (mat->GetTextureCount(type) == 0) {
+        return {};
+    }
+    aiString str;
+    mat->GetTexture(type, 0, &str);
+    return m_directory + "/" + str.C_Str();
+}
+
 Texture* Model::load_material_texture(aiMaterial* mat, aiTextureType type)
 {
     if (mat->GetTextureCount(type) > 0) {
-        aiString str;
-        mat->GetTexture(type, 0, &str);
-        std::string texture_path = (m_directory + "/" + str.C_Str());
+        std::string texture_path = get_texture_path(mat, type);
 
         TextureInfo texture_info;
         texture_info.from_file = GL_TRUE;
@@ -164,6 +295,10 @@ Texture* Model::load_material_texture(aiMaterial* mat, aiTextureType type)
         texture_info.mag_filter = GL_LINEAR;
         texture_info.file_path = texture_path.c_str();
         texture_info.flip = false;
+        const auto image = m_images.find(texture_path);
+        if (image != m_images.end()) {
+            texture_info.image = &image->second;
+        }
 
         LOG_INFO(std::format("Loading {} type {}", texture_path, aiTextureTypeToString(type)));
 
@@ -175,6 +310,32 @@ Texture* Model::load_material_texture(aiMaterial* mat, aiTextureType type)
     }
 }
 
+AlphaMode Model::get_material_alpha_mode(aiMaterial* mat)
+{
+    // glTF states it directly ("OPAQUE", "MASK" or "BLEND")
+    aiString gltf_alpha_mode;
+    if (mat->Get("$mat.gltf.alphaMode", 0, 0, gltf_alpha_mode) == aiReturn_SUCCESS) {
+        std::string_view alpha_mode = gltf_alpha_mode.C_Str();
+        if (alpha_mode == "MASK") {
+            return AlphaMode::Mask;
+        }
+        if (alpha_mode == "BLEND") {
+            return AlphaMode::Blend;
+        }
+        return AlphaMode::Opaque;
+    }
+
+    // Other formats only have an opacity factor or an opacity map (obj map_d)
+    float opacity = 1.0F;
+    if (mat->Get(AI_MATKEY_OPACITY, opacity) == aiReturn_SUCCESS && opacity < 1.0F) {
+        return AlphaMode::Blend;
+    }
+    if (mat->GetTextureCount(aiTextureType_OPACITY) > 0) {
+        return AlphaMode::Mask;
+    }
+    return AlphaMode::Opaque;
+}
+
 namespace {
     Texture* placeholder_texture_albedo = nullptr;
     Texture* placeholder_texture_metallic = nullptr;
@@ -20,8 +20,20 @@ public:
 
     void draw_untextured(ShaderProgram& shader, const std::span<glm::mat4> model);
     void draw(ShaderProgram& shader, const std::span<glm::mat4> model);
+    void draw(ShaderProgram& shader, const std::span<glm::mat4> model, AlphaMode alpha_mode);
+    void draw_untextured_layered(const std::span<glm::mat4> model, u32 layer_count);
+
+    void cull(GpuCulling& culling, const std::span<glm::mat4> model, u32 phase);
+    void draw_culled(ShaderProgram& shader, AlphaMode alpha_mode, u32 phase);
+
+    void draw_visibility(ShaderProgram& shader, const std::span<glm::mat4> model, AlphaMode alpha_mode, u32 draw_offset);
+    void bind_visibility_resources(ShaderProgram& shader, u32 draw_offset);
+    // Number of draw ids instance_count instances take in the visibility buffer
+    [[nodiscard]] u32 get_visibility_draw_count(usize instance_count) const;
 
     const Mesh* get_mesh();
+    [[nodiscard]] const AABB& get_bounds() const;
+    [[nodiscard]] bool has_alpha_mode(AlphaMode alpha_mode) const;
 
     // Doesn't need to be called it will lazy load (or do before model loading if it is multi-threaded)
     static void init_placeholder_textures();
@@ -34,10 +46,15 @@ private:
     Utils::Cache<std::string, Texture> m_texture_cache;
     Mesh m_mesh;
     std::string m_directory;
+    // Decoded up front on the job system, only alive while init() runs
+    std::unordered_map<std::string, Image> m_images;
 
+    void decode_textures(const aiScene* scene);
     void process_node(aiNode* node, const aiScene* scene);
     void process_mesh(aiMesh* mesh, const aiScene* scene);
+    [[nodiscard]] std::string get_texture_path(aiMaterial* mat, aiTextureType type) const;
     Texture* load_material_texture(aiMaterial* mat, aiTextureType type);
+    static AlphaMode get_material_alpha_mode(aiMaterial* mat);
 
     static Texture* get_placeholder_texture_albedo();
     static Texture* get_placeholder_texture_normal();
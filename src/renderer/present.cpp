@@ -0,0 +1,44 @@
+#include "present.hpp"
+
+#include "gl_state.hpp"
+
+namespace Renderer {
+
+Presenter::~Presenter()
+{
+    initialized = false;
+}
+
+void Presenter::init()
+{
+    util_assert(initialized == false, "Presenter::init() has already been initialized");
+
+    auto present_shader_info = get_present_shader_info();
+    m_present_shader.init(present_shader_info.data(), present_shader_info.size());
+    m_quad.init();
+
+    initialized = true;
+}
+
+void Presenter::present(Texture& color, i32 width, i32 height)
+{
+    util_assert(initialized == true, "Presenter has not been initialized");
+
+    GlState::disable(GL_DEPTH_TEST);
+    glViewport(0, 0, width, height);
+
+    m_present_shader.bind();
+    GLuint texture_unit = Texture::get_texture_unit();
+    color.bind(texture_unit);
+    m_present_shader.set_int("color", static_cast<int>(texture_unit));
+    m_quad.draw();
+
+    GlState::enable(GL_DEPTH_TEST);
+}
+
+[[nodiscard]] bool Presenter::is_initialized() const
+{
+    return initialized;
+}
+
+} // namespace Renderer
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "quad.hpp"
+#include "shader.hpp"
+#include "texture.hpp"
+
+namespace Renderer {
+
+// Draws a single sampled texture to the default framebuffer. The default framebuffer is
+// multisampled so it cannot be blitted into, present() draws a quad instead
+class Presenter : public NoCopyNoMove {
+public:
+    Presenter() = default;
+    ~Presenter();
+
+    void init();
+
+    void present(Texture& color, i32 width, i32 height);
+
+    [[nodiscard]] bool is_initialized() const;
+
+private:
+    static consteval std::array<Renderer::ShaderInfo, 2> get_present_shader_info()
+    {
+        return std::array<Renderer::ShaderInfo, 2> {
+            Renderer::ShaderInfo {
+                .is_file = false,
+                .shader = get_present_vertex_shader(),
+                .type = GL_VERTEX_SHADER,
+            },
+            Renderer::ShaderInfo {
+                .is_file = false,
+                .shader = get_present_frag_shader(),
+                .type = GL_FRAGMENT_SHADER,
+            },
+        };
+    }
+
+    static consteval const char* get_present_vertex_shader()
+    {
+        return R"(
+            #version 460 core
+            layout (location = 0) in vec3 inPos;
+            layout (location = 1) in vec2 inTexCoords;
+
+            out vec2 TexCoords;
+
+            void main()
+            {
+                TexCoords = inTexCoords;
+                gl_Position = vec4(inPos, 1.0);
+            }
+        )";
+    }
+
+    static consteval const char* get_present_frag_shader()
+    {
+        return R"(
+            #version 460 core
+            out vec4 FragColor;
+
+            in vec2 TexCoords;
+
+            uniform sampler2D color;
+
+            void main()
+            {
+                FragColor = texture(color, TexCoords);
+            }
+        )";
+    }
+
+    bool initialized = false;
+
+    Renderer::ShaderProgram m_present_shader;
+    Renderer::Quad m_quad;
+};
+
+} // namespace Renderer
@@ -1,5 +1,7 @@
 #include "quad.hpp"
 
+#include "counters.hpp"
+
 namespace Renderer {
 
 Quad::~Quad()
@@ -35,6 +37,9 @@ void Quad::draw()
     util_assert(initialized == true, "Quad has not been initialized");
     m_vao.bind();
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    Counters::add(Counters::Counter::DrawCalls);
+    // Two triangles
+    Counters::add_draw(6, 1);
 }
 
 } // namespace Renderer
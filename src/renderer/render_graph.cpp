@@ -0,0 +1,591 @@
+#include "render_graph.hpp"
+
+#include "gpu_profiler.hpp"
+
+namespace Renderer {
+
+RenderGraph::Builder::Builder(RenderGraph& graph, u32 pass)
+    : m_graph(graph)
+    , m_pass(pass)
+{
+}
+
+void RenderGraph::Builder::read(Resource resource, Access access)
+{
+    util_assert(resource < m_graph.m_resources.size(), std::format("RenderGraph pass \"{}\" reads an invalid resource", m_graph.m_passes[m_pass].name));
+    m_graph.m_passes[m_pass].reads.emplace_back(resource, access);
+    m_graph.m_resources[resource].readers++;
+}
+
+void RenderGraph::Builder::write(Resource resource, Access access)
+{
+    util_assert(resource < m_graph.m_resources.size(), std::format("RenderGraph pass \"{}\" writes an invalid resource", m_graph.m_passes[m_pass].name));
+    m_graph.m_passes[m_pass].writes.emplace_back(resource, access);
+    if (m_graph.m_resources[resource].is_imported) {
+        side_effect();
+    }
+}
+
+void RenderGraph::Builder::side_effect()
+{
+    m_graph.m_passes[m_pass].side_effect = true;
+}
+
+RenderGraph::~RenderGraph()
+{
+    initialized = false;
+}
+
+void RenderGraph::init()
+{
+    util_assert(initialized == false, "RenderGraph::init() has already been initialized");
+    initialized = true;
+}
+
+void RenderGraph::begin_frame()
+{
+    util_assert(initialized == true, "RenderGraph has not been initialized");
+
+    m_resources.clear();
+    m_passes.clear();
+    m_order.clear();
+    m_compiled = false;
+    m_current_pass = -1;
+}
+
+[[nodiscard]] RenderGraph::Resource RenderGraph::create_texture(const char* name, const TextureDesc& desc)
+{
+    util_assert(initialized == true, "RenderGraph has not been initialized");
+    m_resources.emplace_back(ResourceNode { .name = name, .desc = desc });
+    return static_cast<Resource>(m_resources.size() - 1);
+}
+
+[[nodiscard]] RenderGraph::Resource RenderGraph::import_texture(const char* name, Texture& texture, const TextureDesc& desc)
+{
+    util_assert(initialized == true, "RenderGraph has not been initialized");
+    m_resources.emplace_back(ResourceNode { .name = name, .desc = desc, .imported = &texture, .is_imported = true });
+    return static_cast<Resource>(m_resources.size() - 1);
+}
+
+[[nodiscard]] RenderGraph::Resource RenderGraph::import_external(const char* name)
+{
+    util_assert(initialized == true, "RenderGraph has not been initialized");
+    m_resources.emplace_back(ResourceNode { .name = name, .is_external = true, .is_imported = true });
+    return static_cast<Resource>(m_resources.size() - 1);
+}
+
+void RenderGraph::add_pass(const char* name, const SetupFunction& setup, ExecuteFunction execute)
+{
+    util_assert(initialized == true, "RenderGraph has not been initialized");
+    util_assert(m_compiled == false, "RenderGraph::add_pass() called after compile()");
+
+    m_passes.emplace_back(PassNode { .name = name, .execute = std::move(execute) });
+    Builder builder(*this, static_cast<u32>(m_passes.size() - 1));
+    setup(builder);
+}
+
+void RenderGraph::compile()
+{
+    PROFILE_SCOPE("RenderGraph::compile");
+    util_assert(initialized == true, "RenderGraph has not been initialized");
+
+    cull_passes();
+    order_passes();
+    compute_lifetimes();
+    assign_physical_textures();
+    compute_barriers();
+
+    std::string schedule = build_schedule();
+    m_schedule_changed = schedule != m_schedule;
+    m_schedule = std::move(schedule);
+    m_compiled = true;
+}
+
+void RenderGraph::cull_passes()
+{
+    // A pass stays while anything reads one of its writes, imported resources count as read
+    std::vector<u32> resource_refs(m_resources.size());
+    for (usize i = 0; i < m_resources.size(); i++) {
+        resource_refs[i] = m_resources[i].readers + (m_resources[i].is_imported ? 1 : 0);
+    }
+
+    std::vector<Resource> unused;
+    for (auto& pass : m_passes) {
+        pass.culled = false;
+        pass.ref_count = static_cast<u32>(pass.writes.size());
+    }
+    for (usize i = 0; i < m_resources.size(); i++) {
+        if (resource_refs[i] == 0) {
+            unused.emplace_back(static_cast<Resource>(i));
+        }
+    }
+
+    while (!unused.empty()) {
+        Resource resource = unused.back();
+        unused.pop_back();
+
+        for (auto& pass : m_passes) {
+            const bool writes = std::ranges::any_of(pass.writes, [&](const auto& write) { return write.first == resource; });
+            if (!writes || pass.culled || pass.side_effect) {
+                continue;
+            }
+            if (--pass.ref_count == 0) {
+                pass.culled = true;
+                for (const auto& [read, access] : pass.reads) {
+                    if (--resource_refs[read] == 0) {
+                        unused.emplace_back(read);
+                    }
+                }
+            }
+        }
+    }
+
+    // Passes that write nothing and have no side effect are dead too
+    for (auto& pass : m_passes) {
+        if (pass.writes.empty() && !pass.side_effect) {
+            pass.culled = true;
+        }
+    }
+}
+
+void RenderGraph::order_passes()
+{
+    // A read depends on the last write declared before it, Kahn's algorithm keeps declaration order on ties
+    const usize pass_count = m_passes.size();
+    std::vector<std::vector<u32>> edges(pass_count);
+    std::vector<u32> in_degree(pass_count);
+    std::vector<i32> last_writer(m_resources.size(), -1);
+    std::vector<std::vector<u32>> readers_since_write(m_resources.size());
+
+    const auto add_edge = [&](u32 from, u32 to) {
+        if (from != to && std::ranges::find(edges[from], to) == edges[from].end()) {
+            edges[from].emplace_back(to);
+            in_degree[to]++;
+        }
+    };
+
+    for (u32 i = 0; i < pass_count; i++) {
+        if (m_passes[i].culled) {
+            continue;
+        }
+        for (const auto& [resource, access] : m_passes[i].reads) {
+            if (last_writer[resource] >= 0) {
+                add_edge(static_cast<u32>(last_writer[resource]), i);
+            }
+            readers_since_write[resource].emplace_back(i);
+        }
+        for (const auto& [resource, access] : m_passes[i].writes) {
+            if (last_writer[resource] >= 0) {
+                add_edge(static_cast<u32>(last_writer[resource]), i);
+            }
+            // Write after read, earlier readers have to finish first
+            for (u32 reader : readers_since_write[resource]) {
+                add_edge(reader, i);
+            }
+            readers_since_write[resource].clear();
+            last_writer[resource] = static_cast<i32>(i);
+        }
+    }
+
+    m_order.clear();
+    std::vector<bool> scheduled(pass_count, false);
+    for (usize step = 0; step < pass_count; step++) {
+        for (u32 i = 0; i < pass_count; i++) {
+            if (!m_passes[i].culled && !scheduled[i] && in_degree[i] == 0) {
+                scheduled[i] = true;
+                m_order.emplace_back(i);
+                for (u32 next : edges[i]) {
+                    in_degree[next]--;
+                }
+                break;
+            }
+        }
+    }
+
+    const auto live_count = std::ranges::count_if(m_passes, [](const PassNode& pass) { return !pass.culled; });
+    util_assert(m_order.size() == static_cast<usize>(live_count), "RenderGraph has a dependency cycle");
+}
+
+void RenderGraph::compute_lifetimes()
+{
+    for (auto& resource : m_resources) {
+        resource.first_use = -1;
+        resource.last_use = -1;
+        resource.physical = -1;
+    }
+
+    for (usize order = 0; order < m_order.size(); order++) {
+        const PassNode& pass = m_passes[m_order[order]];
+        const auto use = [&](Resource resource) {
+            ResourceNode& node = m_resources[resource];
+            if (node.first_use < 0) {
+                node.first_use = static_cast<i32>(order);
+            }
+            node.last_use = static_cast<i32>(order);
+        };
+        for (const auto& [resource, access] : pass.reads) {
+            use(resource);
+        }
+        for (const auto& [resource, access] : pass.writes) {
+            use(resource);
+        }
+    }
+}
+
+void RenderGraph::assign_physical_textures()
+{
+    for (auto& physical : m_physical_textures) {
+        physical.busy_until = -1;
+        physical.used = false;
+    }
+
+    std::vector<Resource> transients;
+    for (usize i = 0; i < m_resources.size(); i++) {
+        const ResourceNode& node = m_resources[i];
+        if (!node.is_imported && node.first_use >= 0) {
+            transients.emplace_back(static_cast<Resource>(i));
+        }
+    }
+    std::ranges::sort(transients, [&](Resource a, Resource b) { return m_resources[a].first_use < m_resources[b].first_use; });
+
+    for (Resource resource : transients) {
+        ResourceNode& node = m_resources[resource];
+
+        for (usize i = 0; i < m_physical_textures.size(); i++) {
+            PhysicalTexture& physical = m_physical_textures[i];
+            if (physical.desc == node.desc && physical.busy_until < node.first_use) {
+                node.physical = static_cast<i32>(i);
+                break;
+            }
+        }
+
+        if (node.physical < 0) {
+            TextureInfo texture_info;
+            texture_info.size = TextureSize { .width = node.desc.width, .height = node.desc.height, .depth = 0 };
+            texture_info.internal_format = node.desc.internal_format;
+            texture_info.levels = node.desc.levels;
+            texture_info.mipmaps = GL_FALSE;
+            texture_info.wrap_s = GL_CLAMP_TO_EDGE;
+            texture_info.wrap_t = GL_CLAMP_TO_EDGE;
+
+            auto texture = std::make_unique<Texture>();
+            texture->init(texture_info);
+            m_physical_textures.emplace_back(PhysicalTexture { .desc = node.desc, .texture = std::move(texture) });
+            node.physical = static_cast<i32>(m_physical_textures.size() - 1);
+        }
+
+        PhysicalTexture& physical = m_physical_textures[node.physical];
+        physical.busy_until = node.last_use;
+        physical.used = true;
+    }
+
+    // Allocations nothing used this frame (old sizes after a resize) are released
+    for (usize i = m_physical_textures.size(); i-- > 0;) {
+        if (!m_physical_textures[i].used) {
+            m_physical_textures.erase(m_physical_textures.begin() + static_cast<i64>(i));
+            for (auto& node : m_resources) {
+                if (node.physical > static_cast<i32>(i)) {
+                    node.physical--;
+                }
+            }
+        }
+    }
+}
+
+void RenderGraph::compute_barriers()
+{
+    // Only image and storage writes are incoherent, framebuffer writes are visible to later commands.
+    // A glMemoryBarrier covers every resource, so bits already issued since a write are not repeated
+    struct PendingWrite {
+        bool pending = false;
+        Access access = Access::ColorAttachment;
+        GLbitfield issued = 0;
+    };
+    std::vector<PendingWrite> pending(m_resources.size());
+
+    for (u32 index : m_order) {
+        PassNode& pass = m_passes[index];
+        pass.barriers = 0;
+
+        const auto require = [&](Resource resource, Access access) {
+            const PendingWrite& write = pending[resource];
+            if (write.pending) {
+                pass.barriers |= get_barrier_bits(write.access, access) & ~write.issued;
+            }
+        };
+        for (const auto& [resource, access] : pass.reads) {
+            require(resource, access);
+        }
+        for (const auto& [resource, access] : pass.writes) {
+            require(resource, access);
+        }
+
+        for (auto& write : pending) {
+            write.issued |= pass.barriers;
+        }
+        for (const auto& [resource, access] : pass.writes) {
+            if (access == Access::ImageStore || access == Access::StorageWrite) {
+                pending[resource] = PendingWrite { .pending = true, .access = access, .issued = 0 };
+            } else {
+                pending[resource] = PendingWrite {};
+            }
+        }
+    }
+}
+
+void RenderGraph::execute()
+{
+    util_assert(initialized == true, "RenderGraph has not been initialized");
+    util_assert(m_compiled == true, "RenderGraph::execute() called before compile()");
+
+    for (u32 index : m_order) {
+        PassNode& pass = m_passes[index];
+        if (pass.barriers != 0) {
+            glMemoryBarrier(pass.barriers);
+        }
+
+        m_current_pass = static_cast<i32>(index);
+        PROFILE_SCOPE(pass.name);
+        GpuProfiler::Scope scope(pass.name);
+        pass.execute(*this);
+        Framebuffer::unbind();
+    }
+    m_current_pass = -1;
+}
+
+[[nodiscard]] Texture& RenderGraph::get_texture(Resource resource)
+{
+    util_assert(initialized == true, "RenderGraph has not been initialized");
+    util_assert(resource < m_resources.size(), "RenderGraph::get_texture() invalid resource");
+
+    ResourceNode& node = m_resources[resource];
+    util_assert(node.is_external == false, std::format("RenderGraph resource \"{}\" is external and has no texture", node.name));
+    if (node.is_imported) {
+        return *node.imported;
+    }
+    util_assert(node.physical >= 0, std::format("RenderGraph resource \"{}\" has no allocation, is it used by a live pass?", node.name));
+    return *m_physical_textures[node.physical].texture;
+}
+
+void RenderGraph::bind_attachments()
+{
+    util_assert(initialized == true, "RenderGraph has not been initialized");
+    util_assert(m_current_pass >= 0, "RenderGraph::bind_attachments() called outside of a pass");
+
+    const PassNode& pass = m_passes[m_current_pass];
+    auto& framebuffer = m_framebuffers[pass.name];
+    if (framebuffer == nullptr) {
+        framebuffer = std::make_unique<Framebuffer>();
+        framebuffer->init();
+    }
+
+    std::vector<GLenum> draw_buffers;
+    TextureDesc size {};
+    for (const auto& [resource, access] : pass.writes) {
+        if (access == Access::ColorAttachment) {
+            const auto attachment = static_cast<GLenum>(GL_COLOR_ATTACHMENT0 + draw_buffers.size());
+            framebuffer->bind_texture(attachment, get_texture(resource).get_id(), 0);
+            draw_buffers.emplace_back(attachment);
+            size = m_resources[resource].desc;
+        } else if (access == Access::DepthAttachment) {
+            framebuffer->bind_texture(GL_DEPTH_ATTACHMENT, get_texture(resource).get_id(), 0);
+            size = m_resources[resource].desc;
+        }
+    }
+
+    if (draw_buffers.empty()) {
+        framebuffer->bind_draw_buffer(GL_NONE);
+    } else {
+        framebuffer->bind_draw_buffers(static_cast<GLsizei>(draw_buffers.size()), draw_buffers.data());
+    }
+    framebuffer->bind();
+    glViewport(0, 0, size.width, size.height);
+}
+
+[[nodiscard]] const std::string& RenderGraph::get_schedule() const
+{
+    util_assert(initialized == true, "RenderGraph has not been initialized");
+    return m_schedule;
+}
+
+[[nodiscard]] std::string RenderGraph::build_schedule() const
+{
+    std::string schedule;
+
+    usize transient_bytes = 0;
+    usize transient_count = 0;
+    for (const auto& node : m_resources) {
+        if (!node.is_imported && node.first_use >= 0) {
+            transient_bytes += get_texture_size_bytes(node.desc);
+            transient_count++;
+        }
+    }
+    usize allocated_bytes = 0;
+    for (const auto& physical : m_physical_textures) {
+        allocated_bytes += get_texture_size_bytes(physical.desc);
+    }
+    const usize culled_count = m_passes.size() - m_order.size();
+
+    schedule += std::format("Render graph: {} passes ({} culled), {} transient textures in {} allocations, {:.2f} MiB ({:.2f} MiB without aliasing)\n",
+        m_order.size(),
+        culled_count,
+        transient_count,
+        m_physical_textures.size(),
+        static_cast<f64>(allocated_bytes) / (1024.0 * 1024.0),
+        static_cast<f64>(transient_bytes) / (1024.0 * 1024.0));
+
+    for (usize order = 0; order < m_order.size(); order++) {
+        const PassNode& pass = m_passes[m_order[order]];
+        schedule += std::format("  {} {}", order, pass.name);
+        if (pass.barriers != 0) {
+            schedule += std::format(" [barrier 0x{:x}]", pass.barriers);
+        }
+        for (const auto& [resource, access] : pass.reads) {
+            schedule += std::format(" <{}:{}", m_resources[resource].name, get_access_name(access));
+        }
+        for (const auto& [resource, access] : pass.writes) {
+            schedule += std::format(" >{}:{}", m_resources[resource].name, get_access_name(access));
+        }
+        schedule += '\n';
+    }
+    for (const auto& pass : m_passes) {
+        if (pass.culled) {
+            schedule += std::format("  culled {}\n", pass.name);
+        }
+    }
+
+    for (usize i = 0; i < m_physical_textures.size(); i++) {
+        const TextureDesc& desc = m_physical_textures[i].desc;
+        schedule += std::format("  memory #{} {} {}x{}:", i, get_format_name(desc.internal_format), desc.width, desc.height);
+        for (const auto& node : m_resources) {
+            if (!node.is_imported && node.physical == static_cast<i32>(i)) {
+                schedule += std::format(" {} [{}-{}]", node.name, node.first_use, node.last_use);
+            }
+        }
+        schedule += '\n';
+    }
+
+    return schedule;
+}
+
+[[nodiscard]] bool RenderGraph::schedule_changed() const
+{
+    util_assert(initialized == true, "RenderGraph has not been initialized");
+    return m_schedule_changed;
+}
+
+[[nodiscard]] bool RenderGraph::is_initialized() const
+{
+    return initialized;
+}
+
+[[nodiscard]] GLbitfield RenderGraph::get_barrier_bits(Access previous_write, Access access)
+{
+    if (previous_write == Access::ImageStore) {
+        switch (access) {
+            case Access::Sampled:
+                return GL_TEXTURE_FETCH_BARRIER_BIT;
+            case Access::ImageLoad:
+            case Access::ImageStore:
+                return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+            case Access::ColorAttachment:
+            case Access::DepthAttachment:
+                return GL_FRAMEBUFFER_BARRIER_BIT;
+            default:
+                return 0;
+        }
+    }
+    if (previous_write == Access::StorageWrite) {
+        switch (access) {
+            case Access::StorageRead:
+            case Access::StorageWrite:
+                return GL_SHADER_STORAGE_BARRIER_BIT;
+            case Access::Indirect:
+                return GL_COMMAND_BARRIER_BIT;
+            default:
+                return 0;
+        }
+    }
+    return 0;
+}
+
+[[nodiscard]] usize RenderGraph::get_texture_size_bytes(const TextureDesc& desc)
+{
+    usize bytes_per_pixel = 4;
+    switch (desc.internal_format) {
+        case GL_R8:
+            bytes_per_pixel = 1;
+            break;
+        case GL_RG8:
+            bytes_per_pixel = 2;
+            break;
+        case GL_RGBA16F:
+        case GL_RG32F:
+            bytes_per_pixel = 8;
+            break;
+        case GL_RGBA32F:
+            bytes_per_pixel = 16;
+            break;
+        default:
+            break;
+    }
+
+    usize bytes = 0;
+    for (i32 level = 0; level < desc.levels; level++) {
+        bytes += static_cast<usize>(std::max(desc.width >> level, 1)) * static_cast<usize>(std::max(desc.height >> level, 1)) * bytes_per_pixel;
+    }
+    return bytes;
+}
+
+[[nodiscard]] const char* RenderGraph::get_format_name(GLenum internal_format)
+{
+    switch (internal_format) {
+        case GL_R8:
+            return "R8";
+        case GL_RG8:
+            return "RG8";
+        case GL_RGBA8:
+            return "RGBA8";
+        case GL_RG16_SNORM:
+            return "RG16_SNORM";
+        case GL_RGBA16F:
+            return "RGBA16F";
+        case GL_RG32F:
+            return "RG32F";
+        case GL_RGBA32F:
+            return "RGBA32F";
+        case GL_R32UI:
+            return "R32UI";
+        case GL_DEPTH_COMPONENT24:
+            return "DEPTH24";
+        case GL_DEPTH_COMPONENT32F:
+            return "DEPTH32F";
+        default:
+            return "unknown";
+    }
+}
+
+[[nodiscard]] const char* RenderGraph::get_access_name(Access access)
+{
+    switch (access) {
+        case Access::ColorAttachment:
+            return "color";
+        case Access::DepthAttachment:
+            return "depth";
+        case Access::Sampled:
+            return "sampled";
+        case Access::ImageLoad:
+            return "image_load";
+        case Access::ImageStore:
+            return "image_store";
+        case Access::StorageRead:
+            return "storage_read";
+        case Access::StorageWrite:
+            return "storage_write";
+        case Access::Indirect:
+            return "indirect";
+    }
+    return "unknown";
+}
+
+} // namespace Renderer
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "framebuffer.hpp"
+#include "texture.hpp"
+
+namespace Renderer {
+
+// Frame graph rebuilt every frame. Passes declare what they read and write, compile() culls the
+// passes nothing depends on, orders the rest, gives transient textures with non-overlapping
+// lifetimes the same allocation and works out the glMemoryBarrier bits every pass needs.
+// GL has no memory aliasing across formats, so only textures with an identical description share
+class RenderGraph : public NoCopyNoMove {
+public:
+    using Resource = u32;
+    static constexpr Resource INVALID_RESOURCE = std::numeric_limits<Resource>::max();
+
+    enum class Access : u8 {
+        ColorAttachment = 0,
+        DepthAttachment,
+        Sampled,
+        ImageLoad,
+        ImageStore,
+        StorageRead,
+        StorageWrite,
+        Indirect,
+    };
+
+    struct TextureDesc {
+        i32 width = 0;
+        i32 height = 0;
+        GLenum internal_format = GL_RGBA8;
+        GLsizei levels = 1;
+
+        bool operator==(const TextureDesc& other) const = default;
+    };
+
+    class Builder {
+    public:
+        void read(Resource resource, Access access);
+        void write(Resource resource, Access access);
+        // The pass has effects outside the graph (the default framebuffer) and is never culled
+        void side_effect();
+
+    private:
+        friend class RenderGraph;
+        Builder(RenderGraph& graph, u32 pass);
+
+        RenderGraph& m_graph;
+        u32 m_pass;
+    };
+
+    using SetupFunction = std::function<void(Builder&)>;
+    using ExecuteFunction = std::function<void(RenderGraph&)>;
+
+    RenderGraph() = default;
+    ~RenderGraph();
+
+    void init();
+
+    // Forgets last frame's passes and resources, the texture allocations are kept for reuse
+    void begin_frame();
+
+    [[nodiscard]] Resource create_texture(const char* name, const TextureDesc& desc);
+    // Owned outside the graph, writing to one counts as a side effect
+    [[nodiscard]] Resource import_texture(const char* name, Texture& texture, const TextureDesc& desc);
+    // Only tracked for ordering and barriers (storage buffers, shadow cubemaps spread over lights)
+    [[nodiscard]] Resource import_external(const char* name);
+
+    // Every pass is a gpu profiler scope, so name has to outlive the frame (a string literal)
+    void add_pass(const char* name, const SetupFunction& setup, ExecuteFunction execute);
+
+    void compile();
+    void execute();
+
+    // Only valid while executing
+    [[nodiscard]] Texture& get_texture(Resource resource);
+    // Binds a framebuffer with the attachments the executing pass writes and sets the viewport.
+    // Every pass starts with the default framebuffer bound
+    void bind_attachments();
+
+    // Passes in execution order with their accesses and barriers, culled passes and texture allocations
+    [[nodiscard]] const std::string& get_schedule() const;
+    // True when the last compile produced a different schedule than the one before
+    [[nodiscard]] bool schedule_changed() const;
+    [[nodiscard]] bool is_initialized() const;
+
+private:
+    struct ResourceNode {
+        std::string name;
+        TextureDesc desc;
+        bool is_external = false;
+        Texture* imported = nullptr;
+        bool is_imported = false;
+
+        u32 readers = 0;
+        i32 first_use = -1;
+        i32 last_use = -1;
+        i32 physical = -1;
+    };
+
+    struct PassNode {
+        // Kept as given, the gpu profiler reads pass names back frames later
+        const char* name = nullptr;
+        ExecuteFunction execute;
+        std::vector<std::pair<Resource, Access>> reads;
+        std::vector<std::pair<Resource, Access>> writes;
+        bool side_effect = false;
+        bool culled = false;
+        u32 ref_count = 0;
+        GLbitfield barriers = 0;
+    };
+
+    struct PhysicalTexture {
+        TextureDesc desc;
+        std::unique_ptr<Texture> texture;
+        // Last ordered pass using the texture this frame, -1 when it is free
+        i32 busy_until = -1;
+        bool used = false;
+    };
+
+    void cull_passes();
+    void order_passes();
+    void compute_lifetimes();
+    void assign_physical_textures();
+    void compute_barriers();
+    [[nodiscard]] std::string build_schedule() const;
+
+    [[nodiscard]] static GLbitfield get_barrier_bits(Access previous_write, Access access);
+    [[nodiscard]] static usize get_texture_size_bytes(const TextureDesc& desc);
+    [[nodiscard]] static const char* get_format_name(GLenum internal_format);
+    [[nodiscard]] static const char* get_access_name(Access access);
+
+    bool initialized = false;
+    bool m_compiled = false;
+    i32 m_current_pass = -1;
+
+    std::vector<ResourceNode> m_resources;
+    std::vector<PassNode> m_passes;
+    std::vector<u32> m_order;
+
+    std::vector<PhysicalTexture> m_physical_textures;
+    std::unordered_map<std::string, std::unique_ptr<Framebuffer>> m_framebuffers;
+
+    std::string m_schedule;
+    bool m_schedule_changed = false;
+};
+
+} // namespace Renderer
@@ -0,0 +1,169 @@
+#include "render_queue.hpp"
+
+#include "../utils/job_system.hpp"
+
+namespace Renderer {
+
+namespace {
+    constexpr u64 get_mask(u32 bits)
+    {
+        return (u64 { 1 } << bits) - 1;
+    }
+
+    constexpr u32 DEPTH_SHIFT = 0;
+    constexpr u32 MESH_SHIFT = DEPTH_SHIFT + RenderQueue::DEPTH_BITS;
+    constexpr u32 MATERIAL_SHIFT = MESH_SHIFT + RenderQueue::MESH_BITS;
+    constexpr u32 PROGRAM_SHIFT = MATERIAL_SHIFT + RenderQueue::MATERIAL_BITS;
+    constexpr u32 ALPHA_SHIFT = PROGRAM_SHIFT + RenderQueue::PROGRAM_BITS;
+    constexpr u32 PASS_SHIFT = ALPHA_SHIFT + RenderQueue::ALPHA_BITS;
+
+    // Blended keys move the depth up to right below the alpha mode
+    constexpr u32 BLEND_MESH_SHIFT = 0;
+    constexpr u32 BLEND_MATERIAL_SHIFT = BLEND_MESH_SHIFT + RenderQueue::MESH_BITS;
+    constexpr u32 BLEND_PROGRAM_SHIFT = BLEND_MATERIAL_SHIFT + RenderQueue::MATERIAL_BITS;
+    constexpr u32 BLEND_DEPTH_SHIFT = BLEND_PROGRAM_SHIFT + RenderQueue::PROGRAM_BITS;
+    static_assert(BLEND_DEPTH_SHIFT + RenderQueue::DEPTH_BITS == ALPHA_SHIFT);
+} // anonymous namespace
+
+RenderQueue::~RenderQueue()
+{
+    initialized = false;
+}
+
+void RenderQueue::init()
+{
+    util_assert(initialized == false, "RenderQueue::init() has already been initialized");
+    util_assert(Utils::Jobs::is_initialized(), "RenderQueue needs the job system, call Physics::Engine::setup_singletons() first");
+    initialized = true;
+}
+
+void RenderQueue::run_chunk(u32 chunk, u32 count, const KeyFunction& function)
+{
+    PROFILE_SCOPE("RenderQueue chunk");
+    auto& items = m_chunk_items[chunk];
+    items.clear();
+
+    const u32 end = std::min((chunk + 1) * CHUNK_SIZE, count);
+    for (u32 index = chunk * CHUNK_SIZE; index < end; index++) {
+        function(index, items);
+    }
+}
+
+void RenderQueue::build(u32 count, const KeyFunction& function)
+{
+    util_assert(initialized == true, "RenderQueue has not been initialized");
+
+    const u32 chunk_count = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    if (m_chunk_items.size() < chunk_count) {
+        m_chunk_items.resize(chunk_count);
+    }
+    for (u32 chunk = chunk_count; chunk < m_chunk_items.size(); chunk++) {
+        m_chunk_items[chunk].clear();
+    }
+
+    // The frame waits on the queue, so it goes ahead of loading work
+    Utils::Jobs::get().parallel_for(chunk_count, [&](u32 chunk) { run_chunk(chunk, count, function); }, Utils::JobSystem::Priority::High);
+
+    // Chunks are merged in order so equal keys keep the draw list order
+    m_items.clear();
+    for (u32 chunk = 0; chunk < chunk_count; chunk++) {
+        m_items.insert(m_items.end(), m_chunk_items[chunk].begin(), m_chunk_items[chunk].end());
+    }
+
+    {
+        PROFILE_SCOPE("RenderQueue::radix_sort");
+        radix_sort();
+    }
+}
+
+void RenderQueue::radix_sort()
+{
+    // Least significant byte first, a byte every key shares is skipped
+    m_scratch.resize(m_items.size());
+
+    for (u32 shift = 0; shift < 64; shift += 8) {
+        std::array<usize, 256> offsets {};
+        for (const auto& item : m_items) {
+            offsets[(item.key >> shift) & 0xFF]++;
+        }
+        if (offsets[(m_items.empty() ? 0 : m_items.front().key >> shift) & 0xFF] == m_items.size()) {
+            continue;
+        }
+
+        usize sum = 0;
+        for (auto& offset : offsets) {
+            const usize count = offset;
+            offset = sum;
+            sum += count;
+        }
+        for (const auto& item : m_items) {
+            m_scratch[offsets[(item.key >> shift) & 0xFF]++] = item;
+        }
+        std::swap(m_items, m_scratch);
+    }
+}
+
+[[nodiscard]] std::span<const RenderQueue::Item> RenderQueue::get_items() const
+{
+    util_assert(initialized == true, "RenderQueue has not been initialized");
+    return m_items;
+}
+
+[[nodiscard]] std::span<const RenderQueue::Item> RenderQueue::get_items(u8 pass, AlphaMode alpha_mode) const
+{
+    util_assert(initialized == true, "RenderQueue has not been initialized");
+
+    const u64 prefix = (static_cast<u64>(pass) << PASS_SHIFT) | (static_cast<u64>(alpha_mode) << ALPHA_SHIFT);
+    const u64 last = prefix | get_mask(ALPHA_SHIFT);
+    const auto begin = std::ranges::lower_bound(m_items, prefix, {}, &Item::key);
+    const auto end = std::ranges::upper_bound(m_items, last, {}, &Item::key);
+    return { begin, end };
+}
+
+[[nodiscard]] u32 RenderQueue::get_worker_count() const
+{
+    util_assert(initialized == true, "RenderQueue has not been initialized");
+    return Utils::Jobs::get().get_worker_count();
+}
+
+[[nodiscard]] bool RenderQueue::is_initialized() const
+{
+    return initialized;
+}
+
+[[nodiscard]] u64 RenderQueue::make_key(const KeyInfo& info)
+{
+    const u64 depth = static_cast<u64>(std::clamp(info.depth, 0.0F, 1.0F) * static_cast<f32>(get_mask(DEPTH_BITS)));
+    const u64 program = info.program & get_mask(PROGRAM_BITS);
+    const u64 material = info.material & get_mask(MATERIAL_BITS);
+    const u64 mesh = info.mesh & get_mask(MESH_BITS);
+
+    u64 key = (static_cast<u64>(info.pass & get_mask(PASS_BITS)) << PASS_SHIFT)
+        | (static_cast<u64>(info.alpha_mode) << ALPHA_SHIFT);
+
+    if (info.alpha_mode == AlphaMode::Blend) {
+        key |= ((get_mask(DEPTH_BITS) - depth) << BLEND_DEPTH_SHIFT)
+            | (program << BLEND_PROGRAM_SHIFT)
+            | (material << BLEND_MATERIAL_SHIFT)
+            | (mesh << BLEND_MESH_SHIFT);
+    } else {
+        key |= (program << PROGRAM_SHIFT)
+            | (material << MATERIAL_SHIFT)
+            | (mesh << MESH_SHIFT)
+            | (depth << DEPTH_SHIFT);
+    }
+    return key;
+}
+
+[[nodiscard]] AlphaMode RenderQueue::get_alpha_mode(u64 key)
+{
+    return static_cast<AlphaMode>((key >> ALPHA_SHIFT) & get_mask(ALPHA_BITS));
+}
+
+[[nodiscard]] u32 RenderQueue::get_program(u64 key)
+{
+    const u32 shift = get_alpha_mode(key) == AlphaMode::Blend ? BLEND_PROGRAM_SHIFT : PROGRAM_SHIFT;
+    return static_cast<u32>((key >> shift) & get_mask(PROGRAM_BITS));
+}
+
+} // namespace Renderer
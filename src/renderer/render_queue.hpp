@@ -0,0 +1,73 @@
+#pragma once
+
+#include "mesh.hpp"
+
+namespace Renderer {
+
+// Draws of a frame as 64 bit sort keys. Keys are generated by jobs over chunks of the caller's
+// draw list and radix sorted, the GL thread then walks the sorted items in order.
+//
+// Opaque and masked keys: pass | alpha | program | material | mesh | depth (front to back)
+// Blended keys:           pass | alpha | inverted depth (back to front) | program | material | mesh
+class RenderQueue : public NoCopyNoMove {
+public:
+    struct Item {
+        u64 key;
+        // Index into the caller's draw list
+        u32 index;
+    };
+
+    struct KeyInfo {
+        u8 pass = 0;
+        AlphaMode alpha_mode = AlphaMode::Opaque;
+        u32 program = 0;
+        u32 material = 0;
+        u32 mesh = 0;
+        // View distance divided by the far plane, clamped to 0-1
+        f32 depth = 0.0F;
+    };
+
+    // Appends the items of one entry of the caller's draw list, runs on a job system worker
+    using KeyFunction = std::function<void(u32 index, std::vector<Item>& items)>;
+
+    RenderQueue() = default;
+    ~RenderQueue();
+
+    void init();
+
+    // Replaces the queue with the sorted items of count draw list entries
+    void build(u32 count, const KeyFunction& function);
+
+    [[nodiscard]] std::span<const Item> get_items() const;
+    // Items of one pass and alpha mode, they are contiguous after sorting
+    [[nodiscard]] std::span<const Item> get_items(u8 pass, AlphaMode alpha_mode) const;
+    [[nodiscard]] u32 get_worker_count() const;
+    [[nodiscard]] bool is_initialized() const;
+
+    [[nodiscard]] static u64 make_key(const KeyInfo& info);
+    [[nodiscard]] static AlphaMode get_alpha_mode(u64 key);
+    [[nodiscard]] static u32 get_program(u64 key);
+
+    static constexpr u32 PASS_BITS = 4;
+    static constexpr u32 ALPHA_BITS = 2;
+    static constexpr u32 PROGRAM_BITS = 12;
+    static constexpr u32 MATERIAL_BITS = 16;
+    static constexpr u32 MESH_BITS = 16;
+    static constexpr u32 DEPTH_BITS = 14;
+    static_assert(PASS_BITS + ALPHA_BITS + PROGRAM_BITS + MATERIAL_BITS + MESH_BITS + DEPTH_BITS == 64);
+
+    // Draw list entries handed to a worker at a time
+    static constexpr u32 CHUNK_SIZE = 16;
+
+private:
+    bool initialized = false;
+
+    std::vector<Item> m_items;
+    std::vector<Item> m_scratch;
+    std::vector<std::vector<Item>> m_chunk_items;
+
+    void run_chunk(u32 chunk, u32 count, const KeyFunction& function);
+    void radix_sort();
+};
+
+} // namespace Renderer
@@ -1,5 +1,8 @@
 #include "shader.hpp"
 
+#include "counters.hpp"
+#include "gl_state.hpp"
+
 #include <fstream>
 
 namespace Renderer {
@@ -50,6 +53,7 @@ namespace {
         }
 
         glCompileShader(m_id);
+        Counters::add(Counters::Counter::ShaderCompiles);
 
         int is_compiled = 0;
         glGetShaderiv(m_id, GL_COMPILE_STATUS, &is_compiled);
@@ -88,6 +92,7 @@ ShaderProgram::~ShaderProgram()
     if (initialized) {
         if (!m_errors) {
             glDeleteProgram(m_id);
+            GlState::forget_program(m_id);
         }
         initialized = false;
     }
@@ -128,6 +133,12 @@ void ShaderProgram::init(ShaderInfo* shader_info, std::size_t shader_count)
     return initialized;
 }
 
+[[nodiscard]] GLuint ShaderProgram::get_id() const
+{
+    util_assert(initialized == true, "ShaderProgram has not been initialized");
+    return m_id;
+}
+
 bool ShaderProgram::has_errors() const
 {
     util_assert(initialized == true, "ShaderProgram has not been initialized");
@@ -157,79 +168,98 @@ bool ShaderProgram::errors_internal() const
 void ShaderProgram::bind()
 {
     util_assert(initialized == true, "ShaderProgram has not been initialized");
-    glUseProgram(m_id);
+    GlState::use_program(m_id);
 }
 
 void ShaderProgram::set_bool(const char* name, bool value)
 {
     util_assert(initialized == true, "ShaderProgram has not been initialized");
     glUniform1i(glGetUniformLocation(m_id, name), value);
+    Counters::add(Counters::Counter::UniformSets);
 }
 
 void ShaderProgram::set_int(const char* name, int value)
 {
     util_assert(initialized == true, "ShaderProgram has not been initialized");
     glUniform1i(glGetUniformLocation(m_id, name), value);
+    Counters::add(Counters::Counter::UniformSets);
 }
 
 void ShaderProgram::set_float(const char* name, float value)
 {
     util_assert(initialized == true, "ShaderProgram has not been initialized");
     glUniform1f(glGetUniformLocation(m_id, name), value);
+    Counters::add(Counters::Counter::UniformSets);
+}
+
+void ShaderProgram::set_ivec2(const char* name, glm::ivec2 value)
+{
+    util_assert(initialized == true, "ShaderProgram has not been initialized");
+    glUniform2iv(glGetUniformLocation(m_id, name), 1, &value[0]);
+    Counters::add(Counters::Counter::UniformSets);
 }
 
 void ShaderProgram::set_vec2(const char* name, glm::vec2 value)
 {
     util_assert(initialized == true, "ShaderProgram has not been initialized");
     glUniform2fv(glGetUniformLocation(m_id, name), 1, &value[0]);
+    Counters::add(Counters::Counter::UniformSets);
 }
 
 void ShaderProgram::set_vec2s(const char* name, float value1, float value2)
 {
     util_assert(initialized == true, "ShaderProgram has not been initialized");
     glUniform2f(glGetUniformLocation(m_id, name), value1, value2);
+    Counters::add(Counters::Counter::UniformSets);
 }
 
 void ShaderProgram::set_vec3(const char* name, glm::vec3 value)
 {
     util_assert(initialized == true, "ShaderProgram has not been initialized");
     glUniform3fv(glGetUniformLocation(m_id, name), 1, &value[0]);
+    Counters::add(Counters::Counter::UniformSets);
 }
 
 void ShaderProgram::set_vec3s(const char* name, float value1, float value2, float value3)
 {
     util_assert(initialized == true, "ShaderProgram has not been initialized");
     glUniform3f(glGetUniformLocation(m_id, name), value1, value2, value3);
+    Counters::add(Counters::Counter::UniformSets);
 }
 
 void ShaderProgram::set_vec4(const char* name, glm::vec4 value)
 {
     util_assert(initialized == true, "ShaderProgram has not been initialized");
     glUniform4fv(glGetUniformLocation(m_id, name), 1, &value[0]);
+    Counters::add(Counters::Counter::UniformSets);
 }
 
 void ShaderProgram::set_vec4s(const char* name, float value1, float value2, float value3, float value4)
 {
     util_assert(initialized == true, "ShaderProgram has not been initialized");
     glUniform4f(glGetUniformLocation(m_id, name), value1, value2, value3, value4);
+    Counters::add(Counters::Counter::UniformSets);
 }
 
 void ShaderProgram::set_mat2(const char* name, glm::mat2 value)
 {
     util_assert(initialized == true, "ShaderProgram has not been initialized");
     glUniformMatrix2fv(glGetUniformLocation(m_id, name), 1, GL_FALSE, &value[0][0]);
+    Counters::add(Counters::Counter::UniformSets);
 }
 
 void ShaderProgram::set_mat3(const char* name, glm::mat3 value)
 {
     util_assert(initialized == true, "ShaderProgram has not been initialized");
     glUniformMatrix3fv(glGetUniformLocation(m_id, name), 1, GL_FALSE, &value[0][0]);
+    Counters::add(Counters::Counter::UniformSets);
 }
 
 void ShaderProgram::set_mat4(const char* name, glm::mat4 value)
 {
     util_assert(initialized == true, "ShaderProgram has not been initialized");
     glUniformMatrix4fv(glGetUniformLocation(m_id, name), 1, GL_FALSE, &value[0][0]);
+    Counters::add(Counters::Counter::UniformSets);
 }
 
 } // namespace Renderer
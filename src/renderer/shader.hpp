@@ -18,12 +18,14 @@ public:
 
     [[nodiscard]] bool has_errors() const;
     [[nodiscard]] bool is_initialized() const;
+    [[nodiscard]] GLuint get_id() const;
 
     void bind();
 
     void set_bool(const char* name, bool value);
     void set_int(const char* name, int value);
     void set_float(const char* name, float value);
+    void set_ivec2(const char* name, glm::ivec2 value);
     void set_vec2(const char* name, glm::vec2 value);
     void set_vec2s(const char* name, float value1, float value2);
     void set_vec3(const char* name, glm::vec3 value);
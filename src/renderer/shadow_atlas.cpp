@@ -0,0 +1,197 @@
+#include "shadow_atlas.hpp"
+
+#include "gl_state.hpp"
+
+namespace Renderer {
+
+ShadowAtlas::~ShadowAtlas()
+{
+    initialized = false;
+}
+
+void ShadowAtlas::init()
+{
+    init(DEFAULT_ATLAS_SIZE);
+}
+
+void ShadowAtlas::init(i32 size)
+{
+    util_assert(initialized == false, "ShadowAtlas::init() has already been initialized");
+    util_assert(std::has_single_bit(static_cast<u32>(size)), std::format("ShadowAtlas size \"{}\" is not a power of two", size));
+
+    m_size = size;
+
+    Renderer::TextureInfo atlas_info;
+    atlas_info.size = Renderer::TextureSize { .width = m_size, .height = m_size, .depth = 0 };
+    atlas_info.internal_format = GL_DEPTH_COMPONENT24;
+    atlas_info.mipmaps = false;
+    atlas_info.wrap_s = GL_CLAMP_TO_BORDER;
+    atlas_info.wrap_t = GL_CLAMP_TO_BORDER;
+    atlas_info.wrap_r = GL_CLAMP_TO_BORDER;
+    m_texture.init(atlas_info);
+
+    m_framebuffer.init();
+    m_framebuffer.bind_texture(GL_DEPTH_ATTACHMENT, m_texture.get_id(), 0);
+    m_framebuffer.bind_draw_buffer(GL_NONE);
+    m_framebuffer.bind_read_buffer(GL_NONE);
+
+    m_free_tiles.clear();
+    m_free_tiles.resize(get_level(MIN_TILE_SIZE) + 1);
+    m_free_tiles[0].emplace_back(0, 0);
+
+    initialized = true;
+}
+
+usize ShadowAtlas::get_level(i32 size) const
+{
+    usize level = 0;
+    i32 level_size = m_size;
+    while (level_size / 2 >= size && level_size / 2 >= MIN_TILE_SIZE) {
+        level_size /= 2;
+        level++;
+    }
+    return level;
+}
+
+i32 ShadowAtlas::get_level_size(usize level) const
+{
+    return m_size >> level;
+}
+
+bool ShadowAtlas::split(usize level)
+{
+    if (m_free_tiles[level].empty()) {
+        if (level == 0 || !split(level - 1)) {
+            return false;
+        }
+    }
+
+    glm::ivec2 parent = m_free_tiles[level].back();
+    m_free_tiles[level].pop_back();
+
+    i32 half = get_level_size(level + 1);
+    m_free_tiles[level + 1].emplace_back(parent.x, parent.y);
+    m_free_tiles[level + 1].emplace_back(parent.x + half, parent.y);
+    m_free_tiles[level + 1].emplace_back(parent.x, parent.y + half);
+    m_free_tiles[level + 1].emplace_back(parent.x + half, parent.y + half);
+    return true;
+}
+
+[[nodiscard]] ShadowAtlas::Tile ShadowAtlas::allocate(i32 size)
+{
+    util_assert(initialized == true, "ShadowAtlas has not been initialized");
+
+    usize level = get_level(std::min(size, m_size));
+    if (m_free_tiles[level].empty()) {
+        if (level == 0 || !split(level - 1)) {
+            return {};
+        }
+    }
+
+    glm::ivec2 position = m_free_tiles[level].back();
+    m_free_tiles[level].pop_back();
+
+    return Tile { .x = position.x, .y = position.y, .size = get_level_size(level) };
+}
+
+void ShadowAtlas::free(Tile& tile)
+{
+    util_assert(initialized == true, "ShadowAtlas has not been initialized");
+    if (!tile.is_valid()) {
+        return;
+    }
+
+    usize level = get_level(tile.size);
+    glm::ivec2 position(tile.x, tile.y);
+    tile = {};
+
+    // Merge with the 3 siblings while they are all free
+    while (level > 0) {
+        i32 parent_size = get_level_size(level - 1);
+        glm::ivec2 parent = (position / parent_size) * parent_size;
+        i32 half = parent_size / 2;
+        std::array<glm::ivec2, 4> siblings = {
+            parent,
+            parent + glm::ivec2(half, 0),
+            parent + glm::ivec2(0, half),
+            parent + glm::ivec2(half, half),
+        };
+
+        auto& free_list = m_free_tiles[level];
+        usize free_siblings = 0;
+        for (const auto& sibling : siblings) {
+            if (sibling == position || std::ranges::find(free_list, sibling) != free_list.end()) {
+                free_siblings++;
+            }
+        }
+        if (free_siblings != siblings.size()) {
+            break;
+        }
+
+        std::erase_if(free_list, [&](const glm::ivec2& free_tile) {
+            return std::ranges::find(siblings, free_tile) != siblings.end();
+        });
+        position = parent;
+        level--;
+    }
+
+    m_free_tiles[level].emplace_back(position);
+}
+
+void ShadowAtlas::bind_tile(const Tile& tile)
+{
+    util_assert(initialized == true, "ShadowAtlas has not been initialized");
+    util_assert(tile.is_valid(), "ShadowAtlas::bind_tile() called with an invalid tile");
+
+    m_framebuffer.bind();
+    glViewport(tile.x, tile.y, tile.size, tile.size);
+    GlState::enable(GL_SCISSOR_TEST);
+    glScissor(tile.x, tile.y, tile.size, tile.size);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void ShadowAtlas::unbind()
+{
+    util_assert(initialized == true, "ShadowAtlas has not been initialized");
+    GlState::disable(GL_SCISSOR_TEST);
+    m_framebuffer.unbind();
+}
+
+[[nodiscard]] glm::vec4 ShadowAtlas::get_tile_rect(const Tile& tile) const
+{
+    util_assert(initialized == true, "ShadowAtlas has not been initialized");
+    auto size = static_cast<f32>(m_size);
+    return {
+        static_cast<f32>(tile.x) / size,
+        static_cast<f32>(tile.y) / size,
+        static_cast<f32>(tile.size) / size,
+        static_cast<f32>(tile.size) / size,
+    };
+}
+
+[[nodiscard]] Texture& ShadowAtlas::get_texture()
+{
+    util_assert(initialized == true, "ShadowAtlas has not been initialized");
+    return m_texture;
+}
+
+[[nodiscard]] i32 ShadowAtlas::get_size() const
+{
+    util_assert(initialized == true, "ShadowAtlas has not been initialized");
+    return m_size;
+}
+
+[[nodiscard]] bool ShadowAtlas::is_initialized() const
+{
+    return initialized;
+}
+
+[[nodiscard]] i32 ShadowAtlas::get_resolution(f32 screen_coverage, f32 importance)
+{
+    f32 weight = std::clamp(screen_coverage, 0.0F, 1.0F) * std::clamp(importance, 0.0F, 1.0F);
+    auto size = static_cast<u32>(weight * static_cast<f32>(MAX_TILE_SIZE));
+    size = std::bit_ceil(std::max(size, 1U));
+    return std::clamp(static_cast<i32>(size), MIN_TILE_SIZE, MAX_TILE_SIZE);
+}
+
+} // namespace Renderer
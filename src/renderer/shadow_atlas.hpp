@@ -0,0 +1,63 @@
+#pragma once
+
+#include "framebuffer.hpp"
+#include "texture.hpp"
+
+namespace Renderer {
+
+// One shared depth texture that 2D shadow maps are packed into. Tiles are
+// power of two squares handed out by a buddy allocator so lights can
+// change resolution without fragmenting the atlas
+class ShadowAtlas : public NoCopyNoMove {
+public:
+    struct Tile {
+        i32 x = 0;
+        i32 y = 0;
+        i32 size = 0;
+
+        [[nodiscard]] bool is_valid() const { return size > 0; }
+    };
+
+    ShadowAtlas() = default;
+    ~ShadowAtlas();
+
+    void init();
+    void init(i32 size);
+
+    // Returns an invalid tile if the atlas is full, size is rounded up to a power of two
+    [[nodiscard]] Tile allocate(i32 size);
+    void free(Tile& tile);
+
+    // Binds the framebuffer with the viewport and scissor set to the tile and clears it
+    void bind_tile(const Tile& tile);
+    void unbind();
+
+    // xy offset and zw scale of the tile in texture coordinates
+    [[nodiscard]] glm::vec4 get_tile_rect(const Tile& tile) const;
+    [[nodiscard]] Texture& get_texture();
+    [[nodiscard]] i32 get_size() const;
+    [[nodiscard]] bool is_initialized() const;
+
+    // Picks a tile size from how much of the screen the light covers and how bright it is (both 0 to 1)
+    [[nodiscard]] static i32 get_resolution(f32 screen_coverage, f32 importance);
+
+    static constexpr i32 DEFAULT_ATLAS_SIZE = 4096;
+    static constexpr i32 MIN_TILE_SIZE = 128;
+    static constexpr i32 MAX_TILE_SIZE = 2048;
+
+private:
+    bool initialized = false;
+
+    i32 m_size = DEFAULT_ATLAS_SIZE;
+    Renderer::Texture m_texture;
+    Renderer::Framebuffer m_framebuffer;
+
+    // Free tiles per level, level 0 is the whole atlas
+    std::vector<std::vector<glm::ivec2>> m_free_tiles;
+
+    [[nodiscard]] usize get_level(i32 size) const;
+    [[nodiscard]] i32 get_level_size(usize level) const;
+    bool split(usize level);
+};
+
+} // namespace Renderer
@@ -31,6 +31,12 @@ void ShadowMap::init_cubemap(i32 width, i32 height)
     init_internal(true);
 }
 
+void ShadowMap::reinit_cubemap(i32 width, i32 height)
+{
+    this->~ShadowMap();
+    init_cubemap(width, height);
+}
+
 void ShadowMap::init_internal(bool cubemap)
 {
     util_assert(initialized == false, "ShadowMap::init_internal() has already been initialized");
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "extensions.hpp"
 #include "framebuffer.hpp"
 #include "shader.hpp"
 #include "texture.hpp"
@@ -15,6 +16,7 @@ public:
     void init(i32 width, i32 height);
     void init_cubemap();
     void init_cubemap(i32 width, i32 height);
+    void reinit_cubemap(i32 width, i32 height);
 
     void bind();
     void unbind();
@@ -61,6 +63,29 @@ public:
         };
     }
 
+    // Single pass cubemap rendering without a geometry shader, every instance is
+    // (model, face) and the vertex shader routes it to its layer with gl_Layer
+    static consteval std::array<Renderer::ShaderInfo, 2> get_shader_info_cubemap_layered()
+    {
+        return std::array<Renderer::ShaderInfo, 2> {
+            Renderer::ShaderInfo {
+                .is_file = false,
+                .shader = get_vertex_shader_cubemap_layered(),
+                .type = GL_VERTEX_SHADER,
+            },
+            Renderer::ShaderInfo {
+                .is_file = false,
+                .shader = get_frag_shader_cubemap(),
+                .type = GL_FRAGMENT_SHADER,
+            },
+        };
+    }
+
+    static bool supports_layered_cubemap()
+    {
+        return Renderer::Extensions::is_extension_supported("GL_ARB_shader_viewport_layer_array");
+    }
+
 private:
     static consteval const char* get_vertex_shader()
     {
@@ -68,12 +93,15 @@ private:
             #version 460 core
             layout (location = 0) in vec3 aPos;
 
+            layout(binding = 1, std430) readonly buffer ssbo0 {
+                mat4 models[];
+            };
+
             uniform mat4 light_space_matrix;
-            uniform mat4 model;
 
             void main()
             {
-                gl_Position = light_space_matrix * model * vec4(aPos, 1.0);
+                gl_Position = light_space_matrix * models[gl_InstanceID] * vec4(aPos, 1.0);
             }
         )";
     }
@@ -94,11 +122,41 @@ private:
             #version 460 core
             layout (location = 0) in vec3 aPos;
 
-            uniform mat4 model;
+            layout(binding = 1, std430) readonly buffer ssbo0 {
+                mat4 models[];
+            };
+
+            void main()
+            {
+                gl_Position = models[gl_InstanceID] * vec4(aPos, 1.0);
+            }
+        )";
+    }
+
+    static consteval const char* get_vertex_shader_cubemap_layered()
+    {
+        return R"(
+            #version 460 core
+            #extension GL_ARB_shader_viewport_layer_array : require
+            layout (location = 0) in vec3 aPos;
+
+            layout(binding = 1, std430) readonly buffer ssbo0 {
+                mat4 models[];
+            };
+
+            uniform mat4 light_space_matrices[6];
+            uniform int faces[6];
+            uniform int face_count;
+
+            out vec4 FragPos;
 
             void main()
             {
-                gl_Position = model * vec4(aPos, 1.0);
+                int face = faces[gl_InstanceID % face_count];
+                FragPos = models[gl_InstanceID / face_count] * vec4(aPos, 1.0);
+
+                gl_Layer = face;
+                gl_Position = light_space_matrices[face] * FragPos;
             }
         )";
     }
@@ -1,6 +1,8 @@
 #include "texture.hpp"
 
+#include "counters.hpp"
 #include "extensions.hpp"
+#include "gl_state.hpp"
 
 namespace {
 
@@ -51,6 +53,44 @@ std::unique_ptr<TextureAllocator> create_texture_allocator()
 
 std::unique_ptr<TextureAllocator> texture_unit_allocator = nullptr;
 
+u64 get_pixel_size(GLenum format, GLenum type)
+{
+    u64 components = 4;
+    switch (format) {
+        case GL_RED:
+        case GL_RED_INTEGER:
+        case GL_DEPTH_COMPONENT:
+        case GL_STENCIL_INDEX:
+            components = 1;
+            break;
+        case GL_RG:
+        case GL_RG_INTEGER:
+        case GL_DEPTH_STENCIL:
+            components = 2;
+            break;
+        case GL_RGB:
+        case GL_BGR:
+        case GL_RGB_INTEGER:
+            components = 3;
+            break;
+        default:
+            break;
+    }
+
+    switch (type) {
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+        case GL_HALF_FLOAT:
+            return components * 2;
+        case GL_INT:
+        case GL_UNSIGNED_INT:
+        case GL_FLOAT:
+            return components * 4;
+        default:
+            return components;
+    }
+}
+
 }
 
 namespace Renderer {
@@ -65,6 +105,7 @@ Texture::~Texture()
     // util_assert(initialized == true, "Texture::~Texture() has not been initialized");
     if (initialized) {
         glDeleteTextures(1, &m_id);
+        GlState::forget_texture(m_id);
         initialized = false;
     }
 }
@@ -86,10 +127,12 @@ void Texture::init(TextureInfo& info)
 
     initialized = true;
 
-    if (info.from_file) {
+    if (info.from_file && info.image != nullptr) {
+        from_image(*info.image, info.file_path);
+    } else if (info.from_file) {
         from_file(info.file_path, info.flip);
     } else {
-        texture_storage(info.size, info.internal_format);
+        texture_storage(info.size, info.internal_format, info.levels);
     }
 
     if (info.mipmaps) {
@@ -121,6 +164,16 @@ void Texture::generate_mipmap()
 void Texture::sub_image(TextureSubimageInfo& info)
 {
     util_assert(initialized == true, "Texture has not been initialized");
+
+    u64 texels = static_cast<u64>(info.size.width);
+    if (m_dimensions != GL_TEXTURE_1D) {
+        texels *= static_cast<u64>(info.size.height);
+    }
+    if (m_dimensions == GL_TEXTURE_3D) {
+        texels *= static_cast<u64>(info.size.depth);
+    }
+    Counters::add(Counters::Counter::BytesUploaded, texels * get_pixel_size(info.format, info.type));
+
     switch (m_dimensions) {
         case GL_TEXTURE_1D:
             glTextureSubImage1D(m_id,
@@ -163,7 +216,13 @@ void Texture::sub_image(TextureSubimageInfo& info)
 void Texture::bind(GLuint texture_unit)
 {
     util_assert(initialized == true, "Texture has not been initialized");
-    glBindTextureUnit(texture_unit, m_id);
+    GlState::bind_texture_unit(texture_unit, m_id);
+}
+
+void Texture::bind_image(GLuint image_unit, GLint level, GLenum access, GLenum format)
+{
+    util_assert(initialized == true, "Texture has not been initialized");
+    glBindImageTexture(image_unit, m_id, level, GL_FALSE, 0, access, format);
 }
 
 [[nodiscard]] GLuint64 Texture::get_bindless_texture_id()
@@ -222,28 +281,43 @@ void Texture::set_max_anisotropy(float max_anisotropy)
     return m_id;
 }
 
-void Texture::texture_storage(TextureSize& size, GLenum internal_format)
+void Texture::texture_storage(TextureSize& size, GLenum internal_format, GLsizei levels)
 {
     util_assert(initialized == true, "Texture has not been initialized");
     switch (m_dimensions) {
         case GL_TEXTURE_1D:
-            glTextureStorage1D(m_id, 1, internal_format, size.width);
+            glTextureStorage1D(m_id, levels, internal_format, size.width);
             break;
         case GL_TEXTURE_2D:
-            glTextureStorage2D(m_id, 1, internal_format, size.width, size.height);
+            glTextureStorage2D(m_id, levels, internal_format, size.width, size.height);
             break;
         case GL_TEXTURE_3D:
-            glTextureStorage3D(m_id, 1, internal_format, size.width, size.height, size.depth);
+            glTextureStorage3D(m_id, levels, internal_format, size.width, size.height, size.depth);
             break;
         case GL_TEXTURE_CUBE_MAP:
-            glTextureStorage2D(m_id, 1, internal_format, size.width, size.height);
+            glTextureStorage2D(m_id, levels, internal_format, size.width, size.height);
             break;
         default:
             util_error(std::format("Texture::texture_storage: invalid texture dimensions {}\n", m_dimensions));
     }
 }
 
+[[nodiscard]] Image Image::load(const char* file, bool flip)
+{
+    // The thread local flag, decoding jobs must not flip each other's images
+    stbi_set_flip_vertically_on_load_thread(flip ? 1 : 0);
+
+    Image image;
+    image.pixels.reset(stbi_load(file, &image.size.width, &image.size.height, &image.channels, 0));
+    return image;
+}
+
 void Texture::from_file(const char* file, bool flip)
+{
+    from_image(Image::load(file, flip), file);
+}
+
+void Texture::from_image(const Image& image, const char* file)
 {
     util_assert(initialized == true, "Texture::from_file has not been initialized");
 
@@ -251,35 +325,27 @@ void Texture::from_file(const char* file, bool flip)
         util_error("currently only 2D textures are supported from files");
     }
 
-    if (flip) {
-        stbi_set_flip_vertically_on_load(1);
-    }
-
-    TextureSize size {};
-    int nr_channels {};
-    unsigned char* data = stbi_load(file, &size.width, &size.height, &nr_channels, 0);
-    if (data == nullptr) {
+    if (image.pixels == nullptr) {
         util_error(std::format("failed to load texture {}", file));
     }
 
+    TextureSize size = image.size;
     TextureSubimageInfo info {};
     info.type = GL_UNSIGNED_BYTE;
     info.size = size;
-    info.pixels = data;
+    info.pixels = image.pixels.get();
 
-    if (nr_channels == 3) {
-        texture_storage(size, GL_RGB8);
+    if (image.channels == 3) {
+        texture_storage(size, GL_RGB8, 1);
         info.format = GL_RGB;
-    } else if (nr_channels == 4) {
-        texture_storage(size, GL_RGBA8);
+    } else if (image.channels == 4) {
+        texture_storage(size, GL_RGBA8, 1);
         info.format = GL_RGBA;
     } else {
-        util_error(std::format("Texture: invalid number of channels \"{}\"", nr_channels));
+        util_error(std::format("Texture: invalid number of channels \"{}\"", image.channels));
     }
 
     sub_image(info);
-
-    stbi_image_free(data);
 }
 
 } // namespace Renderer
@@ -8,8 +8,21 @@ struct TextureSize {
     GLint depth = 0;
 };
 
+// Pixels of an image file decoded on the CPU, load() is thread safe so files can be decoded
+// off the GL thread and uploaded later
+struct Image {
+    TextureSize size {};
+    int channels = 0;
+    // Null when the file could not be decoded
+    std::unique_ptr<unsigned char, void (*)(void*)> pixels { nullptr, stbi_image_free };
+
+    [[nodiscard]] static Image load(const char* file, bool flip);
+};
+
 struct TextureInfo {
     bool from_file = GL_FALSE;
+    // Uploaded instead of decoding file_path again, file_path still names it in errors
+    const Image* image = nullptr;
     union {
         const char* file_path = nullptr;
         TextureSize size;
@@ -22,6 +35,8 @@ struct TextureInfo {
     GLint wrap_r = GL_REPEAT;
     std::array<float, 4> border_color = { 1.0F, 1.0F, 1.0F, 1.0F };
     bool mipmaps = GL_TRUE;
+    // Storage levels for textures that are not loaded from a file
+    GLsizei levels = 1;
     GLenum internal_format = GL_RGBA8;
     bool flip = true;
 };
@@ -47,6 +62,7 @@ public:
     void init(TextureInfo& info);
     void sub_image(TextureSubimageInfo& info);
     void bind(GLuint texture_unit);
+    void bind_image(GLuint image_unit, GLint level, GLenum access, GLenum format);
 
     [[nodiscard]] GLuint64 get_bindless_texture_id();
     [[nodiscard]] bool is_bindless_texture_mapped();
@@ -66,8 +82,9 @@ private:
     bool m_bindless_texture_mapped = false;
 
     void generate_mipmap();
-    void texture_storage(TextureSize& size, GLenum internal_format);
+    void texture_storage(TextureSize& size, GLenum internal_format, GLsizei levels);
     void from_file(const char* file, bool flip);
+    void from_image(const Image& image, const char* file);
 };
 
 } // namespace Renderer
@@ -0,0 +1,128 @@
+#include "tiled_lighting.hpp"
+
+#include "gl_state.hpp"
+
+namespace Renderer {
+
+namespace {
+    GLuint get_group_count(i32 size)
+    {
+        return static_cast<GLuint>((size + TiledLighting::TILE_SIZE - 1) / TiledLighting::TILE_SIZE);
+    }
+} // anonymous namespace
+
+TiledLighting::~TiledLighting()
+{
+    initialized = false;
+}
+
+void TiledLighting::init()
+{
+    util_assert(initialized == false, "TiledLighting::init() has already been initialized");
+
+    m_point_buffer.init();
+    m_spot_buffer.init();
+    m_directional_buffer.init();
+
+    initialized = true;
+}
+
+void TiledLighting::clear_lights()
+{
+    util_assert(initialized == true, "TiledLighting has not been initialized");
+    m_point_lights.clear();
+    m_spot_lights.clear();
+    m_directional_lights.clear();
+}
+
+void TiledLighting::add_light(const Light::Pbr::Point& light)
+{
+    util_assert(initialized == true, "TiledLighting has not been initialized");
+    m_point_lights.emplace_back(GpuPointLight {
+        .position_radius = glm::vec4(light.position, get_light_radius(light.color)),
+        .color = glm::vec4(light.color, 0.0F),
+    });
+}
+
+void TiledLighting::add_light(const Light::Pbr::Spot& light)
+{
+    util_assert(initialized == true, "TiledLighting has not been initialized");
+    m_spot_lights.emplace_back(GpuSpotLight {
+        .position_radius = glm::vec4(light.position, get_light_radius(light.color)),
+        .direction_inner_cutoff = glm::vec4(light.direction, light.inner_cutoff),
+        .color_outer_cutoff = glm::vec4(light.color, light.outer_cutoff),
+    });
+}
+
+void TiledLighting::add_light(const Light::Pbr::Directional& light)
+{
+    util_assert(initialized == true, "TiledLighting has not been initialized");
+    m_directional_lights.emplace_back(GpuDirectionalLight {
+        .direction = glm::vec4(light.direction, 0.0F),
+        .color = glm::vec4(light.color, 0.0F),
+    });
+}
+
+template <typename T>
+void TiledLighting::upload(Buffer& buffer, usize& capacity, std::vector<T>& uploaded, const std::vector<T>& lights)
+{
+    if (capacity != 0 && lights == uploaded) {
+        return;
+    }
+
+    // Never leave a buffer empty, the shader reads the counts instead
+    const usize count = std::max<usize>(lights.size(), 1);
+    if (count > capacity) {
+        capacity = std::bit_ceil(count);
+        buffer.buffer_data(static_cast<GLsizeiptr>(capacity * sizeof(T)), nullptr, GL_DYNAMIC_DRAW);
+    }
+    if (!lights.empty()) {
+        buffer.buffer_sub_data(0, static_cast<GLsizeiptr>(lights.size() * sizeof(T)), lights.data());
+    }
+    uploaded = lights;
+}
+
+void TiledLighting::dispatch(ShaderProgram& shader, Texture& output, glm::ivec2 size, const glm::mat4& view, const glm::mat4& proj)
+{
+    util_assert(initialized == true, "TiledLighting has not been initialized");
+
+    upload(m_point_buffer, m_point_capacity, m_uploaded_point_lights, m_point_lights);
+    upload(m_spot_buffer, m_spot_capacity, m_uploaded_spot_lights, m_spot_lights);
+    upload(m_directional_buffer, m_directional_capacity, m_uploaded_directional_lights, m_directional_lights);
+
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, POINT_LIGHTS_BINDING, m_point_buffer.get_id());
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, SPOT_LIGHTS_BINDING, m_spot_buffer.get_id());
+    GlState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, DIRECTIONAL_LIGHTS_BINDING, m_directional_buffer.get_id());
+
+    shader.bind();
+    shader.set_mat4("view", view);
+    shader.set_mat4("inv_proj", glm::inverse(proj));
+    shader.set_mat4("inv_view", glm::inverse(view));
+    shader.set_vec3("view_position", glm::vec3(glm::inverse(view)[3]));
+    shader.set_ivec2("screen_size", size);
+    shader.set_int("point_light_count", static_cast<i32>(m_point_lights.size()));
+    shader.set_int("spot_light_count", static_cast<i32>(m_spot_lights.size()));
+    shader.set_int("directional_light_count", static_cast<i32>(m_directional_lights.size()));
+
+    output.bind_image(0, 0, GL_WRITE_ONLY, GL_RGBA8);
+    glDispatchCompute(get_group_count(size.x), get_group_count(size.y), 1);
+}
+
+[[nodiscard]] usize TiledLighting::get_light_count() const
+{
+    util_assert(initialized == true, "TiledLighting has not been initialized");
+    return m_point_lights.size() + m_spot_lights.size() + m_directional_lights.size();
+}
+
+[[nodiscard]] bool TiledLighting::is_initialized() const
+{
+    return initialized;
+}
+
+[[nodiscard]] f32 TiledLighting::get_light_radius(glm::vec3 color)
+{
+    const f32 intensity = std::max({ color.r, color.g, color.b });
+    return std::sqrt(std::max(intensity, 0.0F) / LIGHT_CUTOFF);
+}
+
+} // namespace Renderer
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "buffer.hpp"
+#include "shader.hpp"
+#include "texture.hpp"
+
+#include "light/pbr/directional.hpp"
+#include "light/pbr/point.hpp"
+#include "light/pbr/spot.hpp"
+
+namespace Renderer {
+
+// Light lists for the compute lighting pass. Every TILE_SIZE x TILE_SIZE tile culls the point and
+// spot lights against its own depth bounds and only shades what survived, the lights live in
+// storage buffers so the light count never changes the shader
+class TiledLighting : public NoCopyNoMove {
+public:
+    TiledLighting() = default;
+    ~TiledLighting();
+
+    void init();
+
+    void clear_lights();
+    void add_light(const Light::Pbr::Point& light);
+    void add_light(const Light::Pbr::Spot& light);
+    void add_light(const Light::Pbr::Directional& light);
+
+    // Shades the gbuffer into output, which has to be an rgba8 texture of the gbuffer's size. The
+    // gbuffer uniforms are set by the caller and the render graph issues the barrier for output
+    void dispatch(ShaderProgram& shader, Texture& output, glm::ivec2 size, const glm::mat4& view, const glm::mat4& proj);
+
+    [[nodiscard]] usize get_light_count() const;
+    [[nodiscard]] bool is_initialized() const;
+
+    // Distance where the inverse square falloff drops below LIGHT_CUTOFF
+    [[nodiscard]] static f32 get_light_radius(glm::vec3 color);
+
+    static constexpr i32 TILE_SIZE = 16;
+    static constexpr u32 MAX_LIGHTS_PER_TILE = 256;
+    static constexpr f32 LIGHT_CUTOFF = 0.01F;
+
+    static constexpr GLuint POINT_LIGHTS_BINDING = 11;
+    static constexpr GLuint SPOT_LIGHTS_BINDING = 12;
+    static constexpr GLuint DIRECTIONAL_LIGHTS_BINDING = 13;
+
+private:
+    // std430 layouts, matching the structs in the tiled lighting shader
+    struct GpuPointLight {
+        glm::vec4 position_radius;
+        glm::vec4 color;
+
+        bool operator==(const GpuPointLight& other) const = default;
+    };
+
+    struct GpuSpotLight {
+        glm::vec4 position_radius;
+        glm::vec4 direction_inner_cutoff;
+        glm::vec4 color_outer_cutoff;
+
+        bool operator==(const GpuSpotLight& other) const = default;
+    };
+
+    struct GpuDirectionalLight {
+        glm::vec4 direction;
+        glm::vec4 color;
+
+        bool operator==(const GpuDirectionalLight& other) const = default;
+    };
+
+    template <typename T>
+    static void upload(Buffer& buffer, usize& capacity, std::vector<T>& uploaded, const std::vector<T>& lights);
+
+    bool initialized = false;
+
+    std::vector<GpuPointLight> m_point_lights;
+    std::vector<GpuSpotLight> m_spot_lights;
+    std::vector<GpuDirectionalLight> m_directional_lights;
+
+    // What the buffers hold, the lists are rebuilt every frame but only re-uploaded when they differ
+    std::vector<GpuPointLight> m_uploaded_point_lights;
+    std::vector<GpuSpotLight> m_uploaded_spot_lights;
+    std::vector<GpuDirectionalLight> m_uploaded_directional_lights;
+
+    Renderer::Buffer m_point_buffer;
+    Renderer::Buffer m_spot_buffer;
+    Renderer::Buffer m_directional_buffer;
+    usize m_point_capacity = 0;
+    usize m_spot_capacity = 0;
+    usize m_directional_capacity = 0;
+};
+
+} // namespace Renderer
@@ -1,5 +1,7 @@
 #include "vertex.hpp"
 
+#include "gl_state.hpp"
+
 namespace Renderer {
 
 void VertexArray::init()
@@ -7,7 +9,7 @@ void VertexArray::init()
     util_assert(initialized == false, "VertexArray::init() has already been initialized");
 
     glCreateVertexArrays(1, &m_id);
-    glBindVertexArray(m_id);
+    GlState::bind_vertex_array(m_id);
 
     initialized = true;
 }
@@ -17,6 +19,7 @@ VertexArray::~VertexArray()
     // util_assert(initialized == true, "VertexArray::~VertexArray() has not been initialized");
     if (initialized) {
         glDeleteVertexArrays(1, &m_id);
+        GlState::forget_vertex_array(m_id);
         initialized = false;
     }
 }
@@ -56,7 +59,7 @@ void VertexArray::binding_devisor(GLuint binding_index, GLuint divisor)
 void VertexArray::bind() const
 {
     util_assert(initialized == true, "VertexArray has not been initialized");
-    glBindVertexArray(m_id);
+    GlState::bind_vertex_array(m_id);
 }
 
 [[nodiscard]] GLuint VertexArray::get_id() const
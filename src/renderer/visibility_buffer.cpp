@@ -0,0 +1,62 @@
+#include "visibility_buffer.hpp"
+
+#include "extensions.hpp"
+
+namespace Renderer {
+
+void VisibilityBuffer::declare(RenderGraph& graph, i32 width, i32 height)
+{
+    m_buffer_width = width;
+    m_buffer_height = height;
+
+    RenderGraph::TextureDesc desc { .width = width, .height = height, .internal_format = GL_R32UI };
+    m_ids = graph.create_texture("visibility_ids", desc);
+
+    desc.internal_format = GL_DEPTH_COMPONENT32F;
+    m_depth = graph.create_texture("visibility_depth", desc);
+}
+
+void VisibilityBuffer::write(RenderGraph::Builder& builder) const
+{
+    util_assert(m_ids != RenderGraph::INVALID_RESOURCE, "VisibilityBuffer has not been declared");
+
+    builder.write(m_ids, RenderGraph::Access::ColorAttachment);
+    builder.write(m_depth, RenderGraph::Access::DepthAttachment);
+}
+
+void VisibilityBuffer::read(RenderGraph::Builder& builder) const
+{
+    util_assert(m_ids != RenderGraph::INVALID_RESOURCE, "VisibilityBuffer has not been declared");
+
+    builder.read(m_ids, RenderGraph::Access::Sampled);
+}
+
+void VisibilityBuffer::clear()
+{
+    // glClear would convert the clear color to float, the integer target needs its own clear
+    constexpr std::array<GLuint, 4> clear_ids = { INVALID_ID, 0, 0, 0 };
+    constexpr GLfloat clear_depth = 1.0F;
+    glClearBufferuiv(GL_COLOR, 0, clear_ids.data());
+    glClearBufferfv(GL_DEPTH, 0, &clear_depth);
+}
+
+void VisibilityBuffer::set_uniforms(RenderGraph& graph, Renderer::ShaderProgram& shader) const
+{
+    util_assert(m_ids != RenderGraph::INVALID_RESOURCE, "VisibilityBuffer has not been declared");
+
+    GLuint texture_unit = Texture::get_texture_unit();
+    graph.get_texture(m_ids).bind(texture_unit);
+    shader.set_int("visibility", static_cast<i32>(texture_unit));
+}
+
+[[nodiscard]] usize VisibilityBuffer::get_size_bytes() const
+{
+    return static_cast<usize>(m_buffer_width) * static_cast<usize>(m_buffer_height) * BYTES_PER_PIXEL;
+}
+
+[[nodiscard]] bool VisibilityBuffer::is_supported()
+{
+    return Renderer::Extensions::is_extension_supported("GL_ARB_bindless_texture");
+}
+
+} // namespace Renderer
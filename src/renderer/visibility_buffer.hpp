@@ -0,0 +1,57 @@
+#pragma once
+
+#include "render_graph.hpp"
+#include "shader.hpp"
+
+namespace Renderer {
+
+// One 32 bit (draw id, triangle id) per pixel. The material pass fetches the triangle from the
+// mesh buffers and interpolates its attributes, so every pixel is shaded exactly once. The ids
+// and depth are render graph transients like the gbuffer
+class VisibilityBuffer : public NoCopyNoMove {
+public:
+    VisibilityBuffer() = default;
+    ~VisibilityBuffer() = default;
+
+    // Creates this frame's transients, call after RenderGraph::begin_frame()
+    void declare(RenderGraph& graph, i32 width, i32 height);
+
+    // Id and depth attachments of the geometry pass
+    void write(RenderGraph::Builder& builder) const;
+    // The material pass only reads the ids
+    void read(RenderGraph::Builder& builder) const;
+
+    // Clears the ids to INVALID_ID and the depth to 1, call after RenderGraph::bind_attachments()
+    static void clear();
+    void set_uniforms(RenderGraph& graph, Renderer::ShaderProgram& shader) const;
+
+    [[nodiscard]] usize get_size_bytes() const;
+
+    // Vertex pulling and bindless material textures
+    [[nodiscard]] static bool is_supported();
+
+    // draw id = draw offset of the mesh + instance * command count + command
+    static constexpr u32 TRIANGLE_ID_BITS = 18;
+    static constexpr u32 DRAW_ID_BITS = 32 - TRIANGLE_ID_BITS;
+    static constexpr u32 INVALID_ID = 0xFFFFFFFF;
+    // The all ones draw id is reserved for INVALID_ID
+    static constexpr u32 MAX_DRAWS = (1U << DRAW_ID_BITS) - 1;
+    static constexpr u32 MAX_TRIANGLES = 1U << TRIANGLE_ID_BITS;
+
+    // Id and depth
+    static constexpr u32 BYTES_PER_PIXEL = 4 + 4;
+
+    // Shader storage bindings of the material pass, 1-4 are the models and textures like every other pass
+    static constexpr GLuint VERTICES_BINDING = 14;
+    static constexpr GLuint INDICES_BINDING = 15;
+    static constexpr GLuint COMMANDS_BINDING = 16;
+
+private:
+    RenderGraph::Resource m_ids = RenderGraph::INVALID_RESOURCE;
+    RenderGraph::Resource m_depth = RenderGraph::INVALID_RESOURCE;
+
+    i32 m_buffer_width {};
+    i32 m_buffer_height {};
+};
+
+} // namespace Renderer
@@ -1,6 +1,9 @@
 #include "window.hpp"
 #include "SDL3/SDL_video.h"
 
+#include "counters.hpp"
+#include "gpu_profiler.hpp"
+
 namespace Renderer {
 
 namespace {
@@ -29,6 +32,19 @@ Window::Window(const char* name, int width, int height)
 }
 
 void Window::init(const char* name, int width, int height)
+{
+    init_internal(name, width, height, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
+}
+
+void Window::init_headless(int width, int height)
+{
+    SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+    init_internal("headless", width, height, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    // Nothing is presented, vsync would only throttle the frames
+    SDL_GL_SetSwapInterval(0);
+}
+
+void Window::init_internal(const char* name, int width, int height, SDL_WindowFlags flags)
 {
     util_assert(initialized == false, "Window::init() attempting to reinit SDL3 window");
 
@@ -39,29 +55,37 @@ void Window::init(const char* name, int width, int height)
         util_error(std::format("Could not initialize SDL: {}", SDL_GetError()));
     }
 
+    // Every shader is #version 460, so there is no lower version to fall back to. Multisampling is
+    // only dropped, software and offscreen drivers often have no multisampled config
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, 0);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 6);
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 4);
     SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
     // SDL_GL_SetAttribute(SDL_GL_FLOATBUFFERS, 1);
 
-    m_window = SDL_CreateWindow(name,
-        width, height,
-        SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
+    for (const i32 samples : { 4, 0 }) {
+        SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, samples > 0 ? 1 : 0);
+        SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, samples);
 
-    if (m_window == nullptr) {
-        SDL_Quit();
-        util_error(std::format("Could not create window: {}", SDL_GetError()));
+        m_window = SDL_CreateWindow(name, width, height, flags);
+        if (m_window == nullptr) {
+            LOG_WARN(std::format("Could not create window with {}x MSAA: {}", samples, SDL_GetError()));
+            continue;
+        }
+
+        m_context = SDL_GL_CreateContext(m_window);
+        if (m_context != nullptr) {
+            break;
+        }
+        LOG_WARN(std::format("Could not create OpenGL 4.6 core context with {}x MSAA: {}", samples, SDL_GetError()));
+        SDL_DestroyWindow(m_window);
+        m_window = nullptr;
     }
 
-    m_context = SDL_GL_CreateContext(m_window);
     if (m_context == nullptr) {
-        SDL_DestroyWindow(m_window);
         SDL_Quit();
-        util_error(std::format("Could not create OpenGL context: {}", SDL_GetError()));
+        util_error("Could not create an OpenGL 4.6 core context, the renderer needs one even headless");
     }
 
     if (gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress) == 0) {
@@ -99,6 +123,7 @@ Window::~Window()
     // util_assert(initialized == true, "Attempting to call destructor with uninitialized data");
     if (initialized) {
         if (m_window != nullptr) {
+            GpuProfiler::shutdown();
             ImGui_ImplOpenGL3_Shutdown();
             ImGui_ImplSDL3_Shutdown();
             ImGui::DestroyContext();
@@ -146,6 +171,9 @@ void Window::loop(const std::function<void()>& commands)
             break;
         }
 
+        GpuProfiler::begin_frame();
+        Counters::begin_frame();
+
         // (After event loop)
         // Start the Dear ImGui frame
         ImGui_ImplOpenGL3_NewFrame();
@@ -154,13 +182,23 @@ void Window::loop(const std::function<void()>& commands)
 
         commands();
 
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        {
+            GpuProfiler::Scope scope("imgui");
+            ImGui::Render();
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
+        GpuProfiler::end_frame();
 
         SDL_GL_SwapWindow(m_window);
     }
 }
 
+void Window::swap_buffers()
+{
+    util_assert(initialized == true, "Renderer::Window has not been initialized");
+    SDL_GL_SwapWindow(m_window);
+}
+
 // void Window::windowMouseCallback(UNUSED GLFWwindow* _window, double x, double y)
 // {
 //     if (currentWindowPtr != nullptr && currentWindowPtr->mouseCallbackFn != nullptr) {
@@ -9,9 +9,13 @@ public:
     ~Window();
 
     void init(const char* name, int width, int height);
+    // Hidden window on SDL's offscreen driver (EGL), works without a display or GPU (llvmpipe)
+    void init_headless(int width, int height);
 
     void process_input_callback(const std::function<void(SDL_Event& event)>& commands);
     void loop(const std::function<void()>& commands);
+    // For callers that run their own loop instead of loop()
+    void swap_buffers();
 
     void set_capture_mouse(bool value);
     void set_relative_mode(bool value);
@@ -27,6 +31,8 @@ public:
     void set_window_title(const char* title);
 
 private:
+    void init_internal(const char* name, int width, int height, SDL_WindowFlags flags);
+
     bool initialized = false;
 
     int m_width {};
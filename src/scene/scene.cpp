@@ -3,12 +3,28 @@
 
 #include "scene_shaders.hpp"
 
-Scene::Scene(Renderer::Window& window, Renderer::Camera& camera)
+Scene::Scene(Renderer::Window& window, Renderer::Camera& camera, const Physics::SystemSettings& physics_settings)
     : m_window(window)
     , m_camera(camera)
     , m_camera_speed(m_camera.get_speed())
 {
-    m_physics_system = std::make_unique<Physics::System>();
+    m_physics_system = std::make_unique<Physics::System>(physics_settings);
+    m_simulation.init(*m_physics_system);
+    m_queries.init(*m_physics_system);
+
+    m_layered_point_shadows = Renderer::ShadowMap::supports_layered_cubemap();
+    m_point_shadow_timer.init();
+    m_shadow_atlas.init();
+    m_render_graph.init();
+    m_presenter.init();
+    m_render_queue.init();
+
+    m_culling_timer.init();
+    m_culling_late_timer.init();
+    if (Renderer::GpuCulling::is_supported()) {
+        m_culling.init();
+        m_hi_z.init(m_window.get_width(), m_window.get_height());
+    }
 
     init_pass();
     update();
@@ -16,17 +32,20 @@ Scene::Scene(Renderer::Window& window, Renderer::Camera& camera)
 
 Scene::~Scene()
 {
-    if (m_forward_pass) {
-        delete m_forward;
-    } else {
-        delete m_deferred;
-    }
+    m_simulation.stop();
+
+    delete m_forward;
+    delete m_deferred;
+    delete m_visibility;
 
     auto view = m_registry.view<JPH::BodyID>();
+    std::vector<JPH::BodyID> bodies;
+    bodies.reserve(view.size());
     for (auto [entity, body] : view.each()) {
-        m_physics_system->m_body_interface->RemoveBody(body);
-        m_physics_system->m_body_interface->DestroyBody(body);
+        bodies.emplace_back(body);
     }
+    m_physics_system->m_body_interface->RemoveBodies(bodies.data(), static_cast<int>(bodies.size()));
+    m_physics_system->m_body_interface->DestroyBodies(bodies.data(), static_cast<int>(bodies.size()));
 }
 
 void Scene::add_entity(const EntityBuilder& entity_builder)
@@ -41,10 +60,18 @@ void Scene::add_entity(const EntityBuilder& entity_builder)
         m_registry.emplace<Renderer::Model*>(entity, &model);
         // TODO: Decide if I want physics objects without models someday
         if (entity_builder.m_create_body != nullptr) {
+            auto lock = m_simulation.lock();
             auto physics_info
                 = entity_builder.m_create_body(m_physics_system.get(), m_registry.get<Renderer::Model*>(entity));
             m_registry.emplace<JPH::BodyID>(entity, physics_info.first);
+            m_physics_system->m_body_interface->SetUserData(physics_info.first, Physics::entity_to_user_data(entity));
             m_registry.emplace<JPH::EMotionType>(entity, physics_info.second);
+            if (physics_info.second != JPH::EMotionType::Static) {
+                const auto handle = m_simulation.add_body(physics_info.first);
+                m_registry.emplace<Physics::Simulation::Handle>(entity, handle);
+                m_body_entities.resize(handle.index + 1, entt::null);
+                m_body_entities[handle.index] = entity;
+            }
             m_physics_needs_optimize = true;
         }
         m_models_instance_draw_cache_needs_update = true;
@@ -76,16 +103,69 @@ void Scene::add_entity(const EntityBuilder& entity_builder)
     }
 
     m_registry.emplace<glm::mat4>(entity, entity_builder.m_model_matrix);
+
+    if (m_registry.all_of<Physics::Simulation::Handle>(entity)
+        && m_registry.any_of<Renderer::Light::Pbr::Point, Renderer::Light::Pbr::Spot>(entity)) {
+        m_registry.emplace<TransformFollower>(entity, entity);
+    }
+}
+
+void Scene::spawn_bodies(const EntityBuilder& entity_builder, std::span<const JPH::BodyCreationSettings> bodies, JPH::EActivation activation)
+{
+    PROFILE_SCOPE("Scene::spawn_bodies");
+    util_assert(entity_builder.m_model_path != nullptr, "Scene::spawn_bodies() needs a model");
+    util_assert(entity_builder.m_create_body == nullptr, "Scene::spawn_bodies() creates the bodies itself");
+
+    Renderer::Model& model = m_model_cache.get_or_create(entity_builder.m_model_path, entity_builder.m_model_path);
+
+    auto lock = m_simulation.lock();
+    m_spawned_bodies.clear();
+    m_physics_system->add_bodies(bodies, activation, m_spawned_bodies);
+
+    // Moving bodies join the simulation together once their entities exist
+    m_moving_spawned_bodies.clear();
+    const usize first_entity = m_body_entities.size();
+    for (usize i = 0; i < m_spawned_bodies.size(); i++) {
+        const JPH::BodyID body = m_spawned_bodies[i];
+        const JPH::EMotionType motion_type = bodies[i].mMotionType;
+
+        auto entity = m_registry.create();
+        if (entity_builder.m_name != nullptr) {
+            m_registry.emplace<const char*>(entity, entity_builder.m_name);
+        }
+        m_registry.emplace<Renderer::Model*>(entity, &model);
+        m_registry.emplace<JPH::BodyID>(entity, body);
+        m_physics_system->m_body_interface->SetUserData(body, Physics::entity_to_user_data(entity));
+        m_registry.emplace<JPH::EMotionType>(entity, motion_type);
+        m_registry.emplace<glm::mat4>(entity, entity_builder.m_model_matrix);
+        if (motion_type != JPH::EMotionType::Static) {
+            m_moving_spawned_bodies.emplace_back(body);
+            m_body_entities.emplace_back(entity);
+        }
+    }
+
+    const auto first = m_simulation.add_bodies(m_moving_spawned_bodies);
+    util_assert(first.index == first_entity, "Scene and Simulation disagree on the body handles");
+    for (usize i = first_entity; i < m_body_entities.size(); i++) {
+        m_registry.emplace<Physics::Simulation::Handle>(m_body_entities[i], Physics::Simulation::Handle { .index = static_cast<u32>(i) });
+    }
+
+    m_physics_needs_optimize = true;
+    m_models_instance_draw_cache_needs_update = true;
 }
 
 void Scene::optimize()
 {
+    PROFILE_SCOPE("Scene::optimize");
+    auto lock = m_simulation.lock();
     m_physics_system->optimize();
     m_physics_needs_optimize = false;
 }
 
 void Scene::update()
 {
+    PROFILE_SCOPE("Scene::update");
+
     m_clock.update();
 
     if (m_models_instance_draw_cache_needs_update) {
@@ -103,6 +183,9 @@ void Scene::update()
         end_model_matrix_label:
         }
 
+        // New casters invalidate every cached shadow
+        mark_shadows_dirty();
+
         LOG_INFO("Updated scene instanced draw cache");
         m_models_instance_draw_cache_needs_update = false;
     } else {
@@ -120,39 +203,122 @@ void Scene::update()
         }
     }
 
-    if (m_deferred != nullptr) {
-        if (m_window.get_width() != m_deferred->m_gpass_width || m_window.get_height() != m_deferred->m_gpass_height) {
-            m_deferred->m_gpass_width = m_window.get_width();
-            m_deferred->m_gpass_height = m_window.get_height();
-            m_deferred->m_gpass.reinit(m_deferred->m_gpass_width, m_deferred->m_gpass_height);
+    // physics() refills the bounds while it runs, paused bodies stop invalidating shadows after two frames
+    if (!m_physics_ran) {
+        std::swap(m_moving_bounds, m_previous_moving_bounds);
+        m_moving_bounds.clear();
+    }
+    m_physics_ran = false;
+
+    // Render targets are render graph transients and follow the window size on their own, only the
+    // HiZ pyramid is kept across frames
+    if (m_hi_z.is_initialized()) {
+        if (m_window.get_width() != m_hi_z.get_width() || m_window.get_height() != m_hi_z.get_height()) {
+            m_hi_z.reinit(m_window.get_width(), m_window.get_height());
         }
     }
     compile_shaders();
 }
 
+void Scene::set_physics_running(bool running)
+{
+    m_simulation.set_running(running);
+}
+
 void Scene::physics()
 {
-    m_physics_system->update(m_clock.delta_time());
+    PROFILE_SCOPE("Scene::physics");
 
-    auto view = m_registry.view<glm::mat4, JPH::BodyID, JPH::EMotionType>();
+    // Stepping happens on the simulation thread, this only picks up where the bodies are now
+    m_simulation.interpolate(Utils::Profiler::now_ns(), m_body_transforms);
+    apply_body_transforms();
+}
 
-    for (auto [entity, model, body, motion] : view.each()) {
-        if (motion != JPH::EMotionType::Static) {
-            model = mat4_to_mat4(m_physics_system->m_body_interface->GetCenterOfMassTransform(body));
+void Scene::step_physics(f32 delta_time)
+{
+    PROFILE_SCOPE("Scene::step_physics");
+
+    // Steps until the simulation is at most one step ahead, same as the thread keeps it for physics()
+    m_physics_time_ns += static_cast<i64>(static_cast<f64>(delta_time) * 1'000'000'000.0);
+    const i64 step_ns = 1'000'000'000 / static_cast<i64>(m_simulation.get_steps_per_second());
+    const i64 behind_ns = m_physics_time_ns - m_simulation.get_time_ns();
+    if (behind_ns > 0) {
+        m_simulation.step(static_cast<u32>((behind_ns + step_ns - 1) / step_ns));
+    }
 
-            auto* point_light = m_registry.try_get<Renderer::Light::Pbr::Point>(entity);
-            if (point_light != nullptr) {
-                point_light->position = model[3];
-            }
+    m_simulation.interpolate(m_physics_time_ns, m_body_transforms);
+    apply_body_transforms();
+}
 
-            auto* spot_light = m_registry.try_get<Renderer::Light::Pbr::Spot>(entity);
-            if (spot_light != nullptr) {
-                spot_light->position = model[3];
-            }
-        }
+void Scene::apply_body_transforms()
+{
+    m_physics_ran = true;
+
+    // Only bodies that moved come back, sleeping ones keep the transform they already have
+    std::swap(m_moving_bounds, m_previous_moving_bounds);
+    m_moving_bounds.clear();
+    for (const auto& body : m_body_transforms) {
+        const entt::entity entity = m_body_entities[body.handle.index];
+        auto& model = m_registry.get<glm::mat4>(entity);
+        model = body.transform;
+
+        // Bodies are only created together with a model
+        m_moving_bounds.emplace_back(m_registry.get<Renderer::Model*>(entity)->get_bounds().transform(model));
+    }
+
+    for (auto [entity, light, follower] : m_registry.view<Renderer::Light::Pbr::Point, TransformFollower>().each()) {
+        light.position = m_registry.get<glm::mat4>(follower.target)[3];
+    }
+    for (auto [entity, light, follower] : m_registry.view<Renderer::Light::Pbr::Spot, TransformFollower>().each()) {
+        light.position = m_registry.get<glm::mat4>(follower.target)[3];
     }
 }
 
+[[nodiscard]] const Physics::System& Scene::get_physics_system() const
+{
+    return *m_physics_system;
+}
+
+void Scene::cast_rays(std::span<const Physics::RayCast> rays, std::span<Physics::QueryHit> hits)
+{
+    auto lock = m_simulation.lock();
+    m_queries.cast_rays(rays, hits);
+}
+
+void Scene::overlap_spheres(std::span<const Physics::SphereOverlap> spheres, Physics::OverlapResults& results)
+{
+    auto lock = m_simulation.lock();
+    m_queries.overlap_spheres(spheres, results);
+}
+
+void Scene::cast_shapes(std::span<const Physics::ShapeCast> casts, std::span<Physics::QueryHit> hits)
+{
+    auto lock = m_simulation.lock();
+    m_queries.cast_shapes(casts, hits);
+}
+
+entt::entity Scene::pick(glm::vec2 position)
+{
+    PROFILE_SCOPE("Scene::pick");
+
+    // Window coordinates have y pointing down, from the near to the far plane through the point
+    const glm::vec2 ndc(
+        position.x / static_cast<f32>(m_window.get_width()) * 2.0F - 1.0F,
+        1.0F - position.y / static_cast<f32>(m_window.get_height()) * 2.0F);
+    const glm::mat4 inverse_proj_view = m_camera.get_inverse_proj_view();
+    glm::vec4 near = inverse_proj_view * glm::vec4(ndc, -1.0F, 1.0F);
+    glm::vec4 far = inverse_proj_view * glm::vec4(ndc, 1.0F, 1.0F);
+    near /= near.w;
+    far /= far.w;
+
+    const Physics::RayCast ray { .origin = glm::vec3(near), .direction = glm::vec3(far - near) };
+    Physics::QueryHit hit;
+    cast_rays({ &ray, 1 }, { &hit, 1 });
+
+    m_selected_entity = hit.entity;
+    return m_selected_entity;
+}
+
 void Scene::instance_draw_internal(Renderer::ShaderProgram& shader, bool shadowmap)
 {
     for (auto& model : m_models_instance_draw_cache) {
@@ -164,115 +330,689 @@ void Scene::instance_draw_internal(Renderer::ShaderProgram& shader, bool shadowm
     }
 }
 
-void Scene::draw()
+void Scene::instance_draw_internal(Renderer::ShaderProgram& shader, Renderer::AlphaMode alpha_mode)
 {
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
+    for (const auto& item : m_render_queue.get_items(MAIN_QUEUE_PASS, alpha_mode)) {
+        auto& model = m_models_instance_draw_cache[item.index];
+        model.model->draw(shader, model.model_matrices, alpha_mode);
+    }
+}
 
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
+void Scene::build_render_queue()
+{
+    PROFILE_SCOPE("Scene::build_render_queue");
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    // glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
+    // The program that shades each alpha mode in the color pass, depth only passes follow the same order
+    std::array<u32, 3> programs {};
+    if (m_forward != nullptr) {
+        const GLuint masked = m_depth_prepass ? m_forward->m_shader.get_id() : m_forward->m_shader_masked.get_id();
+        programs = { m_forward->m_shader.get_id(), masked, m_forward->m_shader.get_id() };
+    } else if (m_deferred != nullptr) {
+        programs = { m_deferred->m_gpass_shader.get_id(), m_deferred->m_gpass_shader_masked.get_id(), m_deferred->m_gpass_shader_masked.get_id() };
+    }
 
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    const Renderer::Frustum frustum(m_camera.get_proj() * m_camera.get_view());
+    const glm::vec3 camera_position = m_camera.get_pos();
+    const f32 far = m_camera.get_far();
+
+    // Runs on the job system, only reads the draw cache
+    m_render_queue.build(static_cast<u32>(m_models_instance_draw_cache.size()), [&](u32 index, std::vector<Renderer::RenderQueue::Item>& items) {
+        const auto& entry = m_models_instance_draw_cache[index];
+        const auto& bounds = entry.model->get_bounds();
+
+        bool visible = false;
+        f32 nearest = std::numeric_limits<f32>::max();
+        f32 farthest = 0.0F;
+        for (const auto& matrix : entry.model_matrices) {
+            const Renderer::AABB world_bounds = bounds.transform(matrix);
+            if (!world_bounds.is_on_frustum(frustum)) {
+                continue;
+            }
+            visible = true;
+            const f32 distance = glm::distance(world_bounds.center, camera_position);
+            nearest = std::min(nearest, distance);
+            farthest = std::max(farthest, distance);
+        }
+        if (!visible) {
+            return;
+        }
 
-    m_camera.update();
+        for (auto alpha_mode : { Renderer::AlphaMode::Opaque, Renderer::AlphaMode::Mask, Renderer::AlphaMode::Blend }) {
+            if (!entry.model->has_alpha_mode(alpha_mode)) {
+                continue;
+            }
+            // Instances share one draw, blended ones sort by the farthest and the rest by the nearest
+            const f32 distance = alpha_mode == Renderer::AlphaMode::Blend ? farthest : nearest;
+            // The bindless texture tables belong to the mesh, so the mesh field covers the material too
+            const u64 key = Renderer::RenderQueue::make_key({
+                .pass = MAIN_QUEUE_PASS,
+                .alpha_mode = alpha_mode,
+                .program = programs[static_cast<usize>(alpha_mode)],
+                .material = 0,
+                .mesh = index,
+                .depth = distance / far,
+            });
+            items.emplace_back(Renderer::RenderQueue::Item { .key = key, .index = index });
+        }
+    });
+}
+
+void Scene::instance_cull_internal(u32 phase)
+{
+    for (auto& model : m_models_instance_draw_cache) {
+        if (!model.model_matrices.empty()) {
+            model.model->cull(m_culling, model.model_matrices, phase);
+        }
+    }
+}
+
+void Scene::instance_draw_culled_internal(Renderer::ShaderProgram& shader, Renderer::AlphaMode alpha_mode, u32 phase)
+{
+    // Same order as the unculled path, so blended models still go back to front. Models the queue
+    // frustum culled would not pass the GPU's frustum test either
+    for (const auto& item : m_render_queue.get_items(MAIN_QUEUE_PASS, alpha_mode)) {
+        m_models_instance_draw_cache[item.index].model->draw_culled(shader, alpha_mode, phase);
+    }
+}
+
+void Scene::set_forward_uniforms(Renderer::ShaderProgram& shader)
+{
+    shader.bind();
+    shader.set_mat4("proj", m_camera.get_proj());
+    shader.set_mat4("view", m_camera.get_view());
+    shader.set_vec3("view_position", m_camera.get_pos());
+
+    auto pbr_point_view = m_registry.view<Renderer::Light::Pbr::Point>();
+    auto pbr_directional_view = m_registry.view<Renderer::Light::Pbr::Directional>();
+    auto pbr_spot_view = m_registry.view<Renderer::Light::Pbr::Spot>();
+    u32 i = 0;
+    for (auto [entity, light] : pbr_directional_view.each()) {
+        light.set_uniforms(shader, std::format("u_directional_light_{}", i).c_str());
+        i++;
+    }
+    i = 0;
+    for (auto [entity, light] : pbr_point_view.each()) {
+        light.set_uniforms(shader, std::format("u_point_light_{}", i).c_str());
+        i++;
+    }
+    i = 0;
+    for (auto [entity, light] : pbr_spot_view.each()) {
+        light.set_uniforms(shader, std::format("u_spot_light_{}", i).c_str());
+        i++;
+    }
+}
+
+void Scene::instance_draw_layered_internal(u32 layer_count)
+{
+    for (auto& model : m_models_instance_draw_cache) {
+        model.model->draw_untextured_layered(model.model_matrices, layer_count);
+    }
+}
+
+void Scene::update_caster_bounds()
+{
+    m_caster_bounds.clear();
+    for (auto& model : m_models_instance_draw_cache) {
+        const Renderer::AABB& bounds = model.model->get_bounds();
+        for (const auto& model_matrix : model.model_matrices) {
+            m_caster_bounds.emplace_back(bounds.transform(model_matrix));
+        }
+    }
+}
+
+void Scene::update_shadow_resolutions()
+{
+    const auto get_importance = [](const glm::vec3& diffuse, const glm::vec3& specular) {
+        return std::max({ diffuse.r, diffuse.g, diffuse.b, specular.r, specular.g, specular.b });
+    };
 
     auto phong_directional_view = m_registry.view<Renderer::Light::Phong::Directional>();
     for (auto [entity, light] : phong_directional_view.each()) {
-        if (light.has_shadowmap()) {
-            light.shadowmap_draw(m_shadowmap_shader, [&]() {
-                instance_draw_internal(m_shadowmap_shader, true);
-            });
+        if (!light.has_shadowmap()) {
+            continue;
+        }
+
+        // A directional light covers the whole screen
+        const auto& info = light.get_info();
+        i32 resolution = Renderer::ShadowAtlas::get_resolution(1.0F, get_importance(info.diffuse, info.specular));
+
+        // Grow right away but only shrink after dropping two sizes so lights on the edge do not thrash
+        Renderer::ShadowAtlas::Tile& tile = light.get_shadow_tile();
+        if (tile.is_valid() && (resolution == tile.size || (resolution < tile.size && resolution * 2 >= tile.size))) {
+            continue;
+        }
+
+        m_shadow_atlas.free(tile);
+        Renderer::ShadowAtlas::Tile new_tile = m_shadow_atlas.allocate(resolution);
+        while (!new_tile.is_valid() && resolution > Renderer::ShadowAtlas::MIN_TILE_SIZE) {
+            resolution /= 2;
+            new_tile = m_shadow_atlas.allocate(resolution);
         }
+        util_assert(new_tile.is_valid(), "Shadow atlas is full");
+
+        light.set_shadow_tile(m_shadow_atlas, new_tile);
     }
 
     auto phong_point_view = m_registry.view<Renderer::Light::Phong::Point>();
     for (auto [entity, light] : phong_point_view.each()) {
-        if (light.has_shadowmap()) {
-            light.shadowmap_draw(m_shadowmap_cubemap_shader, [&]() {
-                instance_draw_internal(m_shadowmap_cubemap_shader, true);
-            });
+        if (!light.has_shadowmap()) {
+            continue;
+        }
+
+        // Radius of the light's range projected on screen, relative to half the screen height
+        const auto& info = light.get_info();
+        f32 distance = glm::length(info.position - m_camera.get_pos());
+        f32 coverage = 1.0F;
+        if (distance > info.far) {
+            coverage = info.far / (distance * std::tan(m_camera.get_fov() * 0.5F));
+        }
+
+        i32 resolution = Renderer::ShadowAtlas::get_resolution(coverage, get_importance(info.diffuse, info.specular));
+        i32 current = light.get_shadow_resolution();
+        if (resolution > current || resolution * 2 < current) {
+            light.set_shadow_resolution(resolution);
         }
     }
+}
 
-    if (m_forward_pass) {
-        glViewport(0, 0, m_window.get_width(), m_window.get_height());
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+void Scene::mark_shadows_dirty()
+{
+    for (auto [entity, light] : m_registry.view<Renderer::Light::Phong::Directional>().each()) {
+        light.mark_shadow_dirty();
+    }
+    for (auto [entity, light] : m_registry.view<Renderer::Light::Phong::Point>().each()) {
+        light.mark_shadow_dirty();
+    }
+}
 
-        m_forward->m_shader.bind();
-        m_forward->m_shader.set_mat4("proj", m_camera.get_proj());
-        m_forward->m_shader.set_mat4("view", m_camera.get_view());
-        m_forward->m_shader.set_vec3("view_position", m_camera.get_pos());
+template <typename Light>
+[[nodiscard]] bool Scene::shadow_needs_redraw(const Light& light) const
+{
+    if (!m_cache_shadows || light.is_shadow_dirty()) {
+        return true;
+    }
 
-        auto pbr_point_view = m_registry.view<Renderer::Light::Pbr::Point>();
-        auto pbr_directional_view = m_registry.view<Renderer::Light::Pbr::Directional>();
-        auto pbr_spot_view = m_registry.view<Renderer::Light::Pbr::Spot>();
-        u32 i = 0;
-        for (auto [entity, light] : pbr_directional_view.each()) {
-            light.set_uniforms(m_forward->m_shader, std::format("u_directional_light_{}", i).c_str());
-            i++;
-        }
-        i = 0;
-        for (auto [entity, light] : pbr_point_view.each()) {
-            light.set_uniforms(m_forward->m_shader, std::format("u_point_light_{}", i).c_str());
-            i++;
+    for (const auto& bounds : m_moving_bounds) {
+        if (light.is_in_shadow_volume(bounds)) {
+            return true;
         }
-        i = 0;
-        for (auto [entity, light] : pbr_spot_view.each()) {
-            light.set_uniforms(m_forward->m_shader, std::format("u_spot_light_{}", i).c_str());
-            i++;
+    }
+    for (const auto& bounds : m_previous_moving_bounds) {
+        if (light.is_in_shadow_volume(bounds)) {
+            return true;
         }
+    }
+    return false;
+}
+
+void Scene::draw()
+{
+    PROFILE_SCOPE("Scene::draw");
+
+    // Counters of the last frame are shown in the debug window
+    Renderer::GlState::begin_frame();
+
+    // Only reaches the driver when something changed it since the last frame
+    Renderer::GlState::enable(GL_DEPTH_TEST);
+    Renderer::GlState::depth_func(GL_LESS);
+
+    Renderer::GlState::enable(GL_CULL_FACE);
+    Renderer::GlState::cull_face(GL_BACK);
+
+    // Only the blended bucket of the forward pass enables blending
+    Renderer::GlState::disable(GL_BLEND);
+    Renderer::GlState::blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    // glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    m_camera.update();
 
-        instance_draw_internal(m_forward->m_shader, false);
+    update_shadow_resolutions();
+
+    m_render_graph.begin_frame();
+    auto& atlas_texture = m_shadow_atlas.get_texture();
+    const auto shadow_atlas = m_render_graph.import_texture("shadow_atlas",
+        atlas_texture,
+        { .width = m_shadow_atlas.get_size(), .height = m_shadow_atlas.get_size(), .internal_format = GL_DEPTH_COMPONENT24 });
+    const auto point_shadows = m_render_graph.import_external("point_shadow_maps");
+    // Kept alive by writing imported resources. No pbr shader samples the phong shadows yet, so the
+    // passes below do not read them
+    add_shadow_passes(shadow_atlas, point_shadows);
+
+    if (m_pass != Pass::Visibility) {
+        build_render_queue();
+    }
+
+    if (m_pass == Pass::Forward) {
+        add_forward_passes();
+    } else if (m_pass == Pass::Visibility) {
+        add_visibility_passes();
     } else {
-        // Geometry pass
-        m_deferred->m_gpass.bind();
-        glViewport(0, 0, m_window.get_width(), m_window.get_height());
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        add_deferred_passes();
+    }
 
-        m_deferred->m_gpass_shader.bind();
-        m_deferred->m_gpass_shader.set_mat4("proj", m_camera.get_proj());
-        m_deferred->m_gpass_shader.set_mat4("view", m_camera.get_view());
+    m_render_graph.compile();
+    if (m_print_render_graph && m_render_graph.schedule_changed()) {
+        LOG_INFO(m_render_graph.get_schedule());
+    }
+    m_render_graph.execute();
 
-        instance_draw_internal(m_deferred->m_gpass_shader, false);
+    Renderer::Texture::reset_texture_units();
 
-        m_deferred->m_gpass.blit_depth_buffer();
-        m_deferred->m_gpass.unbind();
+    const auto& gl_stats = Renderer::GlState::get_frame_stats();
+    Utils::FlightRecorder::set_counter("gl state calls", gl_stats.calls);
+    Utils::FlightRecorder::set_counter("shadow maps redrawn", m_shadow_redraws);
+    Utils::FlightRecorder::set_counter("physics temp peak bytes", static_cast<f64>(m_physics_system->get_temp_allocator().get_last_step().peak_bytes));
+    Utils::FlightRecorder::set_counter("render queue draws", static_cast<f64>(m_render_queue.get_items().size()));
+}
 
-        // Lighting pass
-        glClear(GL_COLOR_BUFFER_BIT);
-        m_deferred->m_lpass_shader.bind();
+void Scene::add_shadow_passes(Renderer::RenderGraph::Resource shadow_atlas, Renderer::RenderGraph::Resource point_shadows)
+{
+    m_shadow_redraws = 0;
+
+    m_render_graph.add_pass(
+        "directional_shadows",
+        [&](Renderer::RenderGraph::Builder& builder) {
+            builder.write(shadow_atlas, Renderer::RenderGraph::Access::DepthAttachment);
+        },
+        [this](Renderer::RenderGraph&) {
+            auto phong_directional_view = m_registry.view<Renderer::Light::Phong::Directional>();
+            for (auto [entity, light] : phong_directional_view.each()) {
+                if (light.has_shadowmap() && shadow_needs_redraw(light)) {
+                    m_shadow_redraws++;
+                    light.shadowmap_draw(m_shadowmap_shader, [&]() {
+                        instance_draw_internal(m_shadowmap_shader, true);
+                    });
+                }
+            }
+        });
+
+    m_render_graph.add_pass(
+        "point_shadows",
+        [&](Renderer::RenderGraph::Builder& builder) {
+            builder.write(point_shadows, Renderer::RenderGraph::Access::DepthAttachment);
+        },
+        [this](Renderer::RenderGraph&) {
+            auto phong_point_view = m_registry.view<Renderer::Light::Phong::Point>();
+            if (m_layered_point_shadows) {
+                update_caster_bounds();
+            }
+            m_point_shadow_timer.begin();
+            for (auto [entity, light] : phong_point_view.each()) {
+                if (light.has_shadowmap() && shadow_needs_redraw(light)) {
+                    m_shadow_redraws++;
+                    if (m_layered_point_shadows) {
+                        light.shadowmap_draw_layered(m_shadowmap_cubemap_layered_shader, m_caster_bounds, [&](u32 face_count) {
+                            instance_draw_layered_internal(face_count);
+                        });
+                    } else {
+                        light.shadowmap_draw(m_shadowmap_cubemap_shader, [&]() {
+                            instance_draw_internal(m_shadowmap_cubemap_shader, true);
+                        });
+                    }
+                }
+            }
+            m_point_shadow_timer.end();
+        });
+}
 
-        m_deferred->m_gpass.set_uniforms(m_deferred->m_lpass_shader);
-        m_deferred->m_lpass_shader.set_vec3("view_position", m_camera.get_pos());
+void Scene::add_forward_passes()
+{
+    if (!(m_gpu_culling && m_culling.is_initialized())) {
+        // Straight into the multisampled default framebuffer, which the graph has no texture for
+        m_render_graph.add_pass(
+            "forward",
+            [&](Renderer::RenderGraph::Builder& builder) {
+                builder.side_effect();
+            },
+            [this](Renderer::RenderGraph& graph) {
+                draw_forward(graph, Renderer::RenderGraph::INVALID_RESOURCE);
+            });
+        return;
+    }
 
-        u32 i = 0;
-        for (auto [entity, light] : phong_directional_view.each()) {
-            light.set_uniforms(m_deferred->m_lpass_shader, std::format("u_directional_light_{}", i).c_str());
-            i++;
+    // Culling needs a depth it can sample, so it renders single sampled and presents afterwards
+    const i32 width = m_window.get_width();
+    const i32 height = m_window.get_height();
+    const auto color = m_render_graph.create_texture("forward_color", { .width = width, .height = height, .internal_format = GL_RGBA8 });
+    const auto depth = m_render_graph.create_texture("forward_depth", { .width = width, .height = height, .internal_format = GL_DEPTH_COMPONENT32F });
+    const auto hi_z = m_render_graph.import_texture("hi_z",
+        m_hi_z.get_texture(),
+        { .width = m_hi_z.get_width(), .height = m_hi_z.get_height(), .internal_format = GL_RG32F, .levels = m_hi_z.get_mip_count() });
+
+    m_render_graph.add_pass(
+        "forward",
+        [&](Renderer::RenderGraph::Builder& builder) {
+            builder.read(hi_z, Renderer::RenderGraph::Access::Sampled);
+            builder.write(color, Renderer::RenderGraph::Access::ColorAttachment);
+            builder.write(depth, Renderer::RenderGraph::Access::DepthAttachment);
+            // Rebuilt between the two culling phases
+            builder.write(hi_z, Renderer::RenderGraph::Access::ImageStore);
+        },
+        [this, depth](Renderer::RenderGraph& graph) {
+            draw_forward(graph, depth);
+        });
+
+    m_render_graph.add_pass(
+        "present",
+        [&](Renderer::RenderGraph::Builder& builder) {
+            builder.read(color, Renderer::RenderGraph::Access::Sampled);
+            builder.side_effect();
+        },
+        [this, color, width, height](Renderer::RenderGraph& graph) {
+            m_presenter.present(graph.get_texture(color), width, height);
+        });
+}
+
+void Scene::add_visibility_passes()
+{
+    auto& visibility = *m_visibility;
+    visibility.m_buffer.declare(m_render_graph, m_window.get_width(), m_window.get_height());
+
+    m_render_graph.add_pass(
+        "visibility_geometry",
+        [&](Renderer::RenderGraph::Builder& builder) {
+            visibility.m_buffer.write(builder);
+        },
+        [this](Renderer::RenderGraph& graph) {
+            graph.bind_attachments();
+            Renderer::VisibilityBuffer::clear();
+            draw_visibility_geometry();
+        });
+
+    m_render_graph.add_pass(
+        "visibility_material",
+        [&](Renderer::RenderGraph::Builder& builder) {
+            visibility.m_buffer.read(builder);
+            builder.side_effect();
+        },
+        [this](Renderer::RenderGraph& graph) {
+            draw_visibility_material(graph);
+        });
+}
+
+void Scene::add_deferred_passes()
+{
+    auto& deferred = *m_deferred;
+    deferred.m_gpass.declare(m_render_graph, m_window.get_width(), m_window.get_height());
+
+    m_render_graph.add_pass(
+        "gbuffer",
+        [&](Renderer::RenderGraph::Builder& builder) {
+            deferred.m_gpass.write(builder);
+        },
+        [this, &deferred](Renderer::RenderGraph& graph) {
+            deferred.m_gpass_timer.begin();
+            graph.bind_attachments();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            deferred.m_gpass_shader.bind();
+            deferred.m_gpass_shader.set_mat4("proj", m_camera.get_proj());
+            deferred.m_gpass_shader.set_mat4("view", m_camera.get_view());
+            instance_draw_internal(deferred.m_gpass_shader, Renderer::AlphaMode::Opaque);
+
+            // The gbuffer has no blending, blended draws are alpha tested instead
+            deferred.m_gpass_shader_masked.bind();
+            deferred.m_gpass_shader_masked.set_mat4("proj", m_camera.get_proj());
+            deferred.m_gpass_shader_masked.set_mat4("view", m_camera.get_view());
+            instance_draw_internal(deferred.m_gpass_shader_masked, Renderer::AlphaMode::Mask);
+            instance_draw_internal(deferred.m_gpass_shader_masked, Renderer::AlphaMode::Blend);
+            deferred.m_gpass_timer.end();
+        });
+
+    if (deferred.m_tiled) {
+        const i32 width = m_window.get_width();
+        const i32 height = m_window.get_height();
+        const auto lit = m_render_graph.create_texture("tiled_lighting_target", { .width = width, .height = height, .internal_format = GL_RGBA8 });
+
+        m_render_graph.add_pass(
+            "tiled_lighting",
+            [&](Renderer::RenderGraph::Builder& builder) {
+                deferred.m_gpass.read(builder);
+                builder.write(lit, Renderer::RenderGraph::Access::ImageStore);
+            },
+            [this, &deferred, lit, width, height](Renderer::RenderGraph& graph) {
+                deferred.m_lpass_timer.begin();
+                auto& tiled_lighting = deferred.m_tiled_lighting;
+                tiled_lighting.clear_lights();
+                for (auto [entity, light] : m_registry.view<Renderer::Light::Pbr::Directional>().each()) {
+                    tiled_lighting.add_light(light);
+                }
+                for (auto [entity, light] : m_registry.view<Renderer::Light::Pbr::Point>().each()) {
+                    tiled_lighting.add_light(light);
+                }
+                for (auto [entity, light] : m_registry.view<Renderer::Light::Pbr::Spot>().each()) {
+                    tiled_lighting.add_light(light);
+                }
+
+                deferred.m_tiled_shader.bind();
+                deferred.m_gpass.set_uniforms(graph, deferred.m_tiled_shader);
+                tiled_lighting.dispatch(deferred.m_tiled_shader,
+                    graph.get_texture(lit),
+                    { width, height },
+                    m_camera.get_view(),
+                    m_camera.get_proj());
+            });
+
+        m_render_graph.add_pass(
+            "present",
+            [&](Renderer::RenderGraph::Builder& builder) {
+                builder.read(lit, Renderer::RenderGraph::Access::Sampled);
+                builder.side_effect();
+            },
+            [this, &deferred, lit, width, height](Renderer::RenderGraph& graph) {
+                glViewport(0, 0, width, height);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                m_presenter.present(graph.get_texture(lit), width, height);
+                deferred.m_lpass_timer.end();
+            });
+    } else {
+        m_render_graph.add_pass(
+            "lighting",
+            [&](Renderer::RenderGraph::Builder& builder) {
+                deferred.m_gpass.read(builder);
+                builder.side_effect();
+            },
+            [this, &deferred](Renderer::RenderGraph& graph) {
+                deferred.m_lpass_timer.begin();
+                glViewport(0, 0, m_window.get_width(), m_window.get_height());
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                Renderer::GlState::disable(GL_DEPTH_TEST);
+
+                deferred.m_lpass_shader.bind();
+                deferred.m_gpass.set_uniforms(graph, deferred.m_lpass_shader);
+                set_forward_uniforms(deferred.m_lpass_shader);
+                deferred.m_lpass_shader.set_mat4("inv_proj", glm::inverse(m_camera.get_proj()));
+                deferred.m_lpass_shader.set_mat4("inv_view", glm::inverse(m_camera.get_view()));
+                deferred.m_lpass.draw();
+
+                Renderer::GlState::enable(GL_DEPTH_TEST);
+                deferred.m_lpass_timer.end();
+            });
+    }
+}
+
+void Scene::draw_visibility_geometry()
+{
+    auto& visibility = *m_visibility;
+
+    // Every model gets a contiguous run of draw ids
+    visibility.m_geometry_timer.begin();
+
+    visibility.m_draw_offsets.clear();
+    u32 draw_offset = 0;
+    for (auto& model : m_models_instance_draw_cache) {
+        visibility.m_draw_offsets.emplace_back(draw_offset);
+        draw_offset += model.model->get_visibility_draw_count(model.model_matrices.size());
+    }
+
+    const auto draw_bucket = [&](Renderer::ShaderProgram& shader, Renderer::AlphaMode alpha_mode) {
+        shader.bind();
+        shader.set_mat4("proj", m_camera.get_proj());
+        shader.set_mat4("view", m_camera.get_view());
+        for (usize i = 0; i < m_models_instance_draw_cache.size(); i++) {
+            auto& model = m_models_instance_draw_cache[i];
+            model.model->draw_visibility(shader, model.model_matrices, alpha_mode, visibility.m_draw_offsets[i]);
         }
-        i = 0;
-        for (auto [entity, light] : phong_point_view.each()) {
-            light.set_uniforms(m_deferred->m_lpass_shader, std::format("u_point_light_{}", i).c_str());
-            i++;
+    };
+    draw_bucket(visibility.m_shader, Renderer::AlphaMode::Opaque);
+    draw_bucket(visibility.m_shader_masked, Renderer::AlphaMode::Mask);
+    draw_bucket(visibility.m_shader_masked, Renderer::AlphaMode::Blend);
+
+    visibility.m_geometry_timer.end();
+}
+
+void Scene::draw_visibility_material(Renderer::RenderGraph& graph)
+{
+    auto& visibility = *m_visibility;
+
+    // One full screen quad per model that discards the other models' ids
+    visibility.m_material_timer.begin();
+    glViewport(0, 0, m_window.get_width(), m_window.get_height());
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    Renderer::GlState::disable(GL_DEPTH_TEST);
+
+    set_forward_uniforms(visibility.m_material_shader);
+    visibility.m_buffer.set_uniforms(graph, visibility.m_material_shader);
+    for (usize i = 0; i < m_models_instance_draw_cache.size(); i++) {
+        auto& model = m_models_instance_draw_cache[i];
+        if (model.model_matrices.empty()) {
+            continue;
         }
-        m_deferred->m_lpass.draw();
+        model.model->bind_visibility_resources(visibility.m_material_shader, visibility.m_draw_offsets[i]);
+        visibility.m_quad.draw();
     }
-    Renderer::Texture::reset_texture_units();
+
+    Renderer::GlState::enable(GL_DEPTH_TEST);
+    visibility.m_material_timer.end();
+}
+
+void Scene::draw_forward(Renderer::RenderGraph& graph, Renderer::RenderGraph::Resource depth)
+{
+    const bool culling = depth != Renderer::RenderGraph::INVALID_RESOURCE;
+    const u32 phase_count = culling ? Renderer::GpuCulling::PHASE_COUNT : 1;
+
+    if (culling) {
+        graph.bind_attachments();
+    }
+    glViewport(0, 0, m_window.get_width(), m_window.get_height());
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Without culling everything is drawn as phase 0
+    const auto draw_bucket = [&](Renderer::ShaderProgram& shader, Renderer::AlphaMode alpha_mode, u32 phase) {
+        if (culling) {
+            instance_draw_culled_internal(shader, alpha_mode, phase);
+        } else {
+            instance_draw_internal(shader, alpha_mode);
+        }
+    };
+
+    // Opaque and masked geometry of one phase, depth only when there is a pre-pass
+    const auto draw_occluders = [&](u32 phase) {
+        if (m_depth_prepass) {
+            Renderer::GlState::color_mask(false);
+
+            m_forward->m_depth_shader.bind();
+            m_forward->m_depth_shader.set_mat4("proj", m_camera.get_proj());
+            m_forward->m_depth_shader.set_mat4("view", m_camera.get_view());
+            draw_bucket(m_forward->m_depth_shader, Renderer::AlphaMode::Opaque, phase);
+
+            m_forward->m_depth_shader_masked.bind();
+            m_forward->m_depth_shader_masked.set_mat4("proj", m_camera.get_proj());
+            m_forward->m_depth_shader_masked.set_mat4("view", m_camera.get_view());
+            draw_bucket(m_forward->m_depth_shader_masked, Renderer::AlphaMode::Mask, phase);
+
+            Renderer::GlState::color_mask(true);
+        } else {
+            set_forward_uniforms(m_forward->m_shader);
+            draw_bucket(m_forward->m_shader, Renderer::AlphaMode::Opaque, phase);
+
+            set_forward_uniforms(m_forward->m_shader_masked);
+            draw_bucket(m_forward->m_shader_masked, Renderer::AlphaMode::Mask, phase);
+        }
+    };
+
+    if (culling) {
+        // Phase 0, test against last frame's HiZ and draw what passed
+        m_culling_timer.begin();
+        m_culling.begin_frame(m_camera.get_proj() * m_camera.get_view());
+        m_culling.begin_phase(0, m_hi_z);
+        instance_cull_internal(0);
+        m_culling.end_phase();
+        m_culling_timer.end();
+
+        draw_occluders(0);
+
+        // Phase 1, re-test what phase 0 rejected against this frame's depth so far
+        m_culling_late_timer.begin();
+        m_hi_z.build(graph.get_texture(depth));
+        m_culling.begin_phase(1, m_hi_z);
+        instance_cull_internal(1);
+        m_culling.end_phase();
+        m_culling_late_timer.end();
+
+        draw_occluders(1);
+
+        // Kept for next frame's phase 0, rebuilt so what phase 1 drew occludes there too
+        m_hi_z.build(graph.get_texture(depth));
+    } else {
+        draw_occluders(0);
+    }
+
+    if (m_depth_prepass) {
+        Renderer::GlState::depth_mask(false);
+        Renderer::GlState::depth_func(GL_EQUAL);
+
+        // Masked fragments that were discarded never wrote depth, so they fail GL_EQUAL without a discard here
+        set_forward_uniforms(m_forward->m_shader);
+        for (u32 phase = 0; phase < phase_count; phase++) {
+            draw_bucket(m_forward->m_shader, Renderer::AlphaMode::Opaque, phase);
+            draw_bucket(m_forward->m_shader, Renderer::AlphaMode::Mask, phase);
+        }
+    }
+
+    // Blended geometry is tested against the opaque depth but never writes it
+    Renderer::GlState::depth_mask(false);
+    Renderer::GlState::depth_func(GL_LESS);
+    Renderer::GlState::enable(GL_BLEND);
+    set_forward_uniforms(m_forward->m_shader);
+    for (u32 phase = 0; phase < phase_count; phase++) {
+        draw_bucket(m_forward->m_shader, Renderer::AlphaMode::Blend, phase);
+    }
+    Renderer::GlState::disable(GL_BLEND);
+    Renderer::GlState::depth_mask(true);
 }
 
-void Scene::set_pass(bool forward)
+void Scene::set_pass(Pass pass)
 {
-    if (m_forward_pass != forward) {
-        m_forward_pass = forward;
+    if (pass == Pass::Visibility && !Renderer::VisibilityBuffer::is_supported()) {
+        LOG_WARN("Visibility buffer needs GL_ARB_bindless_texture, using the forward pass");
+        pass = Pass::Forward;
+    }
+
+    if (m_pass != pass) {
+        m_pass = pass;
         init_pass();
         update();
     }
 }
 
+void Scene::set_layered_point_shadows(bool layered)
+{
+    m_layered_point_shadows = layered && Renderer::ShadowMap::supports_layered_cubemap();
+}
+
+[[nodiscard]] bool Scene::get_layered_point_shadows() const
+{
+    return m_layered_point_shadows;
+}
+
+void Scene::set_cache_shadows(bool cache)
+{
+    m_cache_shadows = cache;
+}
+
 void Scene::draw_debug_imgui()
 {
     if (ImGui::Button("Reload shaders")) {
@@ -283,12 +1023,101 @@ void Scene::draw_debug_imgui()
         m_camera.set_speed(m_camera_speed);
     }
 
+    if (Renderer::ShadowMap::supports_layered_cubemap()) {
+        ImGui::Checkbox("Layered point shadows", &m_layered_point_shadows);
+    }
+    ImGui::Text("Point shadows (%s): %.3f ms",
+        m_layered_point_shadows ? "layered" : "geometry shader",
+        static_cast<f64>(m_point_shadow_timer.get_ms()));
+    ImGui::Checkbox("Cache static shadows", &m_cache_shadows);
+    if (m_pass == Pass::Forward) {
+        ImGui::Checkbox("Depth pre-pass", &m_depth_prepass);
+
+        if (m_culling.is_initialized()) {
+            // The vertex shaders read the culled instances, so they have to be rebuilt
+            if (ImGui::Checkbox("GPU occlusion culling (no MSAA)", &m_gpu_culling)) {
+                m_shaders_need_update = true;
+            }
+            if (m_gpu_culling) {
+                const auto& stats = m_culling.get_stats();
+                ImGui::Text("Visible: %u (+%u from phase 1)", stats.visible_phase_0 + stats.visible_phase_1, stats.visible_phase_1);
+                ImGui::Text("Frustum culled: %u, occluded: %u", stats.frustum_culled, stats.occluded);
+                ImGui::Text("Culling: %.3f ms (phase 0) + %.3f ms (HiZ and phase 1)",
+                    static_cast<f64>(m_culling_timer.get_ms()),
+                    static_cast<f64>(m_culling_late_timer.get_ms()));
+            }
+        }
+    } else if (m_pass == Pass::Visibility) {
+        ImGui::Text("Visibility buffer: %u bytes/pixel, %.2f MiB",
+            Renderer::VisibilityBuffer::BYTES_PER_PIXEL,
+            static_cast<f64>(m_visibility->m_buffer.get_size_bytes()) / (1024.0 * 1024.0));
+        ImGui::Text("Geometry pass: %.3f ms, material pass: %.3f ms",
+            static_cast<f64>(m_visibility->m_geometry_timer.get_ms()),
+            static_cast<f64>(m_visibility->m_material_timer.get_ms()));
+    } else {
+        ImGui::Text("GBuffer: %u bytes/pixel, %.2f MiB",
+            Renderer::GBuffer::BYTES_PER_PIXEL,
+            static_cast<f64>(m_deferred->m_gpass.get_size_bytes()) / (1024.0 * 1024.0));
+        ImGui::Checkbox("Tiled compute lighting", &m_deferred->m_tiled);
+        if (m_deferred->m_tiled) {
+            ImGui::Text("Lights: %zu in %dx%d tiles",
+                m_deferred->m_tiled_lighting.get_light_count(),
+                Renderer::TiledLighting::TILE_SIZE,
+                Renderer::TiledLighting::TILE_SIZE);
+        }
+        ImGui::Text("Geometry pass: %.3f ms, lighting pass: %.3f ms",
+            static_cast<f64>(m_deferred->m_gpass_timer.get_ms()),
+            static_cast<f64>(m_deferred->m_lpass_timer.get_ms()));
+    }
+    ImGui::Text("Shadow maps redrawn this frame: %u", m_shadow_redraws);
+    ImGui::Text("Render queue: %zu draws sorted, %u workers",
+        m_render_queue.get_items().size(),
+        m_render_queue.get_worker_count());
+    const auto& gl_stats = Renderer::GlState::get_frame_stats();
+    ImGui::Text("GL state calls: %u, %u redundant ones dropped", gl_stats.calls, gl_stats.saved);
+    ImGui::Text("Physics: %llu steps, %.3f ms per step",
+        static_cast<unsigned long long>(m_simulation.get_step_count()),
+        m_simulation.get_step_ms());
+    i32 steps_per_second = static_cast<i32>(m_simulation.get_steps_per_second());
+    if (ImGui::SliderInt("Physics steps per second", &steps_per_second, 30, 240)) {
+        m_simulation.set_steps_per_second(static_cast<u32>(steps_per_second));
+    }
+    // Size the arena from the worst step, anything past it went to the heap
+    const auto temp_last = m_physics_system->get_temp_allocator().get_last_step();
+    const auto temp_worst = m_physics_system->get_temp_allocator().get_worst_step();
+    ImGui::Text("Physics temp: %.2f / %.2f MiB peak, %u allocations, %u on the heap",
+        static_cast<f64>(temp_last.peak_bytes) / (1024.0 * 1024.0),
+        static_cast<f64>(temp_last.capacity) / (1024.0 * 1024.0),
+        temp_last.allocations,
+        temp_last.fallback_allocations);
+    ImGui::Text("Physics temp worst step: %.2f MiB peak, %u allocations, %u on the heap",
+        static_cast<f64>(temp_worst.peak_bytes) / (1024.0 * 1024.0),
+        temp_worst.allocations,
+        temp_worst.fallback_allocations);
+
+    ImGui::Checkbox("Log render graph changes", &m_print_render_graph);
+    if (ImGui::TreeNode("Render graph")) {
+        ImGui::TextUnformatted(m_render_graph.get_schedule().c_str());
+        ImGui::TreePop();
+    }
+
     constexpr float MAX_TRANSFORM = 32.0F;
     constexpr float MIN_TRANSFORM = -32.0F;
 
     constexpr float MAX_COLOR = 3000.0F;
     constexpr float MIN_COLOR = 0.0F;
 
+    if (m_registry.valid(m_selected_entity)) {
+        const char** selected_name = m_registry.try_get<const char*>(m_selected_entity);
+        const glm::vec3 selected_position = m_registry.get<glm::mat4>(m_selected_entity)[3];
+        ImGui::Text("Selected: %s (entity %u) at %.2f, %.2f, %.2f",
+            selected_name != nullptr ? *selected_name : "no_name",
+            entt::to_integral(m_selected_entity),
+            selected_position.x, selected_position.y, selected_position.z);
+    } else {
+        ImGui::TextUnformatted("Selected: nothing, click an object with the mouse released");
+    }
+
     usize i = 0;
     if (ImGui::CollapsingHeader("Physics Objects")) {
         auto view = m_registry.view<glm::mat4, JPH::BodyID, JPH::EMotionType>();
@@ -305,7 +1134,11 @@ void Scene::draw_debug_imgui()
 
                 if (ImGui::CollapsingHeader(std::format("{}_e{}", name, i).c_str())) {
                     glm::vec4& cube_pos = model_matrix[3];
-                    ImGui::DragFloat3("XYZ", &cube_pos.x, 1.0F, MIN_TRANSFORM, MAX_TRANSFORM);
+                    if (ImGui::DragFloat3("XYZ", &cube_pos.x, 1.0F, MIN_TRANSFORM, MAX_TRANSFORM)) {
+                        // Moving a sleeping body never reaches the moving bounds
+                        mark_shadows_dirty();
+                    }
+                    auto lock = m_simulation.lock();
                     m_physics_system->m_body_interface->SetPosition(
                         body,
                         vec3_to_vec3(cube_pos),
@@ -392,6 +1225,11 @@ const Utils::DeltaTime& Scene::get_clock()
     return m_clock;
 }
 
+void Scene::set_fixed_delta_time(f32 delta_time)
+{
+    m_clock.set_fixed_delta_time(delta_time);
+}
+
 void Scene::compile_shaders()
 {
     if (!m_shaders_need_update) {
@@ -412,11 +1250,17 @@ void Scene::compile_shaders()
         m_shadowmap_cubemap_shader.init(shadowmap_cubemap_info.data(), shadowmap_cubemap_info.size());
     }
 
+    if (!m_shadowmap_cubemap_layered_shader.is_initialized() && Renderer::ShadowMap::supports_layered_cubemap()) {
+        auto shadowmap_cubemap_layered_info = Renderer::ShadowMap::get_shader_info_cubemap_layered();
+        m_shadowmap_cubemap_layered_shader.init(shadowmap_cubemap_layered_info.data(), shadowmap_cubemap_layered_info.size());
+    }
+
     m_shaders_need_update = false;
 }
 
 void Scene::compile_pbr_shaders()
 {
+    PROFILE_SCOPE("Scene::compile_pbr_shaders");
     std::string light_uniforms;
     std::string light_functions;
 
@@ -442,14 +1286,7 @@ void Scene::compile_pbr_shaders()
         i++;
     }
 
-    if (m_forward_pass) {
-        std::pair<std::string, std::string> shader_source;
-        if (Renderer::Extensions::is_extension_supported("GL_ARB_bindless_texture")) {
-            shader_source = get_pbr_forward_pass_indirect(light_uniforms, light_functions);
-        } else {
-            shader_source = get_pbr_forward_pass_normal(light_uniforms, light_functions);
-        }
-
+    const auto init_shader = [](Renderer::ShaderProgram& shader, const std::pair<std::string, std::string>& shader_source) {
         // std::println("Vertex Shader\n{}\n\n\nFragment Shader\n{}", shader_source.first, shader_source.second);
         // std::quick_exit(0);
 
@@ -466,10 +1303,32 @@ void Scene::compile_pbr_shaders()
                     .type = GL_FRAGMENT_SHADER,
                 },
             };
-        if (m_forward->m_shader.is_initialized()) {
-            m_forward->m_shader.~ShaderProgram();
+        if (shader.is_initialized()) {
+            shader.~ShaderProgram();
         }
-        m_forward->m_shader.init(shader_info.data(), shader_info.size());
+        shader.init(shader_info.data(), shader_info.size());
+    };
+
+    bool bindless = Renderer::Extensions::is_extension_supported("GL_ARB_bindless_texture");
+    if (m_pass == Pass::Forward) {
+        bool culling = m_gpu_culling && m_culling.is_initialized();
+        if (bindless) {
+            init_shader(m_forward->m_shader, get_pbr_forward_pass_indirect(light_uniforms, light_functions, false, culling));
+            init_shader(m_forward->m_shader_masked, get_pbr_forward_pass_indirect(light_uniforms, light_functions, true, culling));
+        } else {
+            init_shader(m_forward->m_shader, get_pbr_forward_pass_normal(light_uniforms, light_functions, false, false));
+            init_shader(m_forward->m_shader_masked, get_pbr_forward_pass_normal(light_uniforms, light_functions, true, false));
+        }
+        init_shader(m_forward->m_depth_shader, get_pbr_depth_pass(bindless, false, culling));
+        init_shader(m_forward->m_depth_shader_masked, get_pbr_depth_pass(bindless, true, culling));
+    } else if (m_pass == Pass::Visibility) {
+        init_shader(m_visibility->m_shader, get_visibility_pass(false));
+        init_shader(m_visibility->m_shader_masked, get_visibility_pass(true));
+        init_shader(m_visibility->m_material_shader, get_visibility_material_pass(light_uniforms, light_functions));
+    } else {
+        init_shader(m_deferred->m_gpass_shader, get_pbr_gbuffer_pass(bindless, false, false));
+        init_shader(m_deferred->m_gpass_shader_masked, get_pbr_gbuffer_pass(bindless, true, false));
+        init_shader(m_deferred->m_lpass_shader, get_pbr_lighting_pass(light_uniforms, light_functions));
     }
 }
 
@@ -600,19 +1459,42 @@ void Scene::init_pass()
         m_deferred = nullptr;
         LOG_INFO("Deleted deferred pass");
     }
+    if (m_visibility != nullptr) {
+        delete m_visibility;
+        m_visibility = nullptr;
+        LOG_INFO("Deleted visibility pass");
+    }
 
-    if (m_forward_pass) {
+    if (m_pass == Pass::Forward) {
         m_forward = new ForwardPass {};
         LOG_INFO("Created forward pass");
-        glEnable(GL_MULTISAMPLE);
+        Renderer::GlState::enable(GL_MULTISAMPLE);
+    } else if (m_pass == Pass::Visibility) {
+        m_visibility = new VisibilityPass {};
+        m_visibility->m_quad.init();
+        m_visibility->m_geometry_timer.init();
+        m_visibility->m_material_timer.init();
+        LOG_INFO(std::format("Created visibility pass, {} bytes/pixel", Renderer::VisibilityBuffer::BYTES_PER_PIXEL));
+        Renderer::GlState::disable(GL_MULTISAMPLE);
     } else {
         m_deferred = new DeferedPass {};
-        m_deferred->m_gpass_width = m_window.get_width();
-        m_deferred->m_gpass_height = m_window.get_height();
-        m_deferred->m_gpass.init(m_deferred->m_gpass_width, m_deferred->m_gpass_height);
         m_deferred->m_lpass.init();
-        LOG_INFO("Created deferred pass");
-        glDisable(GL_MULTISAMPLE);
+        m_deferred->m_gpass_timer.init();
+        m_deferred->m_lpass_timer.init();
+        m_deferred->m_tiled_lighting.init();
+
+        // The lights live in storage buffers, so unlike the other pbr shaders it never depends on the light count
+        std::string tiled_source = get_pbr_tiled_lighting_pass();
+        std::array<Renderer::ShaderInfo, 1> tiled_info = {
+            Renderer::ShaderInfo {
+                .is_file = false,
+                .shader = tiled_source.c_str(),
+                .type = GL_COMPUTE_SHADER,
+            },
+        };
+        m_deferred->m_tiled_shader.init(tiled_info.data(), tiled_info.size());
+        LOG_INFO(std::format("Created deferred pass, gbuffer {} bytes/pixel", Renderer::GBuffer::BYTES_PER_PIXEL));
+        Renderer::GlState::disable(GL_MULTISAMPLE);
     }
 
     m_shaders_need_update = true;
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "../physics/engine.hpp"
+#include "../physics/queries.hpp"
+#include "../physics/simulation.hpp"
 #include "../utils/cache.hpp"
 #include "../utils/deltatime.hpp"
 
@@ -8,26 +10,62 @@
 
 #include "entity_builder.hpp"
 
+// Keeps the lights of an entity at the position of target's transform
+struct TransformFollower {
+    entt::entity target;
+};
+
 class Scene : public NoCopyNoMove {
 public:
-    explicit Scene(Renderer::Window& window, Renderer::Camera& camera);
+    enum class Pass : u8 {
+        Forward = 0,
+        Deferred,
+        Visibility,
+    };
+
+    explicit Scene(Renderer::Window& window, Renderer::Camera& camera, const Physics::SystemSettings& physics_settings = {});
     ~Scene();
 
     void add_entity(const EntityBuilder& entity);
+    // One entity per body sharing the builder's name, model and model matrix. The bodies go into
+    // the physics system in batches, use it over add_entity() in a loop for mass spawning
+    void spawn_bodies(const EntityBuilder& entity, std::span<const JPH::BodyCreationSettings> bodies, JPH::EActivation activation);
 
     // Call update after adding an entity (or maybe I do that internally)
     void update();
     void optimize();
 
+    // Runs or pauses the simulation thread, physics() shows its latest state
+    void set_physics_running(bool running);
     void physics();
+    // Steps the simulation on this thread by delta_time instead, for runs that have to be
+    // reproducible. The simulation thread must never have been started
+    void step_physics(f32 delta_time);
+    [[nodiscard]] const Physics::System& get_physics_system() const;
+
+    // Scene queries in batches, hits carry the entity of the body. They wait for the simulation
+    // step in flight, see Physics::QueryService
+    void cast_rays(std::span<const Physics::RayCast> rays, std::span<Physics::QueryHit> hits);
+    void overlap_spheres(std::span<const Physics::SphereOverlap> spheres, Physics::OverlapResults& results);
+    void cast_shapes(std::span<const Physics::ShapeCast> casts, std::span<Physics::QueryHit> hits);
+    // Selects the entity under a point in window coordinates, entt::null when there is none
+    entt::entity pick(glm::vec2 position);
     void draw();
 
-    void set_pass(bool forward);
+    // Falls back to the forward pass when the visibility buffer is not supported
+    void set_pass(Pass pass);
+    // Falls back to the geometry shader path when layered rendering into cubemaps is not supported
+    void set_layered_point_shadows(bool layered);
+    [[nodiscard]] bool get_layered_point_shadows() const;
+    // Off redraws every shadow every frame
+    void set_cache_shadows(bool cache);
 
     void draw_debug_imgui();
 
     Renderer::Camera& get_camera();
     const Utils::DeltaTime& get_clock();
+    // Replays run with a fixed step so physics and animation match between runs
+    void set_fixed_delta_time(f32 delta_time);
 
 private:
     void compile_shaders();
@@ -43,28 +81,92 @@ private:
     float m_camera_speed = 5.0F;
 
     bool m_shaders_need_update = true;
-    bool m_forward_pass = true;
+    Pass m_pass = Pass::Forward;
+    bool m_depth_prepass = true;
+
+    // Two phase HiZ occlusion culling of the forward pass, needs the indirect draw path. Opt-in,
+    // its target is single sampled so turning it on trades MSAA for culling
+    bool m_gpu_culling = false;
+    Renderer::GpuCulling m_culling;
+    // Phase 0 tests against last frame's pyramid, so it outlives the frame and is imported into the graph
+    Renderer::HiZ m_hi_z;
+    Renderer::GpuTimer m_culling_timer;
+    Renderer::GpuTimer m_culling_late_timer;
 
     struct DeferedPass {
         Renderer::ShaderProgram m_gpass_shader;
+        Renderer::ShaderProgram m_gpass_shader_masked;
         Renderer::ShaderProgram m_lpass_shader;
 
-        int m_gpass_width = 0;
-        int m_gpass_height = 0;
         Renderer::GBuffer m_gpass;
         Renderer::Quad m_lpass;
+
+        Renderer::GpuTimer m_gpass_timer;
+        Renderer::GpuTimer m_lpass_timer;
+
+        // Compute lighting over 16x16 tiles, the quad pass above is kept for comparison
+        bool m_tiled = true;
+        Renderer::ShaderProgram m_tiled_shader;
+        Renderer::TiledLighting m_tiled_lighting;
     };
 
     struct ForwardPass {
+        // Opaque and blended draws, masked draws too after a depth pre-pass
+        Renderer::ShaderProgram m_shader;
+        // Masked draws without a depth pre-pass, the only variant that discards
+        Renderer::ShaderProgram m_shader_masked;
+
+        Renderer::ShaderProgram m_depth_shader;
+        Renderer::ShaderProgram m_depth_shader_masked;
+    };
+
+    struct VisibilityPass {
         Renderer::ShaderProgram m_shader;
+        // Masked and blended draws, there is no blending so both are alpha tested
+        Renderer::ShaderProgram m_shader_masked;
+        Renderer::ShaderProgram m_material_shader;
+
+        Renderer::VisibilityBuffer m_buffer;
+        Renderer::Quad m_quad;
+        // First draw id of every entry of the instance draw cache
+        std::vector<u32> m_draw_offsets;
+
+        Renderer::GpuTimer m_geometry_timer;
+        Renderer::GpuTimer m_material_timer;
     };
 
+    // Sorted draws of the forward and deferred geometry, indices into m_models_instance_draw_cache
+    Renderer::RenderQueue m_render_queue;
+    static constexpr u8 MAIN_QUEUE_PASS = 0;
+
+    // Rebuilt every draw, owns the transient textures of the passes above
+    Renderer::RenderGraph m_render_graph;
+    // Copies graph textures to the multisampled default framebuffer
+    Renderer::Presenter m_presenter;
+    bool m_print_render_graph = true;
+
     DeferedPass* m_deferred = nullptr;
     ForwardPass* m_forward = nullptr;
+    VisibilityPass* m_visibility = nullptr;
 
     // TODO: do I make these global? they never change.
     Renderer::ShaderProgram m_shadowmap_shader;
     Renderer::ShaderProgram m_shadowmap_cubemap_shader;
+    Renderer::ShaderProgram m_shadowmap_cubemap_layered_shader;
+
+    bool m_layered_point_shadows = false;
+    Renderer::GpuTimer m_point_shadow_timer;
+    // World space bounds of every model instance, used to skip empty shadow faces
+    std::vector<Renderer::AABB> m_caster_bounds;
+
+    // Directional shadows live in tiles of the atlas, point shadows keep their own cubemap
+    Renderer::ShadowAtlas m_shadow_atlas;
+    bool m_cache_shadows = true;
+    u32 m_shadow_redraws = 0;
+    // Bounds of active dynamic bodies this frame and last frame, a body leaving a
+    // light's volume has to clear its old shadow too
+    std::vector<Renderer::AABB> m_moving_bounds;
+    std::vector<Renderer::AABB> m_previous_moving_bounds;
 
     entt::registry m_registry;
     Utils::Cache<const char*, Renderer::Model> m_model_cache;
@@ -83,7 +185,43 @@ private:
     bool m_models_instance_draw_cache_needs_update = false;
 
     void instance_draw_internal(Renderer::ShaderProgram& shader, bool shadowmap);
+    // Draws the queued entries of one alpha mode in sorted order
+    void instance_draw_internal(Renderer::ShaderProgram& shader, Renderer::AlphaMode alpha_mode);
+    void build_render_queue();
+    void set_forward_uniforms(Renderer::ShaderProgram& shader);
+    void instance_cull_internal(u32 phase);
+    void instance_draw_culled_internal(Renderer::ShaderProgram& shader, Renderer::AlphaMode alpha_mode, u32 phase);
+    // Depth is the culling target's depth, INVALID_RESOURCE draws to the default framebuffer
+    void draw_forward(Renderer::RenderGraph& graph, Renderer::RenderGraph::Resource depth);
+    void draw_visibility_geometry();
+    void draw_visibility_material(Renderer::RenderGraph& graph);
+    void add_shadow_passes(Renderer::RenderGraph::Resource shadow_atlas, Renderer::RenderGraph::Resource point_shadows);
+    void add_forward_passes();
+    void add_deferred_passes();
+    void add_visibility_passes();
+    void instance_draw_layered_internal(u32 layer_count);
+    void update_caster_bounds();
+    void update_shadow_resolutions();
+    // Writes the interpolated bodies back into the registry
+    void apply_body_transforms();
+    void mark_shadows_dirty();
+    template <typename Light>
+    [[nodiscard]] bool shadow_needs_redraw(const Light& light) const;
 
     bool m_physics_needs_optimize = false;
     std::unique_ptr<Physics::System> m_physics_system = nullptr;
+    // Declared after the system so its thread is joined first
+    Physics::Simulation m_simulation;
+    std::vector<Physics::Simulation::BodyTransform> m_body_transforms;
+    // Simulation time step_physics() has reached
+    i64 m_physics_time_ns = 0;
+    // Set by physics() and step_physics(), update() ages the moving bounds out when they did not run
+    bool m_physics_ran = false;
+    Physics::QueryService m_queries;
+    entt::entity m_selected_entity = entt::null;
+    // Entity of every simulation handle
+    std::vector<entt::entity> m_body_entities;
+    // Scratch for spawn_bodies()
+    std::vector<JPH::BodyID> m_spawned_bodies;
+    std::vector<JPH::BodyID> m_moving_spawned_bodies;
 };
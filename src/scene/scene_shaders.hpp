@@ -4,7 +4,7 @@
 
 namespace {
 
-constexpr std::pair<std::string, std::string> get_pbr_forward_pass_indirect(const std::string& light_uniforms, const std::string& light_functions)
+constexpr std::pair<std::string, std::string> get_pbr_forward_pass_indirect(const std::string& light_uniforms, const std::string& light_functions, bool alpha_mask, bool gpu_culling)
 {
     std::pair<std::string, std::string> shaders;
 
@@ -13,10 +13,16 @@ constexpr std::pair<std::string, std::string> get_pbr_forward_pass_indirect(cons
 
     // Vertex Shader
     shaders.first = "#version 460 core\n#define SSBO0\n";
+    if (gpu_culling) {
+        shaders.first += "#define GpuCulling\n";
+    }
     shaders.first += get_lines_between_delims(pbr_file_view, "// Vertex Begin", "// Vertex End");
 
     // Fragment Shader
     shaders.second += "#version 460 core\n#define BindlessTextures\n";
+    if (alpha_mask) {
+        shaders.second += "#define AlphaMask\n";
+    }
     shaders.second += get_lines_between_delims(pbr_file_view, "// Fragment Begin", "// Light Uniforms Begin");
     shaders.second += light_uniforms;
     shaders.second += get_lines_between_delims(pbr_file_view, "// Light Uniforms End", "// LO Functions Begin");
@@ -26,7 +32,7 @@ constexpr std::pair<std::string, std::string> get_pbr_forward_pass_indirect(cons
     return shaders;
 }
 
-constexpr std::pair<std::string, std::string> get_pbr_forward_pass_normal(const std::string& light_uniforms, const std::string& light_functions)
+constexpr std::pair<std::string, std::string> get_pbr_forward_pass_normal(const std::string& light_uniforms, const std::string& light_functions, bool alpha_mask, bool gpu_culling)
 {
     std::pair<std::string, std::string> shaders;
 
@@ -35,10 +41,16 @@ constexpr std::pair<std::string, std::string> get_pbr_forward_pass_normal(const
 
     // Vertex Shader
     shaders.first = "#version 460 core\n#define SSBO0\n";
+    if (gpu_culling) {
+        shaders.first += "#define GpuCulling\n";
+    }
     shaders.first += get_lines_between_delims(pbr_file_view, "// Vertex Begin", "// Vertex End");
 
     // Fragment Shader
     shaders.second += "#version 460 core\n#define UniformTextures\n";
+    if (alpha_mask) {
+        shaders.second += "#define AlphaMask\n";
+    }
     shaders.second += get_lines_between_delims(pbr_file_view, "// Fragment Begin", "// Light Uniforms Begin");
     shaders.second += light_uniforms;
     shaders.second += get_lines_between_delims(pbr_file_view, "// Light Uniforms End", "// LO Functions Begin");
@@ -48,6 +60,169 @@ constexpr std::pair<std::string, std::string> get_pbr_forward_pass_normal(const
     return shaders;
 }
 
+// Same vertex shader as the forward pass so the depth matches exactly, alpha_mask samples the diffuse alpha
+constexpr std::pair<std::string, std::string> get_pbr_depth_pass(bool bindless, bool alpha_mask, bool gpu_culling)
+{
+    std::pair<std::string, std::string> shaders;
+
+    std::vector<char> pbr_file = read_file<char>("res/forward_pass/pbr_combined.glsl");
+    std::string_view pbr_file_view = { pbr_file.data(), pbr_file.size() };
+
+    // Vertex Shader
+    shaders.first = "#version 460 core\n#define SSBO0\n";
+    if (gpu_culling) {
+        shaders.first += "#define GpuCulling\n";
+    }
+    shaders.first += get_lines_between_delims(pbr_file_view, "// Vertex Begin", "// Vertex End");
+
+    // Fragment Shader
+    shaders.second += "#version 460 core\n";
+    shaders.second += bindless ? "#define BindlessTextures\n" : "#define UniformTextures\n";
+    if (alpha_mask) {
+        shaders.second += "#define AlphaMask\n";
+    }
+    shaders.second += get_lines_between_delims(pbr_file_view, "// Depth Fragment Begin", "// Depth Fragment End");
+
+    return shaders;
+}
+
+// Same vertex shader as the forward pass, the fragment shader only fills the gbuffer
+constexpr std::pair<std::string, std::string> get_pbr_gbuffer_pass(bool bindless, bool alpha_mask, bool gpu_culling)
+{
+    std::pair<std::string, std::string> shaders;
+
+    std::vector<char> pbr_file = read_file<char>("res/forward_pass/pbr_combined.glsl");
+    std::string_view pbr_file_view = { pbr_file.data(), pbr_file.size() };
+    std::vector<char> deferred_file = read_file<char>("res/deferred_shading/pbr_deferred.glsl");
+    std::string_view deferred_file_view = { deferred_file.data(), deferred_file.size() };
+
+    // Vertex Shader
+    shaders.first = "#version 460 core\n#define SSBO0\n";
+    if (gpu_culling) {
+        shaders.first += "#define GpuCulling\n";
+    }
+    shaders.first += get_lines_between_delims(pbr_file_view, "// Vertex Begin", "// Vertex End");
+
+    // Fragment Shader
+    shaders.second += "#version 460 core\n";
+    shaders.second += bindless ? "#define BindlessTextures\n" : "#define UniformTextures\n";
+    if (alpha_mask) {
+        shaders.second += "#define AlphaMask\n";
+    }
+    shaders.second += get_lines_between_delims(deferred_file_view, "// GBuffer Fragment Begin", "// Normal Mapping Begin");
+    shaders.second += get_lines_between_delims(pbr_file_view, "// Normal Mapping Begin", "// Normal Mapping End");
+    shaders.second += get_lines_between_delims(deferred_file_view, "// Normal Mapping End", "// GBuffer Fragment End");
+
+    return shaders;
+}
+
+// Full screen lighting pass, shares the brdf and light structs with the forward pass
+constexpr std::pair<std::string, std::string> get_pbr_lighting_pass(const std::string& light_uniforms, const std::string& light_functions)
+{
+    std::pair<std::string, std::string> shaders;
+
+    std::vector<char> pbr_file = read_file<char>("res/forward_pass/pbr_combined.glsl");
+    std::string_view pbr_file_view = { pbr_file.data(), pbr_file.size() };
+    std::vector<char> deferred_file = read_file<char>("res/deferred_shading/pbr_deferred.glsl");
+    std::string_view deferred_file_view = { deferred_file.data(), deferred_file.size() };
+
+    // Vertex Shader
+    shaders.first = "#version 460 core\n";
+    shaders.first += get_lines_between_delims(deferred_file_view, "// Lighting Vertex Begin", "// Lighting Vertex End");
+
+    // Fragment Shader
+    shaders.second += "#version 460 core\n";
+    shaders.second += get_lines_between_delims(deferred_file_view, "// Lighting Fragment Begin", "// PBR Functions Begin");
+    shaders.second += get_lines_between_delims(pbr_file_view, "// PBR Functions Begin", "// PBR Functions End");
+    shaders.second += get_lines_between_delims(deferred_file_view, "// PBR Functions End", "// Light Uniforms Begin");
+    shaders.second += light_uniforms;
+    shaders.second += get_lines_between_delims(deferred_file_view, "// Light Uniforms End", "// LO Functions Begin");
+    shaders.second += light_functions;
+    shaders.second += get_lines_between_delims(deferred_file_view, "// LO Functions End", "// Lighting Fragment End");
+
+    return shaders;
+}
+
+// Compute lighting pass, lights come from storage buffers so it only depends on the tile setup
+constexpr std::string get_pbr_tiled_lighting_pass()
+{
+    std::string shader;
+
+    std::vector<char> pbr_file = read_file<char>("res/forward_pass/pbr_combined.glsl");
+    std::string_view pbr_file_view = { pbr_file.data(), pbr_file.size() };
+    std::vector<char> deferred_file = read_file<char>("res/deferred_shading/pbr_deferred.glsl");
+    std::string_view deferred_file_view = { deferred_file.data(), deferred_file.size() };
+
+    shader = "#version 460 core\n";
+    shader += std::format("#define TILE_SIZE {}\n", Renderer::TiledLighting::TILE_SIZE);
+    shader += std::format("#define MAX_LIGHTS_PER_TILE {}\n", Renderer::TiledLighting::MAX_LIGHTS_PER_TILE);
+    shader += std::format("#define POINT_LIGHTS_BINDING {}\n", Renderer::TiledLighting::POINT_LIGHTS_BINDING);
+    shader += std::format("#define SPOT_LIGHTS_BINDING {}\n", Renderer::TiledLighting::SPOT_LIGHTS_BINDING);
+    shader += std::format("#define DIRECTIONAL_LIGHTS_BINDING {}\n", Renderer::TiledLighting::DIRECTIONAL_LIGHTS_BINDING);
+    shader += get_lines_between_delims(deferred_file_view, "// Tiled Lighting Compute Begin", "// Tiled Lighting Compute Functions");
+    shader += get_lines_between_delims(deferred_file_view, "// GBuffer Decode Begin", "// GBuffer Decode End");
+    shader += get_lines_between_delims(pbr_file_view, "// PBR Functions Begin", "// PBR Functions End");
+    shader += get_lines_between_delims(deferred_file_view, "// Tiled Lighting Compute Functions", "// Tiled Lighting Compute End");
+
+    return shader;
+}
+
+// Geometry pass of the visibility buffer, only writes the packed draw and triangle ids
+constexpr std::pair<std::string, std::string> get_visibility_pass(bool alpha_mask)
+{
+    std::pair<std::string, std::string> shaders;
+
+    std::vector<char> visibility_file = read_file<char>("res/visibility_buffer/visibility.glsl");
+    std::string_view visibility_file_view = { visibility_file.data(), visibility_file.size() };
+
+    // Vertex Shader
+    shaders.first = "#version 460 core\n";
+    shaders.first += get_lines_between_delims(visibility_file_view, "// Visibility Vertex Begin", "// Visibility Vertex End");
+
+    // Fragment Shader
+    shaders.second += "#version 460 core\n";
+    shaders.second += std::format("#define TRIANGLE_ID_BITS {}\n", Renderer::VisibilityBuffer::TRIANGLE_ID_BITS);
+    if (alpha_mask) {
+        shaders.second += "#define AlphaMask\n";
+    }
+    shaders.second += get_lines_between_delims(visibility_file_view, "// Visibility Fragment Begin", "// Visibility Fragment End");
+
+    return shaders;
+}
+
+// Full screen material pass of the visibility buffer, shares the brdf and normal mapping with the forward pass
+constexpr std::pair<std::string, std::string> get_visibility_material_pass(const std::string& light_uniforms, const std::string& light_functions)
+{
+    std::pair<std::string, std::string> shaders;
+
+    std::vector<char> pbr_file = read_file<char>("res/forward_pass/pbr_combined.glsl");
+    std::string_view pbr_file_view = { pbr_file.data(), pbr_file.size() };
+    std::vector<char> visibility_file = read_file<char>("res/visibility_buffer/visibility.glsl");
+    std::string_view visibility_file_view = { visibility_file.data(), visibility_file.size() };
+
+    // Vertex Shader
+    shaders.first = "#version 460 core\n";
+    shaders.first += get_lines_between_delims(visibility_file_view, "// Material Vertex Begin", "// Material Vertex End");
+
+    // Fragment Shader
+    shaders.second += "#version 460 core\n";
+    shaders.second += std::format("#define TRIANGLE_ID_BITS {}\n", Renderer::VisibilityBuffer::TRIANGLE_ID_BITS);
+    shaders.second += std::format("#define VERTICES_BINDING {}\n", Renderer::VisibilityBuffer::VERTICES_BINDING);
+    shaders.second += std::format("#define INDICES_BINDING {}\n", Renderer::VisibilityBuffer::INDICES_BINDING);
+    shaders.second += std::format("#define COMMANDS_BINDING {}\n", Renderer::VisibilityBuffer::COMMANDS_BINDING);
+    shaders.second += get_lines_between_delims(visibility_file_view, "// Material Fragment Begin", "// PBR Functions Begin");
+    shaders.second += get_lines_between_delims(pbr_file_view, "// PBR Functions Begin", "// PBR Functions End");
+    shaders.second += get_lines_between_delims(visibility_file_view, "// PBR Functions End", "// Normal Mapping Begin");
+    shaders.second += get_lines_between_delims(pbr_file_view, "// Normal Mapping Begin", "// Normal Mapping End");
+    shaders.second += get_lines_between_delims(visibility_file_view, "// Normal Mapping End", "// Light Uniforms Begin");
+    shaders.second += light_uniforms;
+    shaders.second += get_lines_between_delims(visibility_file_view, "// Light Uniforms End", "// LO Functions Begin");
+    shaders.second += light_functions;
+    shaders.second += get_lines_between_delims(visibility_file_view, "// LO Functions End", "// Material Fragment End");
+
+    return shaders;
+}
+
 // #include "scene_shaders_pbr.hpp"
 // #include "scene_shaders_phong.hpp"
 
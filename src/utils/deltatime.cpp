@@ -18,6 +18,14 @@ void DeltaTime::update()
     m_start_time = m_current_time;
     m_current_time = m_clock.now();
     m_delta_time = std::chrono::duration<float, std::chrono::seconds::period>(m_current_time - m_start_time).count();
+    if (m_fixed_delta_time > 0.0F) {
+        m_delta_time = m_fixed_delta_time;
+    }
+}
+
+void DeltaTime::set_fixed_delta_time(float delta_time)
+{
+    m_fixed_delta_time = delta_time;
 }
 
 } // namespace Utils
\ No newline at end of file
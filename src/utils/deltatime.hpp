@@ -14,12 +14,15 @@ public:
 
     void update();
     [[nodiscard]] float delta_time() const;
+    // Every update() reports this instead of the measured time, 0 goes back to measuring
+    void set_fixed_delta_time(float delta_time);
 
 private:
     std::chrono::high_resolution_clock m_clock;
     std::chrono::system_clock::time_point m_start_time;
     std::chrono::system_clock::time_point m_current_time;
     float m_delta_time {};
+    float m_fixed_delta_time {};
 };
 
 } // namespace Utils
@@ -0,0 +1,225 @@
+#include "flight_recorder.hpp"
+
+#if RPG_PROFILE
+
+namespace Utils::FlightRecorder {
+
+namespace {
+    struct Frame {
+        u64 index;
+        i64 begin_ns;
+        i64 end_ns;
+        std::vector<Event> events;
+        std::vector<std::pair<const char*, f64>> counters;
+    };
+
+    struct Spike {
+        u64 frame;
+        i64 end_ns;
+        f64 frame_ms;
+        const char* culprit;
+    };
+
+    struct State {
+        f32 budget_ms = 33.3F;
+        f32 window_seconds = 5.0F;
+        // Frames after the spike that go into the file as well
+        f32 after_seconds = 1.0F;
+        // Sustained slow frames would write a file every frame otherwise
+        f32 cooldown_seconds = 10.0F;
+
+        std::deque<Frame> frames;
+        u64 frame_index = 0;
+        std::vector<std::pair<const char*, f64>> counters;
+        // Copies of the counter names, the pairs above and in every frame point in here
+        std::deque<std::string> counter_names;
+        std::unordered_map<u32, std::string> track_names;
+
+        std::optional<Spike> pending;
+        i64 last_dump_ns = 0;
+        u32 spike_count = 0;
+        std::string last_dump;
+    };
+
+    State state;
+
+    constexpr f64 NS_PER_MS = 1'000'000.0;
+    constexpr f64 NS_PER_SECOND = 1'000'000'000.0;
+
+    // Scope with the most time not spent in its children
+    const char* find_culprit(const Frame& frame)
+    {
+        std::vector<Event> events = frame.events;
+        std::ranges::sort(events, [](const Event& a, const Event& b) {
+            if (a.tid != b.tid) {
+                return a.tid < b.tid;
+            }
+            return a.begin_ns != b.begin_ns ? a.begin_ns < b.begin_ns : a.end_ns > b.end_ns;
+        });
+
+        std::vector<i64> self_ns(events.size());
+        std::vector<usize> stack;
+        for (usize i = 0; i < events.size(); i++) {
+            while (!stack.empty() && (events[stack.back()].tid != events[i].tid || events[stack.back()].end_ns < events[i].end_ns)) {
+                stack.pop_back();
+            }
+            self_ns[i] = events[i].end_ns - events[i].begin_ns;
+            if (!stack.empty()) {
+                self_ns[stack.back()] -= self_ns[i];
+            }
+            stack.emplace_back(i);
+        }
+
+        const char* culprit = "unknown";
+        i64 longest = 0;
+        for (usize i = 0; i < events.size(); i++) {
+            if (self_ns[i] > longest) {
+                longest = self_ns[i];
+                culprit = events[i].name;
+            }
+        }
+        return culprit;
+    }
+
+    void write_spike(const Spike& spike)
+    {
+        nlohmann::json events = nlohmann::json::array();
+
+        for (const auto& [tid, name] : state.track_names) {
+            events.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", 0 }, { "tid", tid }, { "args", { { "name", name } } } });
+        }
+
+        for (const auto& frame : state.frames) {
+            const bool spike_frame = frame.index == spike.frame;
+            for (const auto& event : frame.events) {
+                nlohmann::json trace_event = {
+                    { "name", event.name },
+                    { "ph", "X" },
+                    { "pid", 0 },
+                    { "tid", event.tid },
+                    { "ts", static_cast<f64>(event.begin_ns) / 1000.0 },
+                    { "dur", static_cast<f64>(event.end_ns - event.begin_ns) / 1000.0 },
+                };
+                if (spike_frame && std::string_view(event.name) == spike.culprit) {
+                    trace_event["cname"] = "terrible";
+                }
+                events.push_back(std::move(trace_event));
+            }
+
+            const f64 timestamp_us = static_cast<f64>(frame.end_ns) / 1000.0;
+            events.push_back({ { "name", "frame ms" }, { "ph", "C" }, { "pid", 0 }, { "ts", timestamp_us }, { "args", { { "value", static_cast<f64>(frame.end_ns - frame.begin_ns) / NS_PER_MS } } } });
+            for (const auto& [name, value] : frame.counters) {
+                events.push_back({ { "name", name }, { "ph", "C" }, { "pid", 0 }, { "ts", timestamp_us }, { "args", { { "value", value } } } });
+            }
+        }
+
+        events.push_back({
+            { "name", std::format("spike: {}", spike.culprit) },
+            { "ph", "i" },
+            { "s", "g" },
+            { "pid", 0 },
+            { "tid", 0 },
+            { "ts", static_cast<f64>(spike.end_ns) / 1000.0 },
+            { "args", { { "frame", spike.frame }, { "frame_ms", spike.frame_ms }, { "budget_ms", state.budget_ms }, { "culprit", spike.culprit } } },
+        });
+
+        const nlohmann::json trace = {
+            { "displayTimeUnit", "ms" },
+            { "traceEvents", std::move(events) },
+        };
+
+        state.last_dump = std::format("spike_{}.json", spike.frame);
+        std::ofstream file(state.last_dump);
+        if (!file) {
+            LOG_ERROR(std::format("could not open trace file \"{}\"", state.last_dump));
+            return;
+        }
+        file << trace.dump();
+        LOG_INFO(std::format("Wrote frame spike trace to \"{}\"", state.last_dump));
+    }
+} // anonymous namespace
+
+void set_budget_ms(f32 budget_ms)
+{
+    state.budget_ms = budget_ms;
+}
+
+void set_window_seconds(f32 seconds)
+{
+    state.window_seconds = seconds;
+}
+
+void set_track_name(u32 tid, std::string_view name)
+{
+    auto& track_name = state.track_names[tid];
+    if (track_name != name) {
+        track_name = name;
+    }
+}
+
+void set_counter(const char* name, f64 value)
+{
+    for (auto& [counter, counter_value] : state.counters) {
+        if (std::string_view(counter) == name) {
+            counter_value = value;
+            return;
+        }
+    }
+    state.counters.emplace_back(state.counter_names.emplace_back(name).c_str(), value);
+}
+
+void add_event(const Event& event)
+{
+    if (!state.frames.empty()) {
+        state.frames.back().events.emplace_back(event);
+    }
+}
+
+void end_frame(i64 begin_ns, i64 end_ns, std::vector<Event>&& events)
+{
+    auto& frame = state.frames.emplace_back(Frame {
+        .index = state.frame_index++,
+        .begin_ns = begin_ns,
+        .end_ns = end_ns,
+        .events = std::move(events),
+        .counters = state.counters,
+    });
+
+    const auto window_ns = static_cast<i64>(static_cast<f64>(state.window_seconds) * NS_PER_SECOND);
+    while (state.frames.size() > 1 && state.frames.front().end_ns < end_ns - window_ns) {
+        state.frames.pop_front();
+    }
+
+    const f64 frame_ms = static_cast<f64>(end_ns - begin_ns) / NS_PER_MS;
+    const auto cooldown_ns = static_cast<i64>(static_cast<f64>(state.cooldown_seconds) * NS_PER_SECOND);
+    if (frame_ms > state.budget_ms && !state.pending.has_value() && (state.last_dump_ns == 0 || end_ns - state.last_dump_ns > cooldown_ns)) {
+        state.spike_count++;
+        state.pending = Spike { .frame = frame.index, .end_ns = end_ns, .frame_ms = frame_ms, .culprit = find_culprit(frame) };
+        LOG_WARN(std::format("Frame {} took {:.2f} ms (budget {:.2f} ms), most self time in \"{}\"",
+            frame.index,
+            frame_ms,
+            state.budget_ms,
+            state.pending->culprit));
+    }
+
+    const auto after_ns = static_cast<i64>(static_cast<f64>(state.after_seconds) * NS_PER_SECOND);
+    if (state.pending.has_value() && end_ns - state.pending->end_ns >= after_ns) {
+        write_spike(*state.pending);
+        state.last_dump_ns = end_ns;
+        state.pending.reset();
+    }
+}
+
+void draw_imgui()
+{
+    ImGui::DragFloat("Frame budget (ms)", &state.budget_ms, 0.1F, 1.0F, 1000.0F);
+    ImGui::DragFloat("Recorded seconds", &state.window_seconds, 0.1F, 1.0F, 30.0F);
+    ImGui::Text("%zu frames recorded, %u spikes", state.frames.size(), state.spike_count);
+    if (!state.last_dump.empty()) {
+        ImGui::Text("Last spike trace: %s", state.last_dump.c_str());
+    }
+}
+
+} // namespace Utils::FlightRecorder
+
+#endif
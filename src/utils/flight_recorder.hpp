@@ -0,0 +1,45 @@
+#pragma once
+
+// Keeps the last few seconds of frames (profiler scopes, GPU scopes and counters). A frame over
+// the budget is written out with the frames around it as a Chrome trace, the scope with the most
+// self time in that frame is reported and highlighted as the likely cause
+namespace Utils::FlightRecorder {
+
+struct Event {
+    const char* name;
+    // Trace thread id, profiler threads and tracks share the numbering
+    u32 tid;
+    i64 begin_ns;
+    i64 end_ns;
+};
+
+#if RPG_PROFILE
+
+void set_budget_ms(f32 budget_ms);
+void set_window_seconds(f32 seconds);
+void set_track_name(u32 tid, std::string_view name);
+
+// Value of a counter for the frame in progress, counters are told apart by their text and the
+// name is copied, so it does not have to outlive the call
+void set_counter(const char* name, f64 value);
+// Events that show up after their frame ended (GPU results), kept with the newest frame
+void add_event(const Event& event);
+
+// Called by Profiler::end_frame() with every scope recorded during the frame
+void end_frame(i64 begin_ns, i64 end_ns, std::vector<Event>&& events);
+
+void draw_imgui();
+
+#else
+
+inline void set_budget_ms(f32) { }
+inline void set_window_seconds(f32) { }
+inline void set_track_name(u32, std::string_view) { }
+inline void set_counter(const char*, f64) { }
+inline void add_event(const Event&) { }
+inline void end_frame(i64, i64, std::vector<Event>&&) { }
+inline void draw_imgui() { }
+
+#endif
+
+} // namespace Utils::FlightRecorder
@@ -0,0 +1,237 @@
+#include "job_system.hpp"
+
+namespace Utils {
+
+namespace {
+    // Set on worker threads, jobs they queue go to their own deque
+    thread_local const JobSystem* t_job_system = nullptr;
+    thread_local u32 t_worker_index = 0;
+
+    std::unique_ptr<JobSystem> s_job_system;
+} // anonymous namespace
+
+JobSystem::PriorityJob::PriorityJob(const char* name, JPH::ColorArg color, JobSystem* job_system, const JobFunction& function, JPH::uint32 num_dependencies, Priority priority)
+    : Job(name, color, job_system, function, num_dependencies)
+    , m_name(name)
+    , m_priority(priority)
+{
+}
+
+JobSystem::JobSystem(u32 worker_count)
+{
+    util_assert(worker_count > 0, "JobSystem needs at least one worker");
+
+    Init(MAX_BARRIERS);
+
+    for (u32 i = 0; i < worker_count; i++) {
+        m_queues.emplace_back(std::make_unique<WorkerQueue>());
+    }
+    for (u32 i = 0; i < worker_count; i++) {
+        m_workers.emplace_back([this, i]() { worker_main(i); });
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard lock(m_wake_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    m_workers.clear();
+
+    // Whatever nobody got to, its handles are gone by now
+    for (auto& queue : m_queues) {
+        for (auto& jobs : queue->jobs) {
+            for (Job* job : jobs) {
+                job->Release();
+            }
+        }
+    }
+}
+
+[[nodiscard]] JPH::JobHandle JobSystem::create_job(const char* name, Priority priority, const JobFunction& function, u32 num_dependencies)
+{
+    auto* job = new PriorityJob(name, JPH::Color::sGrey, this, function, num_dependencies, priority);
+    // The handle holds a reference before the job is queued, it may finish right away
+    JPH::JobHandle handle(job);
+    if (num_dependencies == 0) {
+        QueueJob(job);
+    }
+    return handle;
+}
+
+void JobSystem::parallel_for(u32 count, const std::function<void(u32)>& function, Priority priority)
+{
+    if (count <= 1) {
+        if (count == 1) {
+            function(0);
+        }
+        return;
+    }
+
+    std::atomic<u32> next = 0;
+    const auto run = [&]() {
+        for (u32 i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            function(i);
+        }
+    };
+
+    const u32 job_count = std::min(count, (get_worker_count() + 1) * JOBS_PER_THREAD);
+    Barrier* barrier = CreateBarrier();
+    for (u32 i = 0; i < job_count; i++) {
+        barrier->AddJob(create_job("JobSystem::parallel_for", priority, run));
+    }
+    WaitForJobs(barrier);
+    DestroyBarrier(barrier);
+}
+
+[[nodiscard]] u32 JobSystem::get_worker_count() const
+{
+    return static_cast<u32>(m_workers.size());
+}
+
+[[nodiscard]] int JobSystem::GetMaxConcurrency() const
+{
+    return static_cast<int>(m_workers.size()) + 1;
+}
+
+[[nodiscard]] JPH::JobHandle JobSystem::CreateJob(const char* inName, [[maybe_unused]] JPH::ColorArg inColor, const JobFunction& inJobFunction, JPH::uint32 inNumDependencies)
+{
+    // A physics step holds up the frame, so Jolt goes first
+    return create_job(inName, Priority::High, inJobFunction, inNumDependencies);
+}
+
+void JobSystem::QueueJob(Job* inJob)
+{
+    // The queue keeps its own reference until a worker is done with the job
+    inJob->AddRef();
+    m_queued.fetch_add(1);
+    push(inJob);
+
+    {
+        std::lock_guard lock(m_wake_mutex);
+    }
+    m_wake.notify_one();
+}
+
+void JobSystem::QueueJobs(Job** inJobs, JPH::uint inNumJobs)
+{
+    m_queued.fetch_add(inNumJobs);
+    for (JPH::uint i = 0; i < inNumJobs; i++) {
+        inJobs[i]->AddRef();
+        push(inJobs[i]);
+    }
+
+    {
+        std::lock_guard lock(m_wake_mutex);
+    }
+    m_wake.notify_all();
+}
+
+void JobSystem::FreeJob(Job* inJob)
+{
+    delete static_cast<PriorityJob*>(inJob);
+}
+
+void JobSystem::push(Job* job)
+{
+    const u32 index = t_job_system == this
+        ? t_worker_index
+        : m_next_queue.fetch_add(1, std::memory_order_relaxed) % static_cast<u32>(m_queues.size());
+    const auto priority = static_cast<usize>(static_cast<PriorityJob*>(job)->m_priority);
+
+    WorkerQueue& queue = *m_queues[index];
+    std::lock_guard lock(queue.mutex);
+    queue.jobs[priority].push_back(job);
+}
+
+[[nodiscard]] JPH::JobSystem::Job* JobSystem::take(u32 index)
+{
+    const auto queue_count = static_cast<u32>(m_queues.size());
+    for (usize priority = 0; priority < static_cast<usize>(Priority::Count); priority++) {
+        // Newest first from our own deque, it is the most likely to still be in cache
+        {
+            WorkerQueue& queue = *m_queues[index];
+            std::lock_guard lock(queue.mutex);
+            auto& jobs = queue.jobs[priority];
+            if (!jobs.empty()) {
+                Job* job = jobs.back();
+                jobs.pop_back();
+                return job;
+            }
+        }
+
+        // Oldest first from the others, the end their owner is not working on
+        for (u32 offset = 1; offset < queue_count; offset++) {
+            WorkerQueue& queue = *m_queues[(index + offset) % queue_count];
+            std::lock_guard lock(queue.mutex);
+            auto& jobs = queue.jobs[priority];
+            if (!jobs.empty()) {
+                Job* job = jobs.front();
+                jobs.pop_front();
+                return job;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::worker_main(u32 index)
+{
+    Profiler::set_thread_name(std::format("job worker {}", index).c_str());
+    t_job_system = this;
+    t_worker_index = index;
+
+    while (true) {
+        Job* job = take(index);
+        if (job == nullptr) {
+            std::unique_lock lock(m_wake_mutex);
+            m_wake.wait(lock, [this]() { return m_stop || m_queued.load() > 0; });
+            if (m_stop) {
+                return;
+            }
+            continue;
+        }
+        m_queued.fetch_sub(1);
+
+        {
+            PROFILE_SCOPE(static_cast<PriorityJob*>(job)->m_name);
+            // A barrier may have run it already, Execute() only runs a job once
+            job->Execute();
+        }
+        job->Release();
+    }
+}
+
+namespace Jobs {
+
+    void init(u32 worker_count)
+    {
+        util_assert(s_job_system == nullptr, "Jobs::init() has already been initialized");
+
+        if (worker_count == 0) {
+            worker_count = std::max(std::thread::hardware_concurrency(), 2U) - 1;
+        }
+        s_job_system = std::make_unique<JobSystem>(worker_count);
+    }
+
+    void shutdown()
+    {
+        s_job_system.reset();
+    }
+
+    [[nodiscard]] JobSystem& get()
+    {
+        util_assert(s_job_system != nullptr, "Jobs has not been initialized");
+        return *s_job_system;
+    }
+
+    [[nodiscard]] bool is_initialized()
+    {
+        return s_job_system != nullptr;
+    }
+
+} // namespace Jobs
+
+} // namespace Utils
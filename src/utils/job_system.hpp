@@ -0,0 +1,91 @@
+#pragma once
+
+#include <Jolt/Core/JobSystemWithBarrier.h>
+
+namespace Utils {
+
+// Work stealing job system shared by the whole engine. Every worker owns a deque per priority,
+// pops the newest job of its own and steals the oldest of another worker when it runs dry.
+// It implements JPH::JobSystem, so Jolt steps on the same threads that load assets and build
+// the render queue, and jobs wait on each other with Jolt's dependency counters
+class JobSystem final : public JPH::JobSystemWithBarrier {
+public:
+    enum class Priority : u8 {
+        // Frame critical work, Jolt's own jobs run here
+        High = 0,
+        Normal,
+        // Loading and anything else that can wait a frame
+        Low,
+        Count,
+    };
+
+    // The threads calling parallel_for() and WaitForJobs() work too, so one less than there are cores
+    explicit JobSystem(u32 worker_count);
+    ~JobSystem() override;
+
+    // The job waits for num_dependencies RemoveDependency() calls on its handle before it is queued
+    [[nodiscard]] JPH::JobHandle create_job(const char* name, Priority priority, const JobFunction& function, u32 num_dependencies = 0);
+
+    // Calls function(i) for every i below count and returns when all are done. Indices are handed
+    // out one at a time to a few jobs, so uneven work still spreads over the workers
+    void parallel_for(u32 count, const std::function<void(u32)>& function, Priority priority = Priority::Normal);
+
+    [[nodiscard]] u32 get_worker_count() const;
+
+    [[nodiscard]] int GetMaxConcurrency() const override;
+    [[nodiscard]] JPH::JobHandle CreateJob(const char* inName, JPH::ColorArg inColor, const JobFunction& inJobFunction, JPH::uint32 inNumDependencies = 0) override;
+
+    static constexpr u32 MAX_BARRIERS = 64;
+    // Jobs parallel_for() starts per thread that can run them
+    static constexpr u32 JOBS_PER_THREAD = 4;
+
+protected:
+    void QueueJob(Job* inJob) override;
+    void QueueJobs(Job** inJobs, JPH::uint inNumJobs) override;
+    void FreeJob(Job* inJob) override;
+
+private:
+    class PriorityJob : public Job {
+    public:
+        PriorityJob(const char* name, JPH::ColorArg color, JobSystem* job_system, const JobFunction& function, JPH::uint32 num_dependencies, Priority priority);
+
+        // Jolt only keeps the name in profiling builds
+        const char* m_name;
+        Priority m_priority;
+    };
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::array<std::deque<Job*>, static_cast<usize>(Priority::Count)> jobs;
+    };
+
+    void worker_main(u32 index);
+    void push(Job* job);
+    [[nodiscard]] Job* take(u32 index);
+
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::vector<std::jthread> m_workers;
+    // Spreads jobs queued from threads that are not workers
+    std::atomic<u32> m_next_queue = 0;
+
+    // Workers sleep while m_queued is 0
+    std::atomic<u32> m_queued = 0;
+    std::mutex m_wake_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+};
+
+// The engine's shared JobSystem. Physics::Engine::setup_singletons() starts it, the jobs use
+// Jolt's allocator
+namespace Jobs {
+
+    // 0 starts a worker per core minus the main thread
+    void init(u32 worker_count = 0);
+    void shutdown();
+
+    [[nodiscard]] JobSystem& get();
+    [[nodiscard]] bool is_initialized();
+
+} // namespace Jobs
+
+} // namespace Utils
@@ -0,0 +1,356 @@
+#include "profiler.hpp"
+
+#if RPG_PROFILE
+
+#include "flight_recorder.hpp"
+
+#include <cstring>
+
+#if defined(JPH_EXTERNAL_PROFILE) && defined(JPH_PROFILE_ENABLED)
+#include <Jolt/Core/Profiler.h>
+#endif
+
+namespace Utils::Profiler {
+
+namespace {
+    struct Record {
+        const char* name;
+        i64 begin_ns;
+        i64 end_ns;
+    };
+
+    // Written by its thread only, read by end_frame(). A reader that falls a whole buffer behind
+    // loses the oldest records instead of blocking the writer. The name can change at any time, so
+    // it is only touched with buffers_mutex held
+    struct ThreadBuffer {
+        static constexpr u64 CAPACITY = 16384;
+
+        std::array<Record, CAPACITY> records;
+        std::atomic<u64> write = 0;
+        u64 read = 0;
+
+        std::string name;
+        u32 index = 0;
+    };
+
+    struct Node {
+        const char* name;
+        i64 total_ns = 0;
+        u32 calls = 0;
+        std::vector<Node> children;
+    };
+
+    struct ThreadView {
+        std::string name;
+        std::vector<Node> roots;
+    };
+
+    struct State {
+        // Only taken when a thread records its first scope, names its buffer or a frame ends
+        std::mutex buffers_mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+        i64 frame_begin_ns = now_ns();
+        i64 frame_ns = 0;
+        u64 lost_records = 0;
+        std::vector<ThreadView> view;
+        std::vector<Record> scratch;
+
+        std::string trace_path;
+        u32 trace_frames_left = 0;
+        nlohmann::json trace_events = nlohmann::json::array();
+        std::vector<std::string> tracks;
+    };
+
+    State state;
+    thread_local ThreadBuffer* thread_buffer = nullptr;
+
+    // Trace thread ids of the extra tracks start here
+    constexpr u32 TRACK_TID_OFFSET = 1000;
+
+    ThreadBuffer& get_thread_buffer()
+    {
+        if (thread_buffer == nullptr) {
+            std::lock_guard lock(state.buffers_mutex);
+            auto& buffer = state.buffers.emplace_back(std::make_unique<ThreadBuffer>());
+            buffer->index = static_cast<u32>(state.buffers.size() - 1);
+            buffer->name = std::format("thread {}", buffer->index);
+            thread_buffer = buffer.get();
+        }
+        return *thread_buffer;
+    }
+
+    void push_record(const char* name, i64 begin_ns, i64 end_ns)
+    {
+        ThreadBuffer& buffer = get_thread_buffer();
+        const u64 write = buffer.write.load(std::memory_order_relaxed);
+        buffer.records[write % ThreadBuffer::CAPACITY] = Record { .name = name, .begin_ns = begin_ns, .end_ns = end_ns };
+        buffer.write.store(write + 1, std::memory_order_release);
+    }
+
+    void drain(ThreadBuffer& buffer, std::vector<Record>& records)
+    {
+        records.clear();
+
+        u64 write = buffer.write.load(std::memory_order_acquire);
+        if (write - buffer.read > ThreadBuffer::CAPACITY) {
+            state.lost_records += write - buffer.read - ThreadBuffer::CAPACITY;
+            buffer.read = write - ThreadBuffer::CAPACITY;
+        }
+        for (u64 i = buffer.read; i < write; i++) {
+            records.emplace_back(buffer.records[i % ThreadBuffer::CAPACITY]);
+        }
+
+        // Records the writer lapped while they were copied are dropped
+        const u64 overwritten_before = buffer.write.load(std::memory_order_acquire) - ThreadBuffer::CAPACITY;
+        if (write > ThreadBuffer::CAPACITY && overwritten_before > buffer.read) {
+            const u64 torn = std::min<u64>(overwritten_before - buffer.read, records.size());
+            records.erase(records.begin(), records.begin() + static_cast<i64>(torn));
+            state.lost_records += torn;
+        }
+        buffer.read = write;
+    }
+
+    // Nests records by time and merges siblings with the same name
+    std::vector<Node> build_tree(std::vector<Record>& records)
+    {
+        std::ranges::sort(records, [](const Record& a, const Record& b) {
+            return a.begin_ns != b.begin_ns ? a.begin_ns < b.begin_ns : a.end_ns > b.end_ns;
+        });
+
+        std::vector<Node> roots;
+        // End time and child index of every open ancestor
+        std::vector<std::pair<i64, usize>> stack;
+        for (const auto& record : records) {
+            while (!stack.empty() && stack.back().first < record.end_ns) {
+                stack.pop_back();
+            }
+
+            std::vector<Node>* siblings = &roots;
+            for (const auto& [end_ns, index] : stack) {
+                siblings = &(*siblings)[index].children;
+            }
+
+            auto it = std::ranges::find_if(*siblings, [&](const Node& node) { return std::string_view(node.name) == record.name; });
+            if (it == siblings->end()) {
+                siblings->emplace_back(Node { .name = record.name });
+                it = siblings->end() - 1;
+            }
+            it->total_ns += record.end_ns - record.begin_ns;
+            it->calls++;
+            stack.emplace_back(record.end_ns, static_cast<usize>(it - siblings->begin()));
+        }
+        return roots;
+    }
+
+    void add_trace_records(const ThreadBuffer& buffer, const std::vector<Record>& records)
+    {
+        for (const auto& record : records) {
+            state.trace_events.push_back({
+                { "name", record.name },
+                { "ph", "X" },
+                { "pid", 0 },
+                { "tid", buffer.index },
+                { "ts", static_cast<f64>(record.begin_ns) / 1000.0 },
+                { "dur", static_cast<f64>(record.end_ns - record.begin_ns) / 1000.0 },
+            });
+        }
+    }
+
+    void write_trace()
+    {
+        const auto add_thread_name = [](u32 tid, const std::string& name) {
+            state.trace_events.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", 0 }, { "tid", tid }, { "args", { { "name", name } } } });
+        };
+        {
+            std::lock_guard lock(state.buffers_mutex);
+            for (const auto& buffer : state.buffers) {
+                add_thread_name(buffer->index, buffer->name);
+            }
+        }
+        for (u32 track = 0; track < state.tracks.size(); track++) {
+            add_thread_name(TRACK_TID_OFFSET + track, state.tracks[track]);
+        }
+
+        const nlohmann::json trace = {
+            { "displayTimeUnit", "ms" },
+            { "traceEvents", std::move(state.trace_events) },
+        };
+        state.trace_events = nlohmann::json::array();
+
+        std::ofstream file(state.trace_path);
+        if (!file) {
+            LOG_ERROR(std::format("could not open trace file \"{}\"", state.trace_path));
+            return;
+        }
+        file << trace.dump();
+        LOG_INFO(std::format("Wrote profiler trace to \"{}\"", state.trace_path));
+    }
+
+    void draw_node(const Node& node)
+    {
+        const ImGuiTreeNodeFlags flags = node.children.empty() ? ImGuiTreeNodeFlags_Leaf : ImGuiTreeNodeFlags_DefaultOpen;
+        const bool open = ImGui::TreeNodeEx(node.name, flags, "%s: %.3f ms (%u)", node.name, static_cast<f64>(node.total_ns) / 1'000'000.0, node.calls);
+        if (open) {
+            for (const auto& child : node.children) {
+                draw_node(child);
+            }
+            ImGui::TreePop();
+        }
+    }
+
+#if defined(JPH_EXTERNAL_PROFILE) && defined(JPH_PROFILE_ENABLED)
+    // Jolt keeps 64 bytes per measurement for the external profiler
+    struct JoltMeasurement {
+        const char* name;
+        i64 begin_ns;
+    };
+    static_assert(sizeof(JoltMeasurement) <= 64);
+
+    void jolt_start_measurement(const char* name, u32, u8* user_data)
+    {
+        const JoltMeasurement measurement { .name = name, .begin_ns = now_ns() };
+        std::memcpy(user_data, &measurement, sizeof(measurement));
+    }
+
+    void jolt_end_measurement(u8* user_data)
+    {
+        JoltMeasurement measurement {};
+        std::memcpy(&measurement, user_data, sizeof(measurement));
+        push_record(measurement.name, measurement.begin_ns, now_ns());
+    }
+#endif
+} // anonymous namespace
+
+Scope::Scope(const char* name)
+    : m_name(name)
+    , m_begin_ns(now_ns())
+{
+}
+
+Scope::~Scope()
+{
+    push_record(m_name, m_begin_ns, now_ns());
+}
+
+void set_thread_name(const char* name)
+{
+    ThreadBuffer& buffer = get_thread_buffer();
+    std::lock_guard lock(state.buffers_mutex);
+    buffer.name = name;
+}
+
+void install_jolt_hooks()
+{
+#if defined(JPH_EXTERNAL_PROFILE) && defined(JPH_PROFILE_ENABLED)
+    // Jolt measures its own jobs, including the ones on its worker threads
+    JPH::ProfileStartMeasurement = jolt_start_measurement;
+    JPH::ProfileEndMeasurement = jolt_end_measurement;
+#else
+    LOG_WARN("Jolt was built without JPH_EXTERNAL_PROFILE, its jobs are not profiled");
+#endif
+}
+
+void end_frame()
+{
+    const i64 frame_end_ns = now_ns();
+    state.frame_ns = frame_end_ns - state.frame_begin_ns;
+    state.frame_begin_ns = frame_end_ns;
+
+    std::vector<ThreadBuffer*> buffers;
+    std::vector<std::string> names;
+    {
+        std::lock_guard lock(state.buffers_mutex);
+        for (const auto& buffer : state.buffers) {
+            buffers.emplace_back(buffer.get());
+            names.emplace_back(buffer->name);
+        }
+    }
+
+    state.view.clear();
+    std::vector<FlightRecorder::Event> events;
+    for (usize i = 0; i < buffers.size(); i++) {
+        ThreadBuffer* buffer = buffers[i];
+        FlightRecorder::set_track_name(buffer->index, names[i]);
+        drain(*buffer, state.scratch);
+        if (state.scratch.empty()) {
+            continue;
+        }
+        if (state.trace_frames_left > 0) {
+            add_trace_records(*buffer, state.scratch);
+        }
+        for (const auto& record : state.scratch) {
+            events.emplace_back(FlightRecorder::Event { .name = record.name, .tid = buffer->index, .begin_ns = record.begin_ns, .end_ns = record.end_ns });
+        }
+        state.view.emplace_back(ThreadView { .name = std::move(names[i]), .roots = build_tree(state.scratch) });
+    }
+
+    FlightRecorder::end_frame(frame_end_ns - state.frame_ns, frame_end_ns, std::move(events));
+
+    if (state.trace_frames_left > 0 && --state.trace_frames_left == 0) {
+        write_trace();
+    }
+}
+
+void capture_trace(const char* path, u32 frame_count)
+{
+    util_assert(frame_count > 0, "Profiler::capture_trace() needs at least one frame");
+    state.trace_path = path;
+    state.trace_frames_left = frame_count;
+    state.trace_events = nlohmann::json::array();
+}
+
+[[nodiscard]] bool is_capturing()
+{
+    return state.trace_frames_left > 0;
+}
+
+[[nodiscard]] u32 register_track(const char* name)
+{
+    state.tracks.emplace_back(name);
+    const auto track = static_cast<u32>(state.tracks.size() - 1);
+    FlightRecorder::set_track_name(TRACK_TID_OFFSET + track, name);
+    return track;
+}
+
+void add_trace_event(u32 track, const char* name, i64 begin_ns, i64 end_ns)
+{
+    FlightRecorder::add_event(FlightRecorder::Event { .name = name, .tid = TRACK_TID_OFFSET + track, .begin_ns = begin_ns, .end_ns = end_ns });
+    if (state.trace_frames_left == 0) {
+        return;
+    }
+    state.trace_events.push_back({
+        { "name", name },
+        { "ph", "X" },
+        { "pid", 0 },
+        { "tid", TRACK_TID_OFFSET + track },
+        { "ts", static_cast<f64>(begin_ns) / 1000.0 },
+        { "dur", static_cast<f64>(end_ns - begin_ns) / 1000.0 },
+    });
+}
+
+void draw_imgui()
+{
+    ImGui::Text("Frame: %.3f ms, records lost: %llu",
+        static_cast<f64>(state.frame_ns) / 1'000'000.0,
+        static_cast<unsigned long long>(state.lost_records));
+
+    for (const auto& thread : state.view) {
+        if (ImGui::TreeNodeEx(thread.name.c_str(), ImGuiTreeNodeFlags_DefaultOpen)) {
+            for (const auto& node : thread.roots) {
+                draw_node(node);
+            }
+            ImGui::TreePop();
+        }
+    }
+
+    if (is_capturing()) {
+        ImGui::Text("Capturing trace, %u frames left", state.trace_frames_left);
+    } else if (ImGui::Button("Capture trace (60 frames)")) {
+        capture_trace("trace.json", 60);
+    }
+}
+
+} // namespace Utils::Profiler
+
+#endif
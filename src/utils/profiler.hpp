@@ -0,0 +1,66 @@
+#pragma once
+
+// CPU scopes for every thread. A scope writes one record into its thread's ring buffer when it
+// ends, without locks, end_frame() drains the buffers on the main thread into a per frame tree.
+// Configure with -DRPG_PROFILE=OFF and PROFILE_SCOPE compiles to nothing
+#ifndef RPG_PROFILE
+#define RPG_PROFILE 0
+#endif
+
+#define PROFILE_CONCAT_INTERNAL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INTERNAL(a, b)
+
+namespace Utils::Profiler {
+
+[[nodiscard]] inline i64 now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#if RPG_PROFILE
+
+// Names are kept by pointer, string literals in practice
+class Scope : public NoCopyNoMove {
+public:
+    explicit Scope(const char* name);
+    ~Scope();
+
+private:
+    const char* m_name;
+    i64 m_begin_ns;
+};
+
+void set_thread_name(const char* name);
+// Forwards Jolt's own measurements, needs Jolt built with JPH_EXTERNAL_PROFILE
+void install_jolt_hooks();
+
+// Main thread only, once per frame
+void end_frame();
+
+// Chrome trace of the next frame_count frames, other profilers add their events on their own track.
+// Track events also go to the flight recorder, captured or not
+void capture_trace(const char* path, u32 frame_count);
+[[nodiscard]] bool is_capturing();
+[[nodiscard]] u32 register_track(const char* name);
+void add_trace_event(u32 track, const char* name, i64 begin_ns, i64 end_ns);
+
+void draw_imgui();
+
+#define PROFILE_SCOPE(name) ::Utils::Profiler::Scope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+
+#else
+
+inline void set_thread_name(const char*) { }
+inline void install_jolt_hooks() { }
+inline void end_frame() { }
+inline void capture_trace(const char*, u32) { }
+[[nodiscard]] inline bool is_capturing() { return false; }
+[[nodiscard]] inline u32 register_track(const char*) { return 0; }
+inline void add_trace_event(u32, const char*, i64, i64) { }
+inline void draw_imgui() { }
+
+#define PROFILE_SCOPE(name)
+
+#endif
+
+} // namespace Utils::Profiler